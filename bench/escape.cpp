@@ -0,0 +1,96 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// Measures the throughput of HTML escaping for text with 0%, 1%,
+// and 10% special characters, against a byte-at-a-time reference
+
+#include <boost/mustache/render.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <string>
+#include <random>
+#include <iostream>
+
+static void escape_bytewise( boost::core::string_view sv, boost::mustache::output_ref out )
+{
+    for( char ch: sv )
+    {
+        switch( ch )
+        {
+        case '<': out.write( "&lt;" ); break;
+        case '>': out.write( "&gt;" ); break;
+        case '"': out.write( "&quot;" ); break;
+        case '&': out.write( "&amp;" ); break;
+        default: out.write( { &ch, 1 } ); break;
+        }
+    }
+}
+
+static std::string make_text( std::size_t n, int percent )
+{
+    std::mt19937 rng( 5 );
+    std::uniform_int_distribution<int> d100( 0, 99 );
+
+    static char const special[] = "<>\"&";
+    static char const plain[] = "abcdefghijklmnopqrstuvwxyz ,.";
+
+    std::string r;
+
+    for( std::size_t i = 0; i < n; ++i )
+    {
+        if( d100( rng ) < percent )
+        {
+            r += special[ i % 4 ];
+        }
+        else
+        {
+            r += plain[ i % ( sizeof( plain ) - 1 ) ];
+        }
+    }
+
+    return r;
+}
+
+template<class F> static double measure( std::size_t size, F f )
+{
+    int const N = 100;
+
+    auto t1 = std::chrono::steady_clock::now();
+
+    for( int i = 0; i < N; ++i )
+    {
+        f();
+    }
+
+    auto t2 = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>( t2 - t1 ).count();
+
+    return static_cast<double>( size ) * N / ns;
+}
+
+int main()
+{
+    for( int percent: { 0, 1, 10 } )
+    {
+        std::string text = make_text( 1 << 20, percent );
+        boost::json::value data = { { "text", text } };
+
+        std::string out;
+
+        double r1 = measure( text.size(), [&]{
+
+            out.clear();
+            escape_bytewise( text, out );
+        });
+
+        double r2 = measure( text.size(), [&]{
+
+            out.clear();
+            boost::mustache::render( "{{text}}", out, data, {} );
+        });
+
+        std::cout << percent << "% special: bytewise " << r1 << " bytes/ns, render " << r2 << " bytes/ns" << std::endl;
+    }
+}
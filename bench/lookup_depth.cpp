@@ -0,0 +1,76 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// Measures the cost of interpolating names from the outermost context
+// and from the current element, as a function of the section depth
+
+#include <boost/mustache/render.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <string>
+#include <iostream>
+
+int main()
+{
+    int const M = 100000; // elements of the innermost section
+
+    for( int depth = 1; depth <= 8; ++depth )
+    {
+        // {{#s1}}...{{#sN}}{{title}} {{id}} ...{{/sN}}...{{/s1}}
+
+        std::string tmpl;
+
+        for( int i = 1; i <= depth; ++i )
+        {
+            tmpl += "{{#s" + std::to_string( i ) + "}}";
+        }
+
+        for( int i = 0; i < 5; ++i )
+        {
+            tmpl += "{{title}} {{id}} ";
+        }
+
+        for( int i = depth; i >= 1; --i )
+        {
+            tmpl += "{{/s" + std::to_string( i ) + "}}";
+        }
+
+        // every section but the innermost has a single element
+
+        boost::json::array rows;
+
+        for( int i = 0; i < M; ++i )
+        {
+            rows.push_back( { { "id", i } } );
+        }
+
+        boost::json::value v = std::move( rows );
+
+        for( int i = depth - 1; i >= 1; --i )
+        {
+            boost::json::object level;
+
+            level[ "s" + std::to_string( i + 1 ) ] = std::move( v );
+            level[ "unrelated" ] = i;
+
+            v = boost::json::array{ std::move( level ) };
+        }
+
+        boost::json::value data = { { "title", "Title" }, { "s1", std::move( v ) } };
+
+        std::string out;
+
+        boost::mustache::compiled_template ct( tmpl );
+
+        auto t1 = std::chrono::steady_clock::now();
+
+        boost::mustache::render( ct, out, data, {} );
+
+        auto t2 = std::chrono::steady_clock::now();
+
+        double ns = std::chrono::duration<double, std::nano>( t2 - t1 ).count();
+
+        std::cout << "depth " << depth << ": " << ns / ( M * 10 ) << " ns/interpolation" << std::endl;
+    }
+}
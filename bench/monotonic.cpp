@@ -0,0 +1,123 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// Compares rendering with the default heap storage against the
+// per-render monotonic storage, on small, medium and large templates,
+// with JSON data, used in place, and with data converted by value_from
+
+#include <boost/mustache/render.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+using record = std::map<std::string, std::string>;
+
+struct workload
+{
+    char const* name;
+
+    std::string tmpl;
+
+    // the same data, as JSON and as standard containers
+    boost::json::value data;
+    std::map<std::string, std::vector<record>> native;
+};
+
+static workload make_workload( char const* name, std::size_t rows, std::size_t cols )
+{
+    workload w{ name, "<h1>{{title}}</h1>\n<table>\n{{#rows}}\n  <tr>", {}, {} };
+
+    for( std::size_t j = 0; j < cols; ++j )
+    {
+        w.tmpl += "<td>{{c" + std::to_string( j ) + "}}</td>";
+    }
+
+    w.tmpl += "</tr>\n{{/rows}}\n</table>\n{{^rows}}none{{/rows}}\n";
+
+    std::vector<record> v;
+
+    for( std::size_t i = 0; i < rows; ++i )
+    {
+        record r;
+
+        for( std::size_t j = 0; j < cols; ++j )
+        {
+            r[ "c" + std::to_string( j ) ] = "value " + std::to_string( i * cols + j );
+        }
+
+        v.push_back( r );
+    }
+
+    w.native[ "rows" ] = v;
+    w.data = boost::json::value_from( w.native );
+    w.data.as_object()[ "title" ] = "Table";
+
+    return w;
+}
+
+template<class F> static double measure( F f )
+{
+    std::string out;
+
+    f( out );
+
+    double ns = 0;
+    std::size_t n = 1;
+
+    for( ;; )
+    {
+        auto t1 = std::chrono::steady_clock::now();
+
+        for( std::size_t i = 0; i < n; ++i )
+        {
+            out.clear();
+            f( out );
+        }
+
+        auto t2 = std::chrono::steady_clock::now();
+
+        ns = std::chrono::duration<double, std::nano>( t2 - t1 ).count();
+
+        if( ns >= 2e8 )
+        {
+            break;
+        }
+
+        n *= 2;
+    }
+
+    return ns / n;
+}
+
+static void report( char const* name, char const* mode, double heap, double monotonic )
+{
+    std::cout << name << " (" << mode << "): heap " << heap / 1000 << " us, monotonic " << monotonic / 1000 << " us, " << heap / monotonic << "x" << std::endl;
+}
+
+int main()
+{
+    workload workloads[] = { make_workload( "small", 3, 2 ), make_workload( "medium", 100, 5 ), make_workload( "large", 5000, 10 ) };
+
+    boost::json::object const partials;
+
+    for( workload const& w: workloads )
+    {
+        // JSON data, used in place
+
+        double t1 = measure( [&]( std::string& out ){ boost::mustache::render( w.tmpl, out, w.data, partials, boost::json::storage_ptr() ); } );
+        double t2 = measure( [&]( std::string& out ){ boost::mustache::render( w.tmpl, out, w.data, partials ); } );
+
+        report( w.name, "json", t1, t2 );
+
+        // data converted by value_from
+
+        double t3 = measure( [&]( std::string& out ){ boost::mustache::render( w.tmpl, out, w.native, partials, boost::json::storage_ptr() ); } );
+        double t4 = measure( [&]( std::string& out ){ boost::mustache::render( w.tmpl, out, w.native, partials ); } );
+
+        report( w.name, "value_from", t3, t4 );
+    }
+}
@@ -0,0 +1,109 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// Measures the time per interpolated number for integers and doubles,
+// against formatting with snprintf as a reference
+
+#include <boost/mustache/render.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <utility>
+#include <cstdio>
+
+template<class F> static double measure( int n, F f )
+{
+    auto t1 = std::chrono::steady_clock::now();
+
+    f();
+
+    auto t2 = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>( t2 - t1 ).count() / n;
+}
+
+template<class T> static void run( char const* name, std::vector<T> const& values, char const* format )
+{
+    int const n = static_cast<int>( values.size() );
+
+    boost::json::array array;
+
+    for( auto v: values )
+    {
+        array.push_back( v );
+    }
+
+    boost::json::value data = { { "values", std::move( array ) } };
+
+    std::string out;
+
+    double r1 = measure( n, [&]{
+
+        out.clear();
+
+        for( auto const& v: values )
+        {
+            char buffer[ 32 ];
+            int m = std::snprintf( buffer, sizeof( buffer ), format, v );
+
+            out.append( buffer, m );
+            out += ' ';
+        }
+    });
+
+    double r2 = measure( n, [&]{
+
+        out.clear();
+        boost::mustache::render( "{{#values}}{{.}} {{/values}}", out, data, {} );
+    });
+
+    std::cout << name << ": snprintf " << r1 << " ns/number, render " << r2 << " ns/number" << std::endl;
+}
+
+int main()
+{
+    int const N = 1000000;
+
+    std::mt19937_64 rng( 1 );
+
+    {
+        std::vector<long long> values;
+
+        for( int i = 0; i < N; ++i )
+        {
+            values.push_back( static_cast<long long>( rng() >> ( i % 64 ) ) );
+        }
+
+        run( "int64 ", values, "%lld" );
+    }
+
+    {
+        std::uniform_real_distribution<double> d( 0, 1000 );
+
+        std::vector<double> values;
+
+        for( int i = 0; i < N; ++i )
+        {
+            values.push_back( d( rng ) );
+        }
+
+        run( "double", values, "%.16g" );
+    }
+
+    {
+        // prices, with two decimal places
+
+        std::vector<double> values;
+
+        for( int i = 0; i < N; ++i )
+        {
+            values.push_back( static_cast<double>( rng() % 100000 ) / 100 );
+        }
+
+        run( "price ", values, "%.16g" );
+    }
+}
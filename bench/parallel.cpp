@@ -0,0 +1,97 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// Measures the rendering of a list section over a large array
+// on a thread pool of 1, 2, 4, 8, and 16 threads, against the
+// rendering on the calling thread alone
+
+#include <boost/mustache/renderer.hpp>
+#include <boost/mustache/thread_pool.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <string>
+#include <iostream>
+
+static double measure( boost::mustache::compiled_template const& ct, boost::json::value const& data, boost::mustache::thread_pool* tp, std::size_t& size )
+{
+    boost::json::object const partials;
+
+    double best = 0;
+
+    for( int i = 0; i < 5; ++i )
+    {
+        std::string out;
+
+        auto t1 = std::chrono::steady_clock::now();
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+        rd.set_thread_pool( tp );
+
+        rd.render( ct, out );
+
+        auto t2 = std::chrono::steady_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>( t2 - t1 ).count();
+
+        if( i == 0 || ms < best )
+        {
+            best = ms;
+        }
+
+        size = out.size();
+    }
+
+    return best;
+}
+
+int main()
+{
+    std::size_t const N = 500000;
+
+    // rows of uneven cost, with a nested list every few rows
+
+    boost::json::array rows;
+
+    for( std::size_t i = 0; i < N; ++i )
+    {
+        boost::json::object row = { { "id", i }, { "name", "item " + std::to_string( i ) }, { "price", static_cast<double>( i % 10000 ) / 100 }, { "note", "<none> & \"n/a\"" } };
+
+        if( i % 7 == 0 )
+        {
+            row[ "tags" ] = { "a", "b", "c", "d" };
+        }
+
+        rows.push_back( std::move( row ) );
+    }
+
+    boost::json::value data = { { "title", "Report" }, { "rows", std::move( rows ) } };
+
+    boost::mustache::compiled_template ct(
+
+        "<h1>{{title}}</h1>\n"
+        "<table>\n"
+        "{{#rows}}\n"
+        "  <tr><td>{{id}}</td><td>{{name}}</td><td>{{price}}</td><td>{{note}}</td><td>{{#tags}}[{{.}}]{{/tags}}</td><td>{{title}}</td></tr>\n"
+        "{{/rows}}\n"
+        "</table>\n"
+    );
+
+    std::size_t size = 0;
+
+    double t0 = measure( ct, data, nullptr, size );
+
+    std::cout << "serial: " << t0 << " ms, " << size / t0 / 1e3 << " MB/s" << std::endl;
+
+    for( std::size_t threads: { 1, 2, 4, 8, 16 } )
+    {
+        // the calling thread renders as well, so a pool of
+        // threads - 1 workers uses the given number of threads
+
+        boost::mustache::thread_pool tp( threads - 1 );
+
+        double t1 = measure( ct, data, &tp, size );
+
+        std::cout << threads << " threads: " << t1 << " ms, " << size / t1 / 1e3 << " MB/s, " << t0 / t1 << "x" << std::endl;
+    }
+}
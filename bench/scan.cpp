@@ -0,0 +1,125 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// Measures the throughput of the literal scanning functions against
+// the byte-at-a-time loops they replace, and of rendering a template
+// that consists mostly of literal text
+
+#include "../src/scan.hpp"
+#include <boost/mustache/render.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <string>
+#include <iostream>
+
+static char const* find_either_bytewise( char const* p, char const* end, char c1, char c2 )
+{
+    while( p != end && *p != c1 && *p != c2 )
+    {
+        ++p;
+    }
+
+    return p;
+}
+
+static std::string make_text( std::size_t n )
+{
+    // long lines of markup with an occasional tag, as in a typical page
+
+    static char const line[] = "        <p class=\"text\">Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore.</p>\n";
+
+    std::string r;
+
+    while( r.size() < n )
+    {
+        r += line;
+        r += "        <p>{{title}}</p>\n";
+    }
+
+    return r;
+}
+
+template<class F> static void measure( char const* name, std::string const& text, F f )
+{
+    int const N = 200;
+
+    std::size_t hits = 0;
+
+    auto t1 = std::chrono::steady_clock::now();
+
+    for( int i = 0; i < N; ++i )
+    {
+        char const* p = text.data();
+        char const* end = p + text.size();
+
+        while( p != end )
+        {
+            p = f( p, end, '\n', '{' );
+
+            if( p != end )
+            {
+                ++hits;
+                ++p;
+            }
+        }
+    }
+
+    auto t2 = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>( t2 - t1 ).count();
+
+    std::cout << name << ": " << static_cast<double>( text.size() ) * N / ns << " bytes/ns (" << hits / N << " stops)" << std::endl;
+}
+
+int main()
+{
+    std::string text = make_text( 1 << 20 );
+
+    measure( "bytewise   ", text, &find_either_bytewise );
+    measure( "find_either", text, &boost::mustache::detail::find_either );
+
+    boost::json::value data = { { "title", "Title" } };
+
+    {
+        int const N = 20;
+
+        std::string out;
+
+        auto t1 = std::chrono::steady_clock::now();
+
+        for( int i = 0; i < N; ++i )
+        {
+            out.clear();
+            boost::mustache::render( text, out, data, {} );
+        }
+
+        auto t2 = std::chrono::steady_clock::now();
+
+        double ns = std::chrono::duration<double, std::nano>( t2 - t1 ).count();
+
+        std::cout << "render     : " << static_cast<double>( text.size() ) * N / ns << " bytes/ns" << std::endl;
+    }
+
+    {
+        int const N = 20;
+
+        boost::mustache::compiled_template ct( text );
+
+        std::string out;
+
+        auto t1 = std::chrono::steady_clock::now();
+
+        for( int i = 0; i < N; ++i )
+        {
+            out.clear();
+            boost::mustache::render( ct, out, data, {} );
+        }
+
+        auto t2 = std::chrono::steady_clock::now();
+
+        double ns = std::chrono::duration<double, std::nano>( t2 - t1 ).count();
+
+        std::cout << "compiled   : " << static_cast<double>( text.size() ) * N / ns << " bytes/ns" << std::endl;
+    }
+}
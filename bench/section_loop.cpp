@@ -0,0 +1,53 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// Renders a table with 1k, 10k, and 100k rows; the time per row
+// should stay the same as the number of rows grows
+
+#include <boost/mustache/render.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <string>
+#include <iostream>
+
+static char const tmpl[] =
+
+    "<table>\n"
+    "{{#rows}}\n"
+    "  <tr>\n"
+    "    <td>{{id}}</td>\n"
+    "    <td>{{name}}</td>\n"
+    "    {{#tags}}\n"
+    "    <td>{{.}}</td>\n"
+    "    {{/tags}}\n"
+    "  </tr>\n"
+    "{{/rows}}\n"
+    "</table>\n";
+
+int main()
+{
+    for( int n = 1000; n <= 100000; n *= 10 )
+    {
+        boost::json::array rows;
+
+        for( int i = 0; i < n; ++i )
+        {
+            rows.push_back( { { "id", i }, { "name", "Row " + std::to_string( i ) }, { "tags", { "a", "b", "c" } } } );
+        }
+
+        boost::json::value data = { { "rows", std::move( rows ) } };
+
+        std::string out;
+
+        auto t1 = std::chrono::steady_clock::now();
+
+        boost::mustache::render( tmpl, out, data, {} );
+
+        auto t2 = std::chrono::steady_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>( t2 - t1 ).count();
+
+        std::cout << n << " rows: " << ms << " ms, " << ms * 1e6 / n << " ns/row, " << out.size() << " bytes" << std::endl;
+    }
+}
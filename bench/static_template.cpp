@@ -0,0 +1,140 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// Compares rendering the templates of example/html.cpp from source,
+// from a compiled_template, and as a static_template parsed at compile
+// time, with described data used in place, for a varying number of items
+
+#include <boost/mustache/static_template.hpp>
+#include <boost/mustache/render.hpp>
+#include <boost/describe.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+
+struct item
+{
+    std::string title;
+    std::string author;
+    std::string link;
+};
+
+BOOST_DESCRIBE_STRUCT(item, (), (title, author, link))
+
+struct reference
+{
+    std::string heading;
+    std::vector<item> items;
+};
+
+BOOST_DESCRIBE_STRUCT(reference, (), (heading, items))
+
+constexpr char header[] =
+
+R"(<html>
+<head>
+  <title>{{heading}}</title>
+</head>
+<body>
+)";
+
+constexpr char footer[] =
+
+R"(</body>
+</html>
+)";
+
+constexpr char item_[] =
+
+R"(<li>
+  <strong>{{title}}</strong><br>
+  <em>{{author}}</em><br>
+  <a href="{{link}}">{{link}}</a>
+</li>
+)";
+
+constexpr char body[] =
+
+R"(<h1>{{heading}}</h1>
+<ul>
+{{#items}}
+  {{>item}}
+{{/items}}
+</ul>
+)";
+
+constexpr char html[] =
+
+R"({{>header}}
+  {{>body}}
+{{>footer}}
+)";
+
+constexpr boost::mustache::static_partial static_partials[] =
+{
+    { "header", header },
+    { "footer", footer },
+    { "item", item_ },
+    { "body", body },
+};
+
+template<class F> static double measure( F f )
+{
+    std::string out;
+
+    f( out );
+
+    double ns = 0;
+    std::size_t n = 1;
+
+    for( ;; )
+    {
+        auto t1 = std::chrono::steady_clock::now();
+
+        for( std::size_t i = 0; i < n; ++i )
+        {
+            out.clear();
+            f( out );
+        }
+
+        auto t2 = std::chrono::steady_clock::now();
+
+        ns = std::chrono::duration<double, std::nano>( t2 - t1 ).count();
+
+        if( ns >= 2e8 )
+        {
+            break;
+        }
+
+        n *= 2;
+    }
+
+    return ns / n;
+}
+
+int main()
+{
+    boost::json::object const partials = { { "header", header }, { "footer", footer }, { "item", item_ }, { "body", body } };
+
+    boost::mustache::compiled_template const compiled( html );
+    boost::mustache::static_template<html, static_partials> const st;
+
+    for( std::size_t n: { 3, 100, 10000 } )
+    {
+        reference ref = { "Reference", {} };
+
+        for( std::size_t i = 0; i < n; ++i )
+        {
+            std::string s = std::to_string( i );
+            ref.items.push_back( { "Title " + s, "Author " + s, "https://example.com/" + s + "?a=1&b=2" } );
+        }
+
+        double t1 = measure( [&]( std::string& out ){ boost::mustache::render( html, out, ref, partials ); } );
+        double t2 = measure( [&]( std::string& out ){ boost::mustache::render( compiled, out, ref, partials ); } );
+        double t3 = measure( [&]( std::string& out ){ render( st, out, ref ); } );
+
+        std::cout << n << " items: source " << t1 / 1000 << " us, compiled " << t2 / 1000 << " us, static " << t3 / 1000 << " us, " << t1 / t3 << "x / " << t2 / t3 << "x" << std::endl;
+    }
+}
@@ -0,0 +1,384 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// Renders a set of representative workloads, from source and from
+// a compiled template, and reports output throughput, renders per
+// second, time per tag, and allocations per render
+//
+// Usage: suite [--json] [filter]
+//
+// --json prints the results as a JSON array, for tracking them
+// between releases; filter selects the workloads whose name
+// contains it
+
+#include <boost/mustache.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// allocation counting
+
+static std::size_t allocations = 0;
+
+void* operator new( std::size_t n )
+{
+    ++allocations;
+
+    if( void* p = std::malloc( n? n: 1 ) )
+    {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete( void* p ) noexcept
+{
+    std::free( p );
+}
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+    std::free( p );
+}
+
+// workloads
+
+struct workload
+{
+    std::string name;
+
+    std::string tmpl;
+    boost::json::value data;
+    boost::json::object partials;
+
+    // the number of tags evaluated per render
+    std::size_t tags;
+};
+
+static std::string lorem( std::size_t i )
+{
+    static char const* const words[] = { "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "do", "eiusmod", "tempor" };
+    return words[ i % ( sizeof( words ) / sizeof( words[ 0 ] ) ) ];
+}
+
+// a large static page with a tag every couple of kilobytes
+
+static workload static_page()
+{
+    workload w{ "static_page", {}, { { "title", "Page Title" }, { "user", "someone" } }, {}, 0 };
+
+    w.tmpl = "<!DOCTYPE html>\n<html>\n<head><title>{{title}}</title></head>\n<body>\n";
+    w.tags = 1;
+
+    for( std::size_t i = 0; i < 100; ++i )
+    {
+        w.tmpl += "  <div class=\"section\">\n";
+
+        for( std::size_t j = 0; j < 20; ++j )
+        {
+            w.tmpl += "    <p>";
+
+            for( std::size_t k = 0; k < 12; ++k )
+            {
+                w.tmpl += lorem( i + j + k ) + " ";
+            }
+
+            w.tmpl += "</p>\n";
+        }
+
+        w.tmpl += "    <p>Logged in as {{user}}</p>\n  </div>\n";
+        ++w.tags;
+    }
+
+    w.tmpl += "</body>\n</html>\n";
+
+    return w;
+}
+
+// a table with many rows and columns
+
+static workload wide_table()
+{
+    workload w{ "wide_table", "<table>\n{{#items}}\n  <tr>", {}, {}, 1 };
+
+    std::size_t const rows = 1000;
+    std::size_t const cols = 10;
+
+    for( std::size_t j = 0; j < cols; ++j )
+    {
+        w.tmpl += "<td>{{c" + std::to_string( j ) + "}}</td>";
+    }
+
+    w.tmpl += "</tr>\n{{/items}}\n</table>\n";
+
+    boost::json::array items;
+
+    for( std::size_t i = 0; i < rows; ++i )
+    {
+        boost::json::object row;
+
+        for( std::size_t j = 0; j < cols; ++j )
+        {
+            row[ "c" + std::to_string( j ) ] = lorem( i * cols + j );
+        }
+
+        items.push_back( std::move( row ) );
+    }
+
+    w.data = { { "items", std::move( items ) } };
+    w.tags += rows * cols;
+
+    return w;
+}
+
+// five levels of nested lists, referring to names at every level
+
+static boost::json::value nested_level( int depth, std::size_t& tags )
+{
+    boost::json::array r;
+
+    for( int i = 0; i < 4; ++i )
+    {
+        boost::json::object level = { { "name", "n" + std::to_string( depth ) + std::to_string( i ) } };
+
+        if( depth < 5 )
+        {
+            level[ "children" ] = nested_level( depth + 1, tags );
+            tags += 2; // {{name}}, {{#children}}
+        }
+        else
+        {
+            tags += 2; // {{name}}, {{title}}
+        }
+
+        r.push_back( std::move( level ) );
+    }
+
+    return r;
+}
+
+static workload nested_sections()
+{
+    workload w{ "nested_sections", "{{title}}\n{{#children}}\n", {}, {}, 2 };
+
+    for( int i = 0; i < 4; ++i )
+    {
+        w.tmpl += "<ul><li>{{name}}\n{{#children}}\n";
+    }
+
+    w.tmpl += "<ul><li>{{name}} {{title}}</li></ul>\n";
+
+    for( int i = 0; i < 4; ++i )
+    {
+        w.tmpl += "{{/children}}\n</li></ul>\n";
+    }
+
+    w.tmpl += "{{/children}}\n";
+
+    boost::json::value children = nested_level( 1, w.tags );
+    w.data = { { "title", "Nested" }, { "children", std::move( children ) } };
+
+    return w;
+}
+
+// a page layout made of partials, as in example/html.cpp
+
+static workload layout_partials()
+{
+    workload w{ "layout_partials", "{{>header}}\n  {{>body}}\n{{>footer}}\n", {}, {}, 3 };
+
+    w.partials =
+    {
+        { "header", "<html>\n<head>\n  <title>{{heading}}</title>\n</head>\n<body>\n" },
+        { "footer", "</body>\n</html>\n" },
+        { "item", "<li>\n  <strong>{{title}}</strong><br>\n  <em>{{author}}</em><br>\n  <a href=\"{{link}}\">{{link}}</a>\n</li>\n" },
+        { "body", "<h1>{{heading}}</h1>\n<ul>\n{{#items}}\n  {{>item}}\n{{/items}}\n</ul>\n" },
+    };
+
+    std::size_t const n = 500;
+
+    boost::json::array items;
+
+    for( std::size_t i = 0; i < n; ++i )
+    {
+        items.push_back( { { "title", "Title " + std::to_string( i ) }, { "author", lorem( i ) }, { "link", "https://example.com/" + std::to_string( i ) } } );
+    }
+
+    w.data = { { "heading", "Reference" }, { "items", std::move( items ) } };
+    w.tags += 3 + n * 5;
+
+    return w;
+}
+
+// user content with a tenth of the characters needing escaping
+
+static workload heavy_escaping()
+{
+    workload w{ "heavy_escaping", "{{#comments}}<p class=\"comment\">{{text}}</p>\n{{/comments}}", {}, {}, 1 };
+
+    std::size_t const n = 1000;
+
+    boost::json::array comments;
+
+    for( std::size_t i = 0; i < n; ++i )
+    {
+        std::string text;
+
+        for( std::size_t j = 0; text.size() < 200; ++j )
+        {
+            text += lorem( i + j );
+            text += ( i + j ) % 2? " <b>&amp;</b> ": " \"q\" ";
+        }
+
+        comments.push_back( { { "text", text } } );
+    }
+
+    w.data = { { "comments", std::move( comments ) } };
+    w.tags += n;
+
+    return w;
+}
+
+// a table of integers, doubles and prices
+
+static workload numeric_table()
+{
+    workload w{ "numeric_table", "{{#rows}}<tr><td>{{id}}</td><td>{{value}}</td><td>{{price}}</td></tr>\n{{/rows}}", {}, {}, 1 };
+
+    std::size_t const n = 2000;
+
+    boost::json::array rows;
+
+    for( std::size_t i = 0; i < n; ++i )
+    {
+        rows.push_back( { { "id", i * 7919 }, { "value", static_cast<double>( i ) / 7 }, { "price", static_cast<double>( i * 37 % 10000 ) / 100 } } );
+    }
+
+    w.data = { { "rows", std::move( rows ) } };
+    w.tags += n * 3;
+
+    return w;
+}
+
+// measurement
+
+struct result
+{
+    std::string name;
+
+    double mb_per_s;
+    double renders_per_s;
+    double ns_per_tag;
+    double allocations_per_render;
+};
+
+template<class F> static result measure( std::string const& name, std::size_t tags, F f )
+{
+    std::string out;
+
+    // warm up, and let out reach its final capacity
+    f( out );
+
+    std::size_t const size = out.size();
+
+    double ns = 0;
+    std::size_t n = 1;
+    std::size_t allocs = 0;
+
+    for( ;; )
+    {
+        std::size_t a1 = allocations;
+        auto t1 = std::chrono::steady_clock::now();
+
+        for( std::size_t i = 0; i < n; ++i )
+        {
+            out.clear();
+            f( out );
+        }
+
+        auto t2 = std::chrono::steady_clock::now();
+        std::size_t a2 = allocations;
+
+        ns = std::chrono::duration<double, std::nano>( t2 - t1 ).count();
+        allocs = a2 - a1;
+
+        if( ns >= 2e8 )
+        {
+            break;
+        }
+
+        n *= 2;
+    }
+
+    double per_render = ns / n;
+
+    return { name, size / per_render * 1e3, 1e9 / per_render, per_render / tags, static_cast<double>( allocs ) / n };
+}
+
+int main( int argc, char const* argv[] )
+{
+    bool json = false;
+    char const* filter = "";
+
+    for( int i = 1; i < argc; ++i )
+    {
+        if( std::strcmp( argv[ i ], "--json" ) == 0 )
+        {
+            json = true;
+        }
+        else
+        {
+            filter = argv[ i ];
+        }
+    }
+
+    std::vector<workload> workloads = { static_page(), wide_table(), nested_sections(), layout_partials(), heavy_escaping(), numeric_table() };
+
+    std::vector<result> results;
+
+    for( workload const& w: workloads )
+    {
+        if( w.name.find( filter ) == std::string::npos )
+        {
+            continue;
+        }
+
+        results.push_back( measure( w.name + "/source", w.tags, [&]( std::string& out ){
+
+            boost::mustache::render( w.tmpl, out, w.data, w.partials );
+        }));
+
+        boost::mustache::compiled_template ct( w.tmpl );
+
+        results.push_back( measure( w.name + "/compiled", w.tags, [&]( std::string& out ){
+
+            boost::mustache::render( ct, out, w.data, w.partials );
+        }));
+    }
+
+    if( json )
+    {
+        boost::json::array r;
+
+        for( auto const& x: results )
+        {
+            r.push_back( { { "name", x.name }, { "mb_per_s", x.mb_per_s }, { "renders_per_s", x.renders_per_s }, { "ns_per_tag", x.ns_per_tag }, { "allocations_per_render", x.allocations_per_render } } );
+        }
+
+        std::cout << boost::json::serialize( r ) << std::endl;
+    }
+    else
+    {
+        for( auto const& x: results )
+        {
+            std::cout << x.name << ": " << x.mb_per_s << " MB/s, " << x.renders_per_s << " renders/s, " << x.ns_per_tag << " ns/tag, " << x.allocations_per_render << " allocations/render" << std::endl;
+        }
+    }
+}
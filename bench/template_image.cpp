@@ -0,0 +1,217 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// Compares the startup time of a process that compiles its templates
+// into a partial_registry with that of one that maps a template image,
+// written by partial_registry::write_image, for a varying number of
+// templates
+
+#include <boost/mustache/partial_registry.hpp>
+#include <boost/mustache/render.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+# define BENCH_HAS_MMAP
+#endif
+
+// a file mapped into memory, or read into an aligned buffer when mmap
+// isn't available
+
+class mapped_file
+{
+private:
+
+    char const* p_ = nullptr;
+    std::size_t n_ = 0;
+
+    std::vector<double> buffer_;
+
+public:
+
+    explicit mapped_file( char const* name )
+    {
+#if defined(BENCH_HAS_MMAP)
+
+        int fd = ::open( name, O_RDONLY );
+
+        struct stat st;
+        ::fstat( fd, &st );
+
+        n_ = static_cast<std::size_t>( st.st_size );
+        p_ = static_cast<char const*>( ::mmap( nullptr, n_, PROT_READ, MAP_PRIVATE, fd, 0 ) );
+
+        ::close( fd );
+
+#else
+
+        std::ifstream is( name, std::ios::binary );
+
+        is.seekg( 0, std::ios::end );
+        n_ = static_cast<std::size_t>( is.tellg() );
+        is.seekg( 0 );
+
+        buffer_.resize( n_ / sizeof( double ) + 1 );
+        is.read( reinterpret_cast<char*>( buffer_.data() ), n_ );
+
+        p_ = reinterpret_cast<char const*>( buffer_.data() );
+
+#endif
+    }
+
+    ~mapped_file()
+    {
+#if defined(BENCH_HAS_MMAP)
+
+        ::munmap( const_cast<char*>( p_ ), n_ );
+
+#endif
+    }
+
+    mapped_file( mapped_file const& ) = delete;
+    mapped_file& operator=( mapped_file const& ) = delete;
+
+    boost::core::string_view get() const noexcept
+    {
+        return { p_, n_ };
+    }
+};
+
+// n pages, each including a few of the shared partials and some of
+// the other pages, with a typical mix of sections and interpolations
+
+static boost::json::object make_templates( std::size_t n )
+{
+    boost::json::object r;
+
+    r[ "header" ] = "<html>\n<head>\n  <title>{{title}}</title>\n</head>\n<body>\n";
+    r[ "footer" ] = "</body>\n</html>\n";
+    r[ "item" ] = "<li>\n  <strong>{{title}}</strong><br>\n  <em>{{author}}</em><br>\n  <a href=\"{{link}}\">{{link}}</a>\n</li>\n";
+
+    for( std::size_t i = 0; i < n; ++i )
+    {
+        std::string s = std::to_string( i );
+
+        r[ "page" + s ] =
+
+            "{{>header}}\n"
+            "<h1>{{heading}} " + s + "</h1>\n"
+            "{{#user}}\n"
+            "  <p>Signed in as {{name}} ({{email}})</p>\n"
+            "{{/user}}\n"
+            "{{^user}}\n"
+            "  <p><a href=\"/login?next=/page/" + s + "\">Sign in</a></p>\n"
+            "{{/user}}\n"
+            "<ul>\n"
+            "{{#items}}\n"
+            "  {{>item}}\n"
+            "{{/items}}\n"
+            "</ul>\n"
+            "<p>See also {{>page" + std::to_string( ( i + 1 ) % n ) + "_link}}.</p>\n"
+            "{{>footer}}\n";
+
+        r[ "page" + s + "_link" ] = "<a href=\"/page/" + s + "\">{{heading}} " + s + "</a>";
+    }
+
+    return r;
+}
+
+template<class F> static double measure( F f )
+{
+    double ns = 0;
+    std::size_t n = 1;
+
+    for( ;; )
+    {
+        auto t1 = std::chrono::steady_clock::now();
+
+        for( std::size_t i = 0; i < n; ++i )
+        {
+            f();
+        }
+
+        auto t2 = std::chrono::steady_clock::now();
+
+        ns = std::chrono::duration<double, std::nano>( t2 - t1 ).count();
+
+        if( ns >= 2e8 )
+        {
+            break;
+        }
+
+        n *= 2;
+    }
+
+    return ns / n;
+}
+
+int main()
+{
+    char const* name = "boost_mustache_bench_template_image.bin";
+
+    boost::json::value data =
+    {
+        { "title", "Reference" },
+        { "heading", "Page" },
+        { "items", { { { "title", "Title" }, { "author", "Author" }, { "link", "https://example.com/?a=1&b=2" } } } },
+    };
+
+    for( std::size_t n: { 100, 1000, 10000 } )
+    {
+        boost::json::object templates = make_templates( n );
+
+        // the templates, as read from their files at startup, and the image
+
+        {
+            boost::mustache::partial_registry r1( templates );
+
+            std::string image;
+            r1.write_image( image );
+
+            std::ofstream os( name, std::ios::binary );
+            os.write( image.data(), image.size() );
+        }
+
+        std::size_t image_size = 0;
+        std::string r1, r2;
+
+        double t1 = measure( [&]{
+
+            boost::mustache::partial_registry r( templates );
+
+            r1.clear();
+            boost::mustache::render( *r.find( "page0" ), r1, data, r );
+        });
+
+        double t2 = measure( [&]{
+
+            mapped_file f( name );
+            boost::mustache::partial_registry r( boost::mustache::borrow, f.get() );
+
+            image_size = f.get().size();
+
+            r2.clear();
+            boost::mustache::render( *r.find( "page0" ), r2, data, r );
+        });
+
+        if( r1 != r2 )
+        {
+            std::cerr << "Error: the output of the image doesn't match" << std::endl;
+            return 1;
+        }
+
+        std::cout << n * 2 + 3 << " templates: compiled " << t1 / 1e6 << " ms, mapped " << t2 / 1e6 << " ms (" << image_size / 1024 << " KB), " << t1 / t2 << "x" << std::endl;
+    }
+
+    std::remove( name );
+}
@@ -6,5 +6,16 @@
 // https://www.boost.org/LICENSE_1_0.txt
 
 #include <boost/mustache/render.hpp>
+#include <boost/mustache/compiled_template.hpp>
+#include <boost/mustache/partial_registry.hpp>
+#include <boost/mustache/template_cache.hpp>
+#include <boost/mustache/template_set.hpp>
+#include <boost/mustache/data_ref.hpp>
+#include <boost/mustache/buffered_output.hpp>
+#include <boost/mustache/render_stats.hpp>
+#include <boost/mustache/thread_pool.hpp>
+#include <boost/mustache/lazy_range.hpp>
+#include <boost/mustache/stream_renderer.hpp>
+#include <boost/mustache/generated.hpp>
 
 #endif // #ifndef BOOST_MUSTACHE_HPP_INCLUDED
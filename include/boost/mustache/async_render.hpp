@@ -0,0 +1,190 @@
+#ifndef BOOST_MUSTACHE_ASYNC_RENDER_HPP_INCLUDED
+#define BOOST_MUSTACHE_ASYNC_RENDER_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/renderer.hpp>
+#include <boost/mustache/compiled_template.hpp>
+#include <boost/core/detail/string_view.hpp>
+#include <boost/config.hpp>
+#include <boost/assert.hpp>
+
+#if defined(BOOST_NO_CXX20_HDR_COROUTINE)
+# error "<boost/mustache/async_render.hpp> requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <cstddef>
+
+namespace boost
+{
+namespace mustache
+{
+
+// a coroutine that starts when awaited, or when start is called,
+// and resumes its awaiter when it completes
+
+class render_task
+{
+public:
+
+    struct promise_type;
+
+private:
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    handle_type h_;
+
+    struct final_awaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        std::coroutine_handle<> await_suspend( handle_type h ) noexcept
+        {
+            return h.promise().continuation_;
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    explicit render_task( handle_type h ) noexcept: h_( h )
+    {
+    }
+
+public:
+
+    struct promise_type
+    {
+        std::coroutine_handle<> continuation_ = std::noop_coroutine();
+        std::exception_ptr ex_;
+
+        render_task get_return_object() noexcept
+        {
+            return render_task( handle_type::from_promise( *this ) );
+        }
+
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        final_awaiter final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void return_void() const noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            ex_ = std::current_exception();
+        }
+    };
+
+    render_task( render_task&& r ) noexcept: h_( std::exchange( r.h_, {} ) )
+    {
+    }
+
+    render_task& operator=( render_task&& r ) noexcept
+    {
+        std::swap( h_, r.h_ );
+        return *this;
+    }
+
+    ~render_task()
+    {
+        if( h_ )
+        {
+            h_.destroy();
+        }
+    }
+
+    // for callers that aren't coroutines
+
+    void start()
+    {
+        BOOST_ASSERT( h_ && !h_.done() );
+        h_.resume();
+    }
+
+    bool done() const noexcept
+    {
+        return h_.done();
+    }
+
+    // rethrows the exception the task has completed with, if any
+    void get() const
+    {
+        BOOST_ASSERT( h_.done() );
+
+        if( h_.promise().ex_ )
+        {
+            std::rethrow_exception( h_.promise().ex_ );
+        }
+    }
+
+    // for coroutines
+
+    bool await_ready() const noexcept
+    {
+        return h_.done();
+    }
+
+    std::coroutine_handle<> await_suspend( std::coroutine_handle<> h ) noexcept
+    {
+        h_.promise().continuation_ = h;
+        return h_;
+    }
+
+    void await_resume() const
+    {
+        get();
+    }
+};
+
+// renders tmpl with rd by read, into a buffer of n characters, and
+// writes each full buffer by co_await sink.write( sv ), which must
+// not complete until sv is no longer needed
+//
+// the task starts when awaited or started, not when called, and refers
+// to rd, tmpl, and sink, which must outlive it; a temporary template
+// would be destroyed before the task starts, so it's rejected
+
+template<class Sink> render_task async_render( renderer& rd, compiled_template const& tmpl, Sink& sink, std::size_t n = 4096 )
+{
+    BOOST_ASSERT( n != 0 );
+
+    std::unique_ptr<char[]> buffer( new char[ n ] );
+
+    rd.start( tmpl );
+
+    while( !rd.done() )
+    {
+        core::string_view sv = rd.read( buffer.get(), n );
+
+        if( !sv.empty() )
+        {
+            co_await sink.write( sv );
+        }
+    }
+}
+
+template<class Sink> render_task async_render( renderer& rd, compiled_template&& tmpl, Sink& sink, std::size_t n = 4096 ) = delete;
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_ASYNC_RENDER_HPP_INCLUDED
@@ -0,0 +1,91 @@
+#ifndef BOOST_MUSTACHE_BUFFERED_OUTPUT_HPP_INCLUDED
+#define BOOST_MUSTACHE_BUFFERED_OUTPUT_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/output_ref.hpp>
+#include <boost/core/detail/string_view.hpp>
+#include <cstring>
+#include <cstddef>
+
+namespace boost
+{
+namespace mustache
+{
+
+// collects small writes into a caller-provided buffer, and passes
+// them to the underlying output when the buffer fills up, or on flush
+
+class buffered_output
+{
+private:
+
+    output_ref out_;
+
+    char* first_;
+    char* last_;
+    char* p_;
+
+public:
+
+    // allows output_ref to refer to a buffered_output
+    using value_type = char;
+
+    buffered_output( output_ref out, char* buffer, std::size_t size ) noexcept:
+        out_( out ), first_( buffer ), last_( buffer + size ), p_( buffer )
+    {
+    }
+
+    buffered_output( buffered_output const& ) = delete;
+    buffered_output& operator=( buffered_output const& ) = delete;
+
+    void write( core::string_view sv )
+    {
+        std::size_t n = sv.size();
+
+        if( n <= static_cast<std::size_t>( last_ - p_ ) )
+        {
+            if( n != 0 )
+            {
+                std::memcpy( p_, sv.data(), n );
+                p_ += n;
+            }
+        }
+        else
+        {
+            flush();
+
+            if( n < static_cast<std::size_t>( last_ - first_ ) )
+            {
+                std::memcpy( p_, sv.data(), n );
+                p_ += n;
+            }
+            else
+            {
+                // doesn't fit, write directly
+                out_.write( sv );
+            }
+        }
+    }
+
+    void append( char const* first, char const* last )
+    {
+        write( { first, static_cast<std::size_t>( last - first ) } );
+    }
+
+    void flush()
+    {
+        if( p_ != first_ )
+        {
+            out_.write( { first_, static_cast<std::size_t>( p_ - first_ ) } );
+            p_ = first_;
+        }
+    }
+};
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_BUFFERED_OUTPUT_HPP_INCLUDED
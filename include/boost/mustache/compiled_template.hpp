@@ -0,0 +1,170 @@
+#ifndef BOOST_MUSTACHE_COMPILED_TEMPLATE_HPP_INCLUDED
+#define BOOST_MUSTACHE_COMPILED_TEMPLATE_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/config.hpp>
+#include <boost/core/detail/string_view.hpp>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace boost
+{
+namespace mustache
+{
+
+class renderer;
+class stream_renderer;
+class code_generator;
+class partial_registry;
+class template_cache;
+
+class compiled_template
+{
+private:
+
+    friend class renderer;
+    friend class stream_renderer;
+    friend class partial_registry;
+    friend class template_cache;
+
+    // in tools/codegen.cpp
+    friend class code_generator;
+
+    class compiler;
+
+    enum opcode
+    {
+        // outputs text_[ first, first + size ); if arg is nonzero,
+        // the text starts a line, and every line in it is indented
+        op_literal,
+
+        // outputs the indentation before a line that starts with a tag
+        op_indent,
+
+        // outputs the value of the name segments_[ first, first + size ),
+        // HTML-escaped or as-is
+        op_escaped,
+        op_unescaped,
+
+        // the name is segments_[ first, first + size ), the section
+        // contents are the next arg instructions
+        op_section,
+        op_inverted_section,
+
+        // the name of the partial is text_[ first, first + size ); a
+        // standalone partial is additionally indented by text_[ arg, arg + arg_size )
+        op_partial,
+        op_standalone_partial,
+    };
+
+    struct instruction
+    {
+        std::uint32_t op;
+        std::uint32_t first;
+        std::uint32_t size;
+        std::uint32_t arg;
+        std::uint32_t arg_size;
+    };
+
+    // a component of a dotted name, text_[ first, first + size )
+    struct segment
+    {
+        std::uint32_t first;
+        std::uint32_t size;
+    };
+
+    // a read-only view of an array, in the buffers below, or in the
+    // template image the template has been loaded from
+
+    template<class T> class array_view
+    {
+    private:
+
+        T const* p_ = nullptr;
+        std::size_t n_ = 0;
+
+    public:
+
+        array_view() = default;
+
+        array_view( T const* p, std::size_t n ) noexcept: p_( p ), n_( n )
+        {
+        }
+
+        array_view( std::vector<T> const& v ) noexcept: p_( v.data() ), n_( v.size() )
+        {
+        }
+
+        T const* data() const noexcept { return p_; }
+        std::size_t size() const noexcept { return n_; }
+        bool empty() const noexcept { return n_ == 0; }
+
+        T const* begin() const noexcept { return p_; }
+        T const* end() const noexcept { return p_ + n_; }
+
+        T const& operator[]( std::size_t i ) const noexcept { return p_[ i ]; }
+    };
+
+    // the template text, referenced by code_ and segments_
+    core::string_view text_;
+
+    // the instructions, in execution order
+    array_view<instruction> code_;
+
+    // the components of the names referenced by code_; "." has none
+    array_view<segment> segments_;
+
+    // the partials referenced by the partial instructions in code_, by
+    // instruction, as resolved by the partial registry linked_; empty
+    // when not linked
+    partial_registry const* linked_ = nullptr;
+    array_view<compiled_template const*> links_;
+
+    // whether the views above refer to a template image, rather than
+    // to the buffers below
+    bool image_ = false;
+
+    // a copy of the template text, and the compiled code
+    std::string text_buffer_;
+    std::vector<instruction> code_buffer_;
+    std::vector<segment> segments_buffer_;
+    std::vector<compiled_template const*> links_buffer_;
+
+private:
+
+    // points the views to the buffers, unless image_
+    BOOST_MUSTACHE_DECL void bind() noexcept;
+
+    // used by the renderer for section contents, which don't necessarily
+    // start at the beginning of a line, and whose end isn't a line end
+
+    BOOST_MUSTACHE_DECL compiled_template( core::string_view tmpl, core::string_view start_delim, core::string_view end_delim, bool line_start, bool eof_line_end );
+
+    // an empty template, and recompilation into the existing buffers,
+    // for the renderer to keep the section contents without reallocating
+
+    compiled_template() = default;
+
+    BOOST_MUSTACHE_DECL void assign( core::string_view tmpl, core::string_view start_delim, core::string_view end_delim, bool line_start, bool eof_line_end );
+
+public:
+
+    BOOST_MUSTACHE_DECL explicit compiled_template( core::string_view tmpl, core::string_view start_delim = "{{", core::string_view end_delim = "}}" );
+    BOOST_MUSTACHE_DECL ~compiled_template();
+
+    BOOST_MUSTACHE_DECL compiled_template( compiled_template const& r );
+    BOOST_MUSTACHE_DECL compiled_template( compiled_template&& r ) noexcept;
+
+    BOOST_MUSTACHE_DECL compiled_template& operator=( compiled_template const& r );
+    BOOST_MUSTACHE_DECL compiled_template& operator=( compiled_template&& r ) noexcept;
+};
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_COMPILED_TEMPLATE_HPP_INCLUDED
@@ -0,0 +1,1023 @@
+#ifndef BOOST_MUSTACHE_DATA_REF_HPP_INCLUDED
+#define BOOST_MUSTACHE_DATA_REF_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/output_ref.hpp>
+#include <boost/mustache/detail/storage_allocator.hpp>
+#include <boost/mustache/config.hpp>
+#include <boost/json/value.hpp>
+#include <boost/json/object.hpp>
+#include <boost/json/array.hpp>
+#include <boost/json/value_from.hpp>
+#include <boost/describe/members.hpp>
+#include <boost/describe/modifiers.hpp>
+#include <boost/mp11/algorithm.hpp>
+#include <boost/mp11/utility.hpp>
+#include <boost/core/detail/string_view.hpp>
+#include <type_traits>
+#include <deque>
+#include <new>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace boost
+{
+namespace mustache
+{
+
+class data_ref;
+
+namespace detail
+{
+
+// formatting of scalar values
+
+BOOST_MUSTACHE_DECL void output_string( core::string_view sv, output_ref out, bool quoted );
+BOOST_MUSTACHE_DECL void output_bool( bool v, output_ref out, bool quoted );
+BOOST_MUSTACHE_DECL void output_int64( std::int64_t v, output_ref out, bool quoted );
+BOOST_MUSTACHE_DECL void output_uint64( std::uint64_t v, output_ref out, bool quoted );
+BOOST_MUSTACHE_DECL void output_double( double v, output_ref out, bool quoted );
+BOOST_MUSTACHE_DECL void output_json( json::value const& jv, output_ref out, bool quoted );
+
+// JSON serialization of composite values
+
+BOOST_MUSTACHE_DECL void serialize_string( core::string_view sv, output_ref out, bool quoted );
+BOOST_MUSTACHE_DECL void serialize_json( json::value const& jv, output_ref out, bool quoted );
+
+// data categories, in order of precedence
+
+struct data_null_tag {};
+struct data_bool_tag {};
+struct data_int64_tag {};
+struct data_uint64_tag {};
+struct data_double_tag {};
+struct data_string_tag {};
+struct data_optional_tag {};
+struct data_map_tag {};
+struct data_range_tag {};
+struct data_described_tag {};
+struct data_json_tag {};
+
+template<class T, class E = void> struct is_optional_like: std::false_type {};
+
+template<class T> struct is_optional_like<T, decltype( (void)sizeof( typename T::value_type ), (void)*std::declval<T const&>(), (void)static_cast<bool>( std::declval<T const&>() ) )>: std::true_type {};
+
+template<class T, class E = void> struct is_map_like: std::false_type {};
+
+template<class T> struct is_map_like<T, decltype( (void)sizeof( typename T::mapped_type ), (void)std::declval<T const&>().find( std::declval<typename T::key_type const&>() )->second )>:
+    std::is_constructible<typename T::key_type, char const*, std::size_t> {};
+
+template<> struct is_map_like<json::object>: std::true_type {};
+
+template<class T, class E = void> struct is_range: std::false_type {};
+
+template<class T> struct is_range<T, decltype( (void)( std::declval<T const&>().begin() != std::declval<T const&>().end() ) )>: std::true_type {};
+
+#if defined(BOOST_DESCRIBE_CXX14)
+
+template<class T> using is_described_class_impl = std::integral_constant<bool, std::is_class<T>::value && describe::has_describe_members<T>::value>;
+
+#else
+
+template<class T> using is_described_class_impl = std::false_type;
+
+#endif
+
+// types converted to JSON by a tag_invoke overload of their own are
+// accessed through the conversion, even when described
+
+template<class T, class E = void> struct has_value_from_tag_invoke: std::false_type {};
+
+template<class T> struct has_value_from_tag_invoke<T, decltype( (void)tag_invoke( json::value_from_tag(), std::declval<json::value&>(), std::declval<T const&>() ) )>: std::true_type {};
+
+template<class T> using data_category = mp11::mp_cond<
+
+    std::is_same<T, std::nullptr_t>, data_null_tag,
+    std::is_same<T, bool>, data_bool_tag,
+    std::is_integral<T>, mp11::mp_if<std::is_signed<T>, data_int64_tag, data_uint64_tag>,
+    std::is_floating_point<T>, data_double_tag,
+    std::is_convertible<T const&, core::string_view>, data_string_tag,
+    is_optional_like<T>, data_optional_tag,
+    is_map_like<T>, data_map_tag,
+    is_range<T>, data_range_tag,
+    has_value_from_tag_invoke<T>, data_json_tag,
+    is_described_class_impl<T>, data_described_tag,
+    mp11::mp_true, data_json_tag
+>;
+
+template<class T> using is_described_class = std::is_same<data_category<T>, data_described_tag>;
+
+// the values converted with value_from for a lookup in them, kept until
+// released so that the result of the lookup remains valid; a renderer
+// installs its store on the current thread with data_store_scope while
+// rendering, and releases the values pushed for an element of a list
+// when the element is done, except those pinned for the whole list
+
+class data_store
+{
+private:
+
+    json::storage_ptr sp_;
+    std::deque<json::value, storage_allocator<json::value>> values_;
+
+    // the number of values release keeps
+    std::size_t pinned_ = 0;
+
+public:
+
+    explicit data_store( json::storage_ptr sp = {} ): sp_( std::move( sp ) ), values_( storage_allocator<json::value>( sp_ ) )
+    {
+    }
+
+    data_store( data_store const& ) = delete;
+    data_store& operator=( data_store const& ) = delete;
+
+    json::storage_ptr const& storage() const noexcept
+    {
+        return sp_;
+    }
+
+    json::value const& push( json::value&& jv )
+    {
+        values_.push_back( std::move( jv ) );
+        return values_.back();
+    }
+
+    std::size_t size() const noexcept
+    {
+        return values_.size();
+    }
+
+    // removes the values pushed after the first n, unless pinned
+    void release( std::size_t n ) noexcept
+    {
+        if( n < pinned_ )
+        {
+            n = pinned_;
+        }
+
+        while( values_.size() > n )
+        {
+            values_.pop_back();
+        }
+    }
+
+    // keeps the values pushed so far until unpinned
+    void pin() noexcept
+    {
+        pinned_ = values_.size();
+    }
+
+    std::size_t pinned() const noexcept
+    {
+        return pinned_;
+    }
+
+    // restores the value of pinned() returned before the matching pins
+    void unpin( std::size_t n ) noexcept
+    {
+        pinned_ = n;
+    }
+
+    void clear() noexcept
+    {
+        values_.clear();
+        pinned_ = 0;
+    }
+
+    // the store installed on the current thread, or nullptr
+    BOOST_MUSTACHE_DECL static data_store* current() noexcept;
+
+    friend class data_store_scope;
+};
+
+class data_store_scope
+{
+private:
+
+    data_store* prev_;
+
+public:
+
+    BOOST_MUSTACHE_DECL explicit data_store_scope( data_store& st ) noexcept;
+    BOOST_MUSTACHE_DECL ~data_store_scope();
+
+    data_store_scope( data_store_scope const& ) = delete;
+    data_store_scope& operator=( data_store_scope const& ) = delete;
+};
+
+class data_cursor;
+
+} // namespace detail
+
+// a non-owning reference to a data value of any supported type;
+// JSON values, strings, numbers, optionals, maps, ranges, and
+// described classes are accessed directly, other types are
+// converted to JSON with value_from when needed; the result of
+// a lookup in a converted value refers to a copy in the current
+// detail::data_store, and is empty when there is none
+
+class data_ref
+{
+public:
+
+    using callback = void (*)( void * ctx, data_ref item );
+
+private:
+
+    struct vtable
+    {
+        // whether a section on the value is rendered
+        bool (*is_true)( void const * p );
+
+        // the member with the given name, or an empty reference
+        data_ref (*lookup)( void const * p, core::string_view name );
+
+        // calls f for each element and returns true, if the value is a list
+        bool (*for_each)( void const * p, void * ctx, callback f );
+
+        // the value to access repeatedly in place of this one
+        data_ref (*convert)( void const * p );
+
+        // starts an iteration over the elements in c, with its state
+        // allocated from mr, and returns true, if the value is a list
+        bool (*begin)( void const * p, detail::data_cursor& c, json::memory_resource* mr );
+
+        // outputs the value, HTML-escaped if quoted
+        void (*output)( void const * p, output_ref out, bool quoted );
+    };
+
+    template<class T> struct impl;
+
+    void const * p_ = nullptr;
+    vtable const * vt_ = nullptr;
+
+    BOOST_MUSTACHE_DECL static vtable const* json_vtable() noexcept;
+
+public:
+
+    // an empty reference, denoting a missing value
+    data_ref() noexcept = default;
+
+    data_ref( json::value const& jv ) noexcept: p_( &jv ), vt_( json_vtable() )
+    {
+    }
+
+    template<class T, class En = typename std::enable_if<!std::is_same<T, data_ref>::value && !std::is_same<T, json::value>::value>::type>
+    data_ref( T const& v ) noexcept: p_( &v ), vt_( &impl<T>::vt )
+    {
+    }
+
+    bool empty() const noexcept
+    {
+        return vt_ == nullptr;
+    }
+
+    bool is_true() const
+    {
+        return vt_ && vt_->is_true( p_ );
+    }
+
+    data_ref lookup( core::string_view name ) const
+    {
+        return vt_? vt_->lookup( p_, name ): data_ref();
+    }
+
+    bool for_each( void * ctx, callback f ) const
+    {
+        return vt_ && vt_->for_each( p_, ctx, f );
+    }
+
+    bool begin( detail::data_cursor& c, json::memory_resource* mr ) const
+    {
+        return vt_ && vt_->begin( p_, c, mr );
+    }
+
+    // the value to access in place of this one, when it's accessed more
+    // than once: the conversion of a value converted to JSON, pushed onto
+    // the current data store, or the value of an engaged optional
+    data_ref convert() const
+    {
+        return vt_? vt_->convert( p_ ): data_ref();
+    }
+
+    void output( output_ref out, bool quoted ) const
+    {
+        if( vt_ )
+        {
+            vt_->output( p_, out, quoted );
+        }
+    }
+
+    // the JSON value referred to, or nullptr if *this doesn't
+    // refer to a json::value
+    json::value const* if_json() const noexcept
+    {
+        return vt_ && vt_ == json_vtable()? static_cast<json::value const*>( p_ ): nullptr;
+    }
+};
+
+namespace detail
+{
+
+// an iteration over the elements of a list, one at a time, for the pull
+// mode of the renderer, which returns to its caller between the elements
+// and so can't use for_each; started by data_ref::begin, with its state
+// allocated from a memory resource, and ended by release with the same
+// resource. Copies refer to the same iteration
+
+class data_cursor
+{
+private:
+
+    struct vtable
+    {
+        data_ref (*get)( void * p );
+        void (*next)( void * p );
+        void (*destroy)( void * p, json::memory_resource* mr ) noexcept;
+    };
+
+    template<class S> struct impl
+    {
+        static data_ref get( void * p )
+        {
+            return static_cast<S*>( p )->get();
+        }
+
+        static void next( void * p )
+        {
+            static_cast<S*>( p )->next();
+        }
+
+        static void destroy( void * p, json::memory_resource* mr ) noexcept
+        {
+            static_cast<S*>( p )->~S();
+            mr->deallocate( p, sizeof( S ), alignof( S ) );
+        }
+
+        static constexpr vtable vt = { &get, &next, &destroy };
+    };
+
+    void * p_ = nullptr;
+    vtable const * vt_ = nullptr;
+
+public:
+
+    // a cursor whose state is an S constructed from a; S has
+    // the member functions get and next, as below
+    template<class S, class... A> static data_cursor make( json::memory_resource* mr, A&&... a )
+    {
+        void * p = mr->allocate( sizeof( S ), alignof( S ) );
+
+        try
+        {
+            ::new( p ) S( std::forward<A>( a )... );
+        }
+        catch( ... )
+        {
+            mr->deallocate( p, sizeof( S ), alignof( S ) );
+            throw;
+        }
+
+        data_cursor r;
+
+        r.p_ = p;
+        r.vt_ = &impl<S>::vt;
+
+        return r;
+    }
+
+    // whether no iteration has been started
+    bool empty() const noexcept
+    {
+        return vt_ == nullptr;
+    }
+
+    // the current element, or an empty reference after the last one;
+    // called once per element, since the result may refer to the state
+    data_ref get() const
+    {
+        return vt_->get( p_ );
+    }
+
+    void next() const
+    {
+        vt_->next( p_ );
+    }
+
+    void release( json::memory_resource* mr ) noexcept
+    {
+        if( vt_ )
+        {
+            vt_->destroy( p_, mr );
+
+            p_ = nullptr;
+            vt_ = nullptr;
+        }
+    }
+};
+
+template<class S> constexpr data_cursor::vtable data_cursor::impl<S>::vt;
+
+// the elements of a JSON array
+
+class json_array_cursor
+{
+private:
+
+    json::array const* a_;
+    std::size_t i_ = 0;
+
+public:
+
+    explicit json_array_cursor( json::array const& a ) noexcept: a_( &a )
+    {
+    }
+
+    data_ref get() const noexcept
+    {
+        return i_ < a_->size()? data_ref( ( *a_ )[ i_ ] ): data_ref();
+    }
+
+    void next() noexcept
+    {
+        ++i_;
+    }
+};
+
+// the elements of a value converted to a JSON array, held by the cursor
+
+class converted_cursor
+{
+private:
+
+    json::value jv_;
+    json_array_cursor c_;
+
+public:
+
+    explicit converted_cursor( json::value&& jv ): jv_( std::move( jv ) ), c_( jv_.get_array() )
+    {
+    }
+
+    data_ref get() const noexcept
+    {
+        return c_.get();
+    }
+
+    void next() noexcept
+    {
+        c_.next();
+    }
+};
+
+// the elements of a range; those returned by value by the iterator
+// are copied into the cursor, one at a time
+
+template<class R, class E = decltype( *std::declval<R const&>().begin() ), bool = std::is_reference<E>::value> class range_cursor
+{
+private:
+
+    decltype( std::declval<R const&>().begin() ) it_;
+    decltype( std::declval<R const&>().end() ) last_;
+
+public:
+
+    explicit range_cursor( R const& r ): it_( r.begin() ), last_( r.end() )
+    {
+    }
+
+    data_ref get() const
+    {
+        return it_ != last_? data_ref( *it_ ): data_ref();
+    }
+
+    void next()
+    {
+        ++it_;
+    }
+};
+
+template<class R, class E> class range_cursor<R, E, false>
+{
+private:
+
+    using value_type = typename std::decay<E>::type;
+
+    decltype( std::declval<R const&>().begin() ) it_;
+    decltype( std::declval<R const&>().end() ) last_;
+
+    alignas( value_type ) unsigned char buffer_[ sizeof( value_type ) ];
+    bool has_value_ = false;
+
+    void clear() noexcept
+    {
+        if( has_value_ )
+        {
+            reinterpret_cast<value_type*>( buffer_ )->~value_type();
+            has_value_ = false;
+        }
+    }
+
+public:
+
+    explicit range_cursor( R const& r ): it_( r.begin() ), last_( r.end() )
+    {
+    }
+
+    ~range_cursor()
+    {
+        clear();
+    }
+
+    range_cursor( range_cursor const& ) = delete;
+    range_cursor& operator=( range_cursor const& ) = delete;
+
+    data_ref get()
+    {
+        clear();
+
+        if( !( it_ != last_ ) )
+        {
+            return data_ref();
+        }
+
+        value_type* p = ::new( static_cast<void*>( buffer_ ) ) value_type( *it_ );
+        has_value_ = true;
+
+        return data_ref( *p );
+    }
+
+    void next()
+    {
+        ++it_;
+    }
+};
+
+} // namespace detail
+
+template<class T> struct data_ref::impl
+{
+    using category = detail::data_category<T>;
+
+    static T const& get( void const * p )
+    {
+        return *static_cast<T const*>( p );
+    }
+
+    // is_true
+
+    static bool is_true( void const* /*p*/, detail::data_null_tag )
+    {
+        return false;
+    }
+
+    static bool is_true( void const* p, detail::data_bool_tag )
+    {
+        return get( p );
+    }
+
+    static bool is_true( void const* p, detail::data_int64_tag )
+    {
+        return get( p ) != 0;
+    }
+
+    static bool is_true( void const* p, detail::data_uint64_tag )
+    {
+        return get( p ) != 0;
+    }
+
+    static bool is_true( void const* p, detail::data_double_tag )
+    {
+        return get( p ) != 0;
+    }
+
+    static bool is_true( void const* p, detail::data_string_tag )
+    {
+        return !core::string_view( get( p ) ).empty();
+    }
+
+    static bool is_true( void const* p, detail::data_optional_tag )
+    {
+        T const& v = get( p );
+        return static_cast<bool>( v ) && data_ref( *v ).is_true();
+    }
+
+    static bool is_true( void const* /*p*/, detail::data_map_tag )
+    {
+        return true;
+    }
+
+    // ranges with empty() are tested with it, so that single-pass
+    // ranges aren't consumed
+
+    template<class R> static auto range_empty( R const& v, int ) -> decltype( v.empty() )
+    {
+        return v.empty();
+    }
+
+    template<class R> static bool range_empty( R const& v, long )
+    {
+        return !( v.begin() != v.end() );
+    }
+
+    static bool is_true( void const* p, detail::data_range_tag )
+    {
+        return !range_empty( get( p ), 0 );
+    }
+
+    static bool is_true( void const* /*p*/, detail::data_described_tag )
+    {
+        return true;
+    }
+
+    static bool is_true( void const* p, detail::data_json_tag )
+    {
+        json::value jv = json::value_from( get( p ) );
+        return data_ref( jv ).is_true();
+    }
+
+    static bool is_true_( void const* p )
+    {
+        return is_true( p, category() );
+    }
+
+    // lookup
+
+    template<class Tag> static data_ref lookup( void const* /*p*/, core::string_view /*name*/, Tag )
+    {
+        return data_ref();
+    }
+
+    static data_ref lookup( void const* p, core::string_view name, detail::data_optional_tag )
+    {
+        T const& v = get( p );
+        return v? data_ref( *v ).lookup( name ): data_ref();
+    }
+
+    template<class M> static data_ref map_lookup( M const& m, core::string_view name )
+    {
+        auto it = m.find( typename M::key_type( name.data(), name.size() ) );
+        return it != m.end()? data_ref( it->second ): data_ref();
+    }
+
+    static data_ref map_lookup( json::object const& m, core::string_view name )
+    {
+        json::value const* p = m.if_contains( name );
+        return p? data_ref( *p ): data_ref();
+    }
+
+    static data_ref lookup( void const* p, core::string_view name, detail::data_map_tag )
+    {
+        return map_lookup( get( p ), name );
+    }
+
+#if defined(BOOST_DESCRIBE_CXX14)
+
+    static data_ref lookup( void const* p, core::string_view name, detail::data_described_tag )
+    {
+        using Md = describe::describe_members<T, describe::mod_public | describe::mod_inherited>;
+
+        T const& v = get( p );
+        data_ref r;
+
+        mp11::mp_for_each<Md>( [&]( auto D ){
+
+            if( r.empty() && name == D.name )
+            {
+                r = data_ref( v.*D.pointer );
+            }
+
+        });
+
+        return r;
+    }
+
+#endif
+
+    static data_ref lookup( void const* p, core::string_view name, detail::data_json_tag )
+    {
+        detail::data_store* st = detail::data_store::current();
+
+        if( st == nullptr )
+        {
+            return data_ref();
+        }
+
+        return data_ref( st->push( json::value_from( get( p ), st->storage() ) ) ).lookup( name );
+    }
+
+    static data_ref lookup_( void const* p, core::string_view name )
+    {
+        return lookup( p, name, category() );
+    }
+
+    // for_each
+
+    template<class Tag> static bool for_each( void const* /*p*/, void* /*ctx*/, callback /*f*/, Tag )
+    {
+        return false;
+    }
+
+    static bool for_each( void const* p, void* ctx, callback f, detail::data_optional_tag )
+    {
+        T const& v = get( p );
+        return v && data_ref( *v ).for_each( ctx, f );
+    }
+
+    static bool for_each( void const* p, void* ctx, callback f, detail::data_range_tag )
+    {
+        for( auto const& x: get( p ) )
+        {
+            f( ctx, data_ref( x ) );
+        }
+
+        return true;
+    }
+
+    static bool for_each( void const* p, void* ctx, callback f, detail::data_json_tag )
+    {
+        json::value jv = json::value_from( get( p ) );
+        return data_ref( jv ).for_each( ctx, f );
+    }
+
+    static bool for_each_( void const* p, void* ctx, callback f )
+    {
+        return for_each( p, ctx, f, category() );
+    }
+
+    // convert
+
+    template<class Tag> static data_ref convert( void const* p, Tag )
+    {
+        return data_ref( get( p ) );
+    }
+
+    static data_ref convert( void const* p, detail::data_optional_tag )
+    {
+        T const& v = get( p );
+        return v? data_ref( *v ).convert(): data_ref( v );
+    }
+
+    static data_ref convert( void const* p, detail::data_json_tag )
+    {
+        detail::data_store* st = detail::data_store::current();
+
+        if( st == nullptr )
+        {
+            return data_ref( get( p ) );
+        }
+
+        return data_ref( st->push( json::value_from( get( p ), st->storage() ) ) );
+    }
+
+    static data_ref convert_( void const* p )
+    {
+        return convert( p, category() );
+    }
+
+    // begin
+
+    template<class Tag> static bool begin( void const* /*p*/, detail::data_cursor& /*c*/, json::memory_resource* /*mr*/, Tag )
+    {
+        return false;
+    }
+
+    static bool begin( void const* p, detail::data_cursor& c, json::memory_resource* mr, detail::data_optional_tag )
+    {
+        T const& v = get( p );
+        return v && data_ref( *v ).begin( c, mr );
+    }
+
+    static bool begin( void const* p, detail::data_cursor& c, json::memory_resource* mr, detail::data_range_tag )
+    {
+        c = detail::data_cursor::make< detail::range_cursor<T> >( mr, get( p ) );
+        return true;
+    }
+
+    static bool begin( void const* p, detail::data_cursor& c, json::memory_resource* mr, detail::data_json_tag )
+    {
+        json::value jv = json::value_from( get( p ) );
+
+        if( !jv.is_array() )
+        {
+            return false;
+        }
+
+        c = detail::data_cursor::make<detail::converted_cursor>( mr, std::move( jv ) );
+        return true;
+    }
+
+    static bool begin_( void const* p, detail::data_cursor& c, json::memory_resource* mr )
+    {
+        return begin( p, c, mr, category() );
+    }
+
+    // output
+
+    static void output( void const* /*p*/, output_ref /*out*/, bool /*quoted*/, detail::data_null_tag )
+    {
+    }
+
+    static void output( void const* p, output_ref out, bool quoted, detail::data_bool_tag )
+    {
+        detail::output_bool( get( p ), out, quoted );
+    }
+
+    static void output( void const* p, output_ref out, bool quoted, detail::data_int64_tag )
+    {
+        detail::output_int64( get( p ), out, quoted );
+    }
+
+    static void output( void const* p, output_ref out, bool quoted, detail::data_uint64_tag )
+    {
+        detail::output_uint64( get( p ), out, quoted );
+    }
+
+    static void output( void const* p, output_ref out, bool quoted, detail::data_double_tag )
+    {
+        detail::output_double( get( p ), out, quoted );
+    }
+
+    static void output( void const* p, output_ref out, bool quoted, detail::data_string_tag )
+    {
+        detail::output_string( get( p ), out, quoted );
+    }
+
+    static void output( void const* p, output_ref out, bool quoted, detail::data_optional_tag )
+    {
+        T const& v = get( p );
+
+        if( v )
+        {
+            data_ref( *v ).output( out, quoted );
+        }
+    }
+
+    static void output( void const* p, output_ref out, bool quoted, detail::data_json_tag )
+    {
+        detail::output_json( json::value_from( get( p ) ), out, quoted );
+    }
+
+    // maps, ranges, and described classes are output as JSON
+
+    template<class Tag> static void output( void const* p, output_ref out, bool quoted, Tag )
+    {
+        serialize( get( p ), out, quoted, category() );
+    }
+
+    // serialize, writes the value as JSON
+
+    template<class U> static void serialize_element( U const& v, output_ref out, bool quoted )
+    {
+        impl<U>::serialize( v, out, quoted, typename impl<U>::category() );
+    }
+
+    static void serialize_element( json::value const& v, output_ref out, bool quoted )
+    {
+        detail::serialize_json( v, out, quoted );
+    }
+
+    static void serialize( T const& /*v*/, output_ref out, bool quoted, detail::data_null_tag )
+    {
+        detail::output_string( "null", out, quoted );
+    }
+
+    static void serialize( T const& v, output_ref out, bool quoted, detail::data_bool_tag )
+    {
+        detail::output_bool( v, out, quoted );
+    }
+
+    static void serialize( T const& v, output_ref out, bool quoted, detail::data_int64_tag )
+    {
+        detail::output_int64( v, out, quoted );
+    }
+
+    static void serialize( T const& v, output_ref out, bool quoted, detail::data_uint64_tag )
+    {
+        detail::output_uint64( v, out, quoted );
+    }
+
+    static void serialize( T const& v, output_ref out, bool quoted, detail::data_double_tag )
+    {
+        detail::serialize_json( json::value( static_cast<double>( v ) ), out, quoted );
+    }
+
+    static void serialize( T const& v, output_ref out, bool quoted, detail::data_string_tag )
+    {
+        detail::serialize_string( v, out, quoted );
+    }
+
+    static void serialize( T const& v, output_ref out, bool quoted, detail::data_optional_tag )
+    {
+        if( v )
+        {
+            serialize_element( *v, out, quoted );
+        }
+        else
+        {
+            detail::output_string( "null", out, quoted );
+        }
+    }
+
+    template<class M> static void serialize_map( M const& m, output_ref out, bool quoted )
+    {
+        char const* sep = "{";
+
+        for( auto const& kv: m )
+        {
+            detail::output_string( sep, out, quoted );
+            detail::serialize_string( kv.first, out, quoted );
+            detail::output_string( ":", out, quoted );
+            serialize_element( kv.second, out, quoted );
+
+            sep = ",";
+        }
+
+        detail::output_string( *sep == '{'? "{}": "}", out, quoted );
+    }
+
+    static void serialize_map( json::object const& m, output_ref out, bool quoted )
+    {
+        char const* sep = "{";
+
+        for( auto const& kv: m )
+        {
+            detail::output_string( sep, out, quoted );
+            detail::serialize_string( kv.key(), out, quoted );
+            detail::output_string( ":", out, quoted );
+            detail::serialize_json( kv.value(), out, quoted );
+
+            sep = ",";
+        }
+
+        detail::output_string( *sep == '{'? "{}": "}", out, quoted );
+    }
+
+    static void serialize( T const& v, output_ref out, bool quoted, detail::data_map_tag )
+    {
+        serialize_map( v, out, quoted );
+    }
+
+    static void serialize( T const& v, output_ref out, bool quoted, detail::data_range_tag )
+    {
+        char const* sep = "[";
+
+        for( auto const& x: v )
+        {
+            detail::output_string( sep, out, quoted );
+            serialize_element( x, out, quoted );
+
+            sep = ",";
+        }
+
+        detail::output_string( *sep == '['? "[]": "]", out, quoted );
+    }
+
+#if defined(BOOST_DESCRIBE_CXX14)
+
+    static void serialize( T const& v, output_ref out, bool quoted, detail::data_described_tag )
+    {
+        using Md = describe::describe_members<T, describe::mod_public | describe::mod_inherited>;
+
+        char const* sep = "{";
+
+        mp11::mp_for_each<Md>( [&]( auto D ){
+
+            detail::output_string( sep, out, quoted );
+            detail::serialize_string( D.name, out, quoted );
+            detail::output_string( ":", out, quoted );
+            serialize_element( v.*D.pointer, out, quoted );
+
+            sep = ",";
+
+        });
+
+        detail::output_string( *sep == '{'? "{}": "}", out, quoted );
+    }
+
+#endif
+
+    static void serialize( T const& v, output_ref out, bool quoted, detail::data_json_tag )
+    {
+        detail::serialize_json( json::value_from( v ), out, quoted );
+    }
+
+    static void output_( void const* p, output_ref out, bool quoted )
+    {
+        output( p, out, quoted, category() );
+    }
+
+    static constexpr vtable vt = { &is_true_, &lookup_, &for_each_, &convert_, &begin_, &output_ };
+};
+
+template<class T> constexpr data_ref::vtable data_ref::impl<T>::vt;
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_DATA_REF_HPP_INCLUDED
@@ -0,0 +1,72 @@
+#ifndef BOOST_MUSTACHE_DETAIL_STORAGE_ALLOCATOR_HPP_INCLUDED
+#define BOOST_MUSTACHE_DETAIL_STORAGE_ALLOCATOR_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/json/storage_ptr.hpp>
+#include <cstddef>
+
+namespace boost
+{
+namespace mustache
+{
+namespace detail
+{
+
+// an allocator for the standard containers of the renderer, allocating
+// from its storage like its JSON values, so that they're counted by
+// render_stats and released along with a monotonic_resource; the
+// resource must outlive the container, which the renderer ensures by
+// holding a storage_ptr to it
+
+template<class T> class storage_allocator
+{
+private:
+
+    json::memory_resource* mr_;
+
+public:
+
+    using value_type = T;
+
+    explicit storage_allocator( json::storage_ptr const& sp ) noexcept: mr_( sp.get() )
+    {
+    }
+
+    template<class U> storage_allocator( storage_allocator<U> const& other ) noexcept: mr_( other.resource() )
+    {
+    }
+
+    json::memory_resource* resource() const noexcept
+    {
+        return mr_;
+    }
+
+    T* allocate( std::size_t n )
+    {
+        return static_cast<T*>( mr_->allocate( n * sizeof( T ), alignof( T ) ) );
+    }
+
+    void deallocate( T* p, std::size_t n ) noexcept
+    {
+        mr_->deallocate( p, n * sizeof( T ), alignof( T ) );
+    }
+
+    template<class U> friend bool operator==( storage_allocator const& a, storage_allocator<U> const& b ) noexcept
+    {
+        return a.resource() == b.resource();
+    }
+
+    template<class U> friend bool operator!=( storage_allocator const& a, storage_allocator<U> const& b ) noexcept
+    {
+        return a.resource() != b.resource();
+    }
+};
+
+} // namespace detail
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_DETAIL_STORAGE_ALLOCATOR_HPP_INCLUDED
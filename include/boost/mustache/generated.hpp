@@ -0,0 +1,150 @@
+#ifndef BOOST_MUSTACHE_GENERATED_HPP_INCLUDED
+#define BOOST_MUSTACHE_GENERATED_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// support for templates translated to C++, by static_template at compile
+// time, or by the boost_mustache_codegen tool at build time
+
+#include <boost/mustache/data_ref.hpp>
+#include <boost/mustache/output_ref.hpp>
+#include <boost/core/detail/string_view.hpp>
+#include <cstddef>
+
+namespace boost
+{
+namespace mustache
+{
+namespace generated
+{
+
+// the contexts of the enclosing sections, innermost first
+
+struct context
+{
+    data_ref value;
+    context const* next;
+};
+
+// installs a store for the values converted to JSON for a lookup in
+// them, for the duration of a render
+
+class render_scope
+{
+private:
+
+    detail::data_store store_;
+    detail::data_store_scope scope_;
+
+public:
+
+    render_scope(): scope_( store_ )
+    {
+    }
+};
+
+// the indentation of the enclosing standalone partials, innermost first
+
+struct indent
+{
+    core::string_view wsp;
+    indent const* next;
+};
+
+inline void write_indent( output_ref out, indent const* ind )
+{
+    if( ind )
+    {
+        write_indent( out, ind->next );
+        out.write( ind->wsp );
+    }
+}
+
+// as renderer::render_compiled_literal
+
+inline void write_literal( output_ref out, core::string_view text, bool line_start, indent const* ind )
+{
+    if( ind == nullptr )
+    {
+        out.write( text );
+        return;
+    }
+
+    if( line_start )
+    {
+        write_indent( out, ind );
+    }
+
+    for( ;; )
+    {
+        std::size_t i = text.find( '\n' );
+
+        if( i == core::string_view::npos || i + 1 == text.size() )
+        {
+            out.write( text );
+            break;
+        }
+
+        out.write( text.substr( 0, i + 1 ) );
+        write_indent( out, ind );
+
+        text.remove_prefix( i + 1 );
+    }
+}
+
+// the first component of a name, looked up in the contexts from the innermost
+
+inline data_ref lookup( context const* ctx, core::string_view name )
+{
+    data_ref r = ctx->value.lookup( name );
+
+    while( r.empty() && ctx->next )
+    {
+        ctx = ctx->next;
+        r = ctx->value.lookup( name );
+    }
+
+    return r;
+}
+
+// as renderer::render_compiled_section, for a section that isn't inverted;
+// calls f( c ) for each element of a list, or once with p when p isn't a
+// list, where c is the context of the section contents
+
+template<class F> void render_section( data_ref p, context const* ctx, F f )
+{
+    if( !p.is_true() )
+    {
+        return;
+    }
+
+    struct frame
+    {
+        context c;
+        F* f;
+    };
+
+    frame fr = { { p, ctx }, &f };
+
+    auto element = []( void* pf, data_ref item )
+    {
+        frame& fr = *static_cast<frame*>( pf );
+
+        fr.c.value = item;
+        ( *fr.f )( &fr.c );
+    };
+
+    if( !p.for_each( &fr, element ) )
+    {
+        fr.c.value = p;
+        f( &fr.c );
+    }
+}
+
+} // namespace generated
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_GENERATED_HPP_INCLUDED
@@ -0,0 +1,196 @@
+#ifndef BOOST_MUSTACHE_LAZY_RANGE_HPP_INCLUDED
+#define BOOST_MUSTACHE_LAZY_RANGE_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/assert.hpp>
+#include <type_traits>
+#include <utility>
+
+namespace boost
+{
+namespace mustache
+{
+
+namespace detail
+{
+
+// produces the elements returned by f, which returns an optional-like
+// value or a pointer, empty at the end
+
+template<class F> struct function_cursor
+{
+    using result_type = typename std::decay<decltype( std::declval<F&>()() )>::type;
+
+    F f;
+    result_type v;
+
+    void start()
+    {
+        v = f();
+    }
+
+    bool valid() const
+    {
+        return static_cast<bool>( v );
+    }
+
+    auto get() const -> decltype( *v )
+    {
+        return *v;
+    }
+
+    void next()
+    {
+        // the previous element is released before the next one is produced
+        v = result_type();
+        v = f();
+    }
+};
+
+// produces the elements of [it, last)
+
+template<class It, class S> struct iterator_cursor
+{
+    It it;
+    S last;
+
+    void start()
+    {
+    }
+
+    bool valid() const
+    {
+        return it != last;
+    }
+
+    auto get() const -> decltype( *it )
+    {
+        return *it;
+    }
+
+    void next()
+    {
+        ++it;
+    }
+};
+
+} // namespace detail
+
+// a single-pass range whose elements are produced on demand, one at a
+// time, while a section iterates over it; used for lists too large to
+// materialize, such as the rows of a database cursor
+//
+// once iterated, the range is exhausted, but keeps its truth value,
+// so that an inverted section following the list renders correctly
+
+template<class C> class lazy_range
+{
+private:
+
+    mutable C c_;
+
+    mutable bool started_ = false;
+    mutable bool empty_ = true;
+
+    void start() const
+    {
+        if( !started_ )
+        {
+            started_ = true;
+
+            c_.start();
+            empty_ = !c_.valid();
+        }
+    }
+
+public:
+
+    class iterator
+    {
+    private:
+
+        lazy_range const* r_ = nullptr;
+
+        bool at_end() const
+        {
+            return r_ == nullptr || !r_->c_.valid();
+        }
+
+    public:
+
+        iterator() = default;
+
+        explicit iterator( lazy_range const* r ) noexcept: r_( r )
+        {
+        }
+
+        auto operator*() const -> decltype( r_->c_.get() )
+        {
+            BOOST_ASSERT( !at_end() );
+            return r_->c_.get();
+        }
+
+        iterator& operator++()
+        {
+            BOOST_ASSERT( !at_end() );
+
+            r_->c_.next();
+            return *this;
+        }
+
+        friend bool operator==( iterator const& a, iterator const& b )
+        {
+            return a.at_end() == b.at_end();
+        }
+
+        friend bool operator!=( iterator const& a, iterator const& b )
+        {
+            return a.at_end() != b.at_end();
+        }
+    };
+
+    explicit lazy_range( C c ): c_( std::move( c ) )
+    {
+    }
+
+    iterator begin() const
+    {
+        start();
+        return iterator( this );
+    }
+
+    iterator end() const noexcept
+    {
+        return iterator();
+    }
+
+    // whether the range produces no elements; doesn't consume any
+    bool empty() const
+    {
+        start();
+        return empty_;
+    }
+};
+
+// a range of the values returned by f, until it returns an empty
+// optional or a null pointer
+
+template<class F> lazy_range<detail::function_cursor<F>> make_lazy_range( F f )
+{
+    return lazy_range<detail::function_cursor<F>>( { std::move( f ), {} } );
+}
+
+// a single-pass range over [first, last)
+
+template<class It, class S> lazy_range<detail::iterator_cursor<It, S>> make_lazy_range( It first, S last )
+{
+    return lazy_range<detail::iterator_cursor<It, S>>( { std::move( first ), std::move( last ) } );
+}
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_LAZY_RANGE_HPP_INCLUDED
@@ -0,0 +1,95 @@
+#ifndef BOOST_MUSTACHE_PARTIAL_REGISTRY_HPP_INCLUDED
+#define BOOST_MUSTACHE_PARTIAL_REGISTRY_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/compiled_template.hpp>
+#include <boost/mustache/renderer.hpp>
+#include <boost/mustache/config.hpp>
+#include <boost/json/object.hpp>
+#include <boost/json/value_from.hpp>
+#include <boost/core/detail/string_view.hpp>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace boost
+{
+namespace mustache
+{
+
+class renderer;
+
+// a set of partials, compiled once, with the partial tags in them resolved
+// to the partials they refer to; immutable, and shared by the renderers
+// constructed with it, which use it concurrently without copying it
+
+class partial_registry
+{
+private:
+
+    friend class renderer;
+
+    struct entry
+    {
+        // in names_, or in the image
+        core::string_view name;
+        compiled_template tmpl;
+    };
+
+    // sorted by name
+    std::vector<entry> entries_;
+
+    // the names of the partials, when not loaded from an image
+    std::string names_;
+
+    // the links of all the partials, when loaded from an image
+    std::vector<compiled_template const*> links_;
+
+private:
+
+    // the index of the partial with the given name, or size()
+    BOOST_MUSTACHE_DECL std::size_t find_index( core::string_view name ) const noexcept;
+
+public:
+
+    BOOST_MUSTACHE_DECL explicit partial_registry( json::object const& partials );
+
+    // loads the partials from image, as written by write_image, without
+    // copying or compiling them; image must remain valid, and must not be
+    // modified, until the registry is destroyed
+    BOOST_MUSTACHE_DECL partial_registry( borrow_t, core::string_view image );
+
+    // partials is converted to a JSON object with value_from
+    template<class T> explicit partial_registry( T const& partials ):
+        partial_registry( json::value_from( partials ).as_object() )
+    {
+    }
+
+    BOOST_MUSTACHE_DECL ~partial_registry();
+
+    partial_registry( partial_registry const& ) = delete;
+    partial_registry& operator=( partial_registry const& ) = delete;
+
+    std::size_t size() const noexcept
+    {
+        return entries_.size();
+    }
+
+    // the compiled partial with the given name, or nullptr
+    BOOST_MUSTACHE_DECL compiled_template const* find( core::string_view name ) const noexcept;
+
+    // resolves the partial tags in tmpl, for rendering with this registry
+    BOOST_MUSTACHE_DECL void link( compiled_template& tmpl ) const;
+
+    // appends to out the binary image of the registry, for loading it with
+    // the constructor above, in this process or another
+    BOOST_MUSTACHE_DECL void write_image( std::string& out ) const;
+};
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_PARTIAL_REGISTRY_HPP_INCLUDED
@@ -6,20 +6,153 @@
 // https://www.boost.org/LICENSE_1_0.txt
 
 #include <boost/mustache/renderer.hpp>
+#include <boost/mustache/partial_registry.hpp>
+#include <boost/mustache/template_cache.hpp>
+#include <boost/json/monotonic_resource.hpp>
+#include <cstddef>
 
 namespace boost
 {
 namespace mustache
 {
 
-template<class T1 = json::value, class T2 = json::object> void render( core::string_view tmpl, output_ref out, T1 const& data, T2 const& partials, json::storage_ptr sp = {} )
+// passed to render in place of the storage to have it allocate from
+// a json::monotonic_resource with an initial buffer of N bytes on the
+// stack, so that the memory used by the render is released at once;
+// this is the default
+
+template<std::size_t N = 4096> struct monotonic_storage
+{
+};
+
+namespace detail
+{
+
+inline void render_template( renderer& rd, core::string_view tmpl, output_ref out )
+{
+    rd.render_some( tmpl, out );
+    rd.finish( out );
+}
+
+inline void render_template( renderer& rd, compiled_template const& tmpl, output_ref out )
+{
+    rd.render( tmpl, out );
+}
+
+template<class Tm, class T1, class T2> void render_impl( Tm const& tmpl, output_ref out, T1 const& data, T2 const& partials, json::storage_ptr sp, std::false_type )
 {
     mustache::renderer rd( data, partials, sp );
+    render_template( rd, tmpl, out );
+}
+
+// described classes are accessed in place, without being converted to JSON
+
+template<class Tm, class T1, class T2> void render_impl( Tm const& tmpl, output_ref out, T1 const& data, T2 const& partials, json::storage_ptr sp, std::true_type )
+{
+    json::object p2 = json::value_from( partials, sp ).as_object();
+
+    mustache::renderer rd( borrow, data, p2, sp );
+    render_template( rd, tmpl, out );
+}
+
+template<class Tm, class T1> void render_impl( Tm const& tmpl, output_ref out, T1 const& data, partial_registry const& partials, json::storage_ptr sp, std::true_type )
+{
+    mustache::renderer rd( borrow, data, partials, sp );
+    render_template( rd, tmpl, out );
+}
+
+} // namespace detail
+
+template<class T1 = json::value, class T2 = json::object> void render( core::string_view tmpl, output_ref out, T1 const& data, T2 const& partials, json::storage_ptr sp )
+{
+    detail::render_impl( tmpl, out, data, partials, sp, detail::is_described_class<T1>() );
+}
+
+template<class T1 = json::value, class T2 = json::object> void render( compiled_template const& tmpl, output_ref out, T1 const& data, T2 const& partials, json::storage_ptr sp )
+{
+    detail::render_impl( tmpl, out, data, partials, sp, detail::is_described_class<T1>() );
+}
+
+// JSON data and partials are used directly, without being copied
+
+inline void render( core::string_view tmpl, output_ref out, json::value const& data, json::object const& partials, json::storage_ptr sp )
+{
+    mustache::renderer rd( borrow, data, partials, sp );
+
+    rd.render_some( tmpl, out );
+    rd.finish( out );
+}
+
+inline void render( compiled_template const& tmpl, output_ref out, json::value const& data, json::object const& partials, json::storage_ptr sp )
+{
+    mustache::renderer rd( borrow, data, partials, sp );
+    rd.render( tmpl, out );
+}
+
+inline void render( core::string_view tmpl, output_ref out, json::value const& data, partial_registry const& partials, json::storage_ptr sp )
+{
+    mustache::renderer rd( borrow, data, partials, sp );
 
     rd.render_some( tmpl, out );
     rd.finish( out );
 }
 
+inline void render( compiled_template const& tmpl, output_ref out, json::value const& data, partial_registry const& partials, json::storage_ptr sp )
+{
+    mustache::renderer rd( borrow, data, partials, sp );
+    rd.render( tmpl, out );
+}
+
+// N isn't defaulted, so that {} as the storage doesn't match these
+// overloads, and is taken as the default storage_ptr
+
+template<class T1 = json::value, class T2 = json::object, std::size_t N> void render( core::string_view tmpl, output_ref out, T1 const& data, T2 const& partials, monotonic_storage<N> )
+{
+    unsigned char buffer[ N ];
+    json::monotonic_resource mr( buffer );
+
+    mustache::render( tmpl, out, data, partials, &mr );
+}
+
+template<class T1 = json::value, class T2 = json::object, std::size_t N> void render( compiled_template const& tmpl, output_ref out, T1 const& data, T2 const& partials, monotonic_storage<N> )
+{
+    unsigned char buffer[ N ];
+    json::monotonic_resource mr( buffer );
+
+    mustache::render( tmpl, out, data, partials, &mr );
+}
+
+template<class T1 = json::value, class T2 = json::object> void render( core::string_view tmpl, output_ref out, T1 const& data, T2 const& partials )
+{
+    mustache::render( tmpl, out, data, partials, monotonic_storage<>() );
+}
+
+template<class T1 = json::value, class T2 = json::object> void render( compiled_template const& tmpl, output_ref out, T1 const& data, T2 const& partials )
+{
+    mustache::render( tmpl, out, data, partials, monotonic_storage<>() );
+}
+
+// the template is compiled on first use, and taken from cache afterwards
+
+template<class T1 = json::value, class T2 = json::object> void render( core::string_view tmpl, output_ref out, T1 const& data, T2 const& partials, template_cache& cache, json::storage_ptr sp )
+{
+    std::shared_ptr<compiled_template const> p = cache.get( tmpl );
+    mustache::render( *p, out, data, partials, sp );
+}
+
+template<class T1 = json::value, class T2 = json::object, std::size_t N> void render( core::string_view tmpl, output_ref out, T1 const& data, T2 const& partials, template_cache& cache, monotonic_storage<N> )
+{
+    unsigned char buffer[ N ];
+    json::monotonic_resource mr( buffer );
+
+    mustache::render( tmpl, out, data, partials, cache, &mr );
+}
+
+template<class T1 = json::value, class T2 = json::object> void render( core::string_view tmpl, output_ref out, T1 const& data, T2 const& partials, template_cache& cache )
+{
+    mustache::render( tmpl, out, data, partials, cache, monotonic_storage<>() );
+}
+
 } // namespace mustache
 } // namespace boost
 
@@ -0,0 +1,71 @@
+#ifndef BOOST_MUSTACHE_RENDER_STATS_HPP_INCLUDED
+#define BOOST_MUSTACHE_RENDER_STATS_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/config.hpp>
+#include <boost/json/memory_resource.hpp>
+#include <boost/json/storage_ptr.hpp>
+#include <cstddef>
+
+namespace boost
+{
+namespace mustache
+{
+
+// statistics collected by a renderer, see renderer::set_stats;
+// also a memory resource that counts the allocations made through
+// it, when used as the storage of the renderer
+
+class render_stats: public json::memory_resource
+{
+private:
+
+    json::storage_ptr upstream_;
+
+    // the bytes currently allocated
+    std::size_t bytes_in_use_ = 0;
+
+public:
+
+    // allocations made through *this
+    std::size_t allocations = 0;
+    std::size_t bytes_allocated = 0;
+    std::size_t peak_bytes = 0;
+
+    // bytes written to the output, and the part of them
+    // produced by HTML-escaped interpolations
+    std::size_t bytes_emitted = 0;
+    std::size_t escaped_bytes = 0;
+
+    // processed tags, by kind
+    std::size_t interpolation_tags = 0;
+    std::size_t section_tags = 0;
+    std::size_t partial_tags = 0;
+    std::size_t comment_tags = 0;
+    std::size_t delimiter_tags = 0;
+
+    // interpolation and section names not found in the data
+    std::size_t lookup_misses = 0;
+
+public:
+
+    BOOST_MUSTACHE_DECL explicit render_stats( json::storage_ptr upstream = {} ) noexcept;
+
+    // sets the counters to zero, and peak_bytes to
+    // the bytes currently allocated
+    BOOST_MUSTACHE_DECL void clear() noexcept;
+
+private:
+
+    BOOST_MUSTACHE_DECL void* do_allocate( std::size_t n, std::size_t align ) override;
+    BOOST_MUSTACHE_DECL void do_deallocate( void* p, std::size_t n, std::size_t align ) override;
+    BOOST_MUSTACHE_DECL bool do_is_equal( json::memory_resource const& r ) const noexcept override;
+};
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_RENDER_STATS_HPP_INCLUDED
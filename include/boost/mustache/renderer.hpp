@@ -6,6 +6,9 @@
 // https://www.boost.org/LICENSE_1_0.txt
 
 #include <boost/mustache/output_ref.hpp>
+#include <boost/mustache/compiled_template.hpp>
+#include <boost/mustache/data_ref.hpp>
+#include <boost/mustache/detail/storage_allocator.hpp>
 #include <boost/mustache/config.hpp>
 #include <boost/json/value.hpp>
 #include <boost/json/array.hpp>
@@ -14,16 +17,36 @@
 #include <boost/json/storage_ptr.hpp>
 #include <boost/json/value_from.hpp>
 #include <boost/core/detail/string_view.hpp>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace boost
 {
 namespace mustache
 {
 
+// passed to the renderer constructor to have it refer to
+// the data and the partials instead of copying them
+
+struct borrow_t
+{
+};
+
+constexpr borrow_t borrow{};
+
+class render_stats;
+class thread_pool;
+class stream_renderer;
+class partial_registry;
+
 class renderer
 {
 private:
 
+    friend class stream_renderer;
+
     enum state
     {
         state_leading_wsp,
@@ -38,8 +61,19 @@ private:
 
 private:
 
-    json::array context_stack_;
-    json::object partials_;
+    // copies of the data and the partials passed to the constructor,
+    // unused when they are borrowed
+    json::value data_;
+    json::object partials_copy_;
+
+    // the section contexts, innermost last; the first one is the data
+    std::vector<data_ref, detail::storage_allocator<data_ref>> context_stack_;
+
+    // the partials; either &partials_copy_ or borrowed
+    json::object const* partials_;
+
+    // the partials, when given as a registry; partials_ is then empty
+    partial_registry const* registry_ = nullptr;
 
     state state_ = state_leading_wsp;
 
@@ -57,6 +91,11 @@ private:
     // has been \r\n, as opposed to just \n
     bool had_cr_ = false;
 
+    // the leading whitespace of the standalone tag being handled,
+    // after whitespace_ has been reset for the next line; only used
+    // before the tag handler renders a partial
+    json::string standalone_wsp_;
+
     // start delimiter, default '{{'
     json::string start_delim_;
 
@@ -72,26 +111,164 @@ private:
 
     // section state, only valid when in_section_
 
-    // stack of currently encountered open section tags
+    // stack of currently encountered open section tags, the first
+    // section_depth_ elements; the rest are kept for reuse
     json::array section_stack_;
+    std::size_t section_depth_ = 0;
 
     // whether the current section is inverted
     bool inverted_ = false;
 
     // the current context (e.g. for "{{#x.y}}",
-    // a pointer to the lookup result of "x.y"
-    json::value const * section_context_ = nullptr;
+    // a reference to the lookup result of "x.y"
+    data_ref section_context_;
 
     // buffered section contents until its closing tag
     json::string section_text_;
 
+    // section_text_, compiled by render_section
+    compiled_template section_template_;
+
+    // whether the section contents start at the beginning of a line
+    bool section_line_start_ = false;
+
+    // the delimiters in effect at the section tag, with which the
+    // contents are compiled; the delimiter tags in the contents
+    // are applied as they're buffered, to find the closing tag
+    json::string section_start_delim_;
+    json::string section_end_delim_;
+
     // partial state
 
-    // leading whitespace before the standalone partial tag
-    json::string partial_lwsp_;
+    // the indentation of the enclosing partials, saved by read
+    // while rendering a partial, innermost last
+    json::string partial_saved_;
+
+    // compiled template state
+
+    // the indentation of the partial being rendered
+    json::string indent_;
+
+    // the partials rendered so far, compiled on first use; keyed by
+    // the address of their text, which is compared with the compiled
+    // text on first use after a reset with the same partials, since
+    // they may have been modified in between
+    struct compiled_partial
+    {
+        compiled_template tmpl;
+        bool checked;
+    };
+
+    using compiled_partial_map = std::unordered_map<json::string const*, compiled_partial, std::hash<json::string const*>, std::equal_to<json::string const*>, detail::storage_allocator<std::pair<json::string const* const, compiled_partial>>>;
+
+    compiled_partial_map compiled_partials_;
+
+    // the partials referenced by the template being rendered, when it
+    // isn't linked to registry_, resolved by name on first use, in a
+    // slot per instruction; links_tmpl_ is the template they belong to,
+    // and is cleared when a render starts
+    struct cached_partial
+    {
+        bool valid;
+        compiled_template const* tmpl;
+    };
+
+    compiled_template const* links_tmpl_ = nullptr;
+    std::vector<cached_partial, detail::storage_allocator<cached_partial>> links_;
+
+    // a name looked up in the contexts below the current element of
+    // a section resolves the same way for all its elements, so the
+    // result is kept for the duration of the section, in a slot per
+    // instruction of its contents
+    struct cached_lookup
+    {
+        bool valid;
+        data_ref value;
+    };
+
+    std::vector<cached_lookup, detail::storage_allocator<cached_lookup>> lookup_cache_;
+
+    static constexpr std::size_t no_cache = ~std::size_t( 0 );
+
+    // the values converted to JSON for a lookup in them, installed
+    // on the current thread while rendering; those converted for an
+    // element of a list are released when the element is done
+    detail::data_store converted_;
+
+    // the values of converted_ holding the conversion of the root,
+    // kept until the data is replaced
+    std::size_t converted_root_ = 0;
+
+    // statistics, when attached by set_stats
+    render_stats* stats_ = nullptr;
+
+    // the workers for list sections over large JSON arrays, and
+    // the number of elements each of them renders at a time
+    thread_pool* pool_ = nullptr;
+    std::size_t chunk_size_ = 0;
+
+    // set by stream_renderer while the root object is still being
+    // parsed; the first name looked up and not found in it, which
+    // may yet be added, is stored in root_missed_, and root_used_
+    // is set when the root itself is used, by "." outside of sections
+    bool root_incomplete_ = false;
+    core::string_view root_missed_;
+    bool root_used_ = false;
+
+    // pull mode state
+
+    // the instructions [i, last) of tmpl remaining to be rendered by
+    // read; the frames of the enclosing templates and sections are
+    // below it in pull_stack_
+    struct pull_frame
+    {
+        compiled_template const* tmpl;
+
+        std::size_t first;
+        std::size_t i;
+        std::size_t last;
+
+        // the lookup_cache_ slot of the instruction at first, or no_cache
+        std::size_t cache;
+
+        // for the contents of a list section over a JSON array,
+        // the array and the index of the current element
+        json::array const* items;
+        std::size_t k;
+
+        // for the contents of a section over another list, the
+        // iteration over its elements, released by pull_pop
+        detail::data_cursor cursor;
+
+        // for a section with its own context, the lookup_cache_
+        // size to restore when done, or no_cache
+        std::size_t cache_size;
+
+        // for a partial, the position in partial_saved_ of the
+        // indentation to restore when done, or no_cache
+        std::size_t saved;
+
+        // for a section, the size of converted_ to restore when done,
+        // or no_cache, and its pinned values before the section; for a
+        // list, the size to restore after each element
+        std::size_t converted;
+        std::size_t pinned;
+        std::size_t converted_item;
+    };
+
+    std::vector<pull_frame, detail::storage_allocator<pull_frame>> pull_stack_;
+
+    // output that didn't fit in the buffer passed to read, and
+    // the part of it already returned
+    json::string pending_;
+    std::size_t pending_pos_ = 0;
 
 private:
 
+    // render_some and finish, without the output buffering
+    BOOST_MUSTACHE_DECL void render_some_impl( core::string_view in, output_ref out );
+    BOOST_MUSTACHE_DECL void finish_impl( output_ref out );
+
     BOOST_MUSTACHE_DECL core::string_view handle_state_leading_wsp( core::string_view in, output_ref out );
     BOOST_MUSTACHE_DECL core::string_view handle_state_start_delim( core::string_view in, output_ref out );
     BOOST_MUSTACHE_DECL core::string_view handle_state_tag( core::string_view in, output_ref out );
@@ -118,25 +295,109 @@ private:
     BOOST_MUSTACHE_DECL void handle_delimiter_tag( core::string_view tag, output_ref out );
     BOOST_MUSTACHE_DECL void handle_partial_tag( core::string_view tag, output_ref out, core::string_view old_wsp );
 
-    BOOST_MUSTACHE_DECL json::value const* lookup_value( core::string_view name ) const;
+    BOOST_MUSTACHE_DECL void push_section( core::string_view name );
+
+    BOOST_MUSTACHE_DECL data_ref lookup_value( core::string_view name ) const;
+
+    BOOST_MUSTACHE_DECL void output_value( data_ref r, output_ref out, bool quoted );
+    BOOST_MUSTACHE_DECL void count_section( data_ref r );
 
     BOOST_MUSTACHE_DECL void render_section( output_ref out );
 
+    BOOST_MUSTACHE_DECL void render_compiled( compiled_template const& tmpl, std::size_t first, std::size_t last, std::size_t cache, output_ref out );
+    BOOST_MUSTACHE_DECL void render_compiled_literal( core::string_view text, bool line_start, output_ref out );
+    struct section_frame;
+
+    BOOST_MUSTACHE_DECL static void render_section_element( void * frame, data_ref item );
+    BOOST_MUSTACHE_DECL void render_compiled_section( data_ref p, bool inverted, compiled_template const& tmpl, std::size_t first, std::size_t last, std::size_t cache, output_ref out );
+    BOOST_MUSTACHE_DECL void render_compiled_partial( compiled_template const& tmpl, std::size_t i, output_ref out );
+
+    BOOST_MUSTACHE_DECL compiled_template const* find_compiled_partial( core::string_view name );
+    BOOST_MUSTACHE_DECL compiled_template const* find_compiled_partial( compiled_template const& tmpl, std::size_t i );
+
+    BOOST_MUSTACHE_DECL void pull_step( output_ref out );
+    BOOST_MUSTACHE_DECL void pull_section( data_ref p, bool inverted, compiled_template const& tmpl, std::size_t first, std::size_t last, std::size_t cache );
+    BOOST_MUSTACHE_DECL void pull_partial( compiled_template const& tmpl, std::size_t i );
+    BOOST_MUSTACHE_DECL void pull_pop();
+    BOOST_MUSTACHE_DECL void pull_clear() noexcept;
+
+    struct parallel_job;
+
+    BOOST_MUSTACHE_DECL static void run_parallel_job( void * job );
+    BOOST_MUSTACHE_DECL void render_chunk( parallel_job const& job, std::size_t i, output_ref out );
+    BOOST_MUSTACHE_DECL void render_parallel_section( json::array const& items, compiled_template const& tmpl, std::size_t first, std::size_t last, std::size_t cache, output_ref out );
+
+    BOOST_MUSTACHE_DECL data_ref lookup_value( compiled_template const& tmpl, std::size_t first, std::size_t size, std::size_t cache );
+
 private:
 
     BOOST_MUSTACHE_DECL renderer( json::value&& data, json::object&& partials, json::storage_ptr sp );
+    BOOST_MUSTACHE_DECL renderer( json::value&& data, partial_registry const& partials, json::storage_ptr sp );
+
+    BOOST_MUSTACHE_DECL void reset_copy( json::value&& data, json::object&& partials );
+    BOOST_MUSTACHE_DECL void reset_copy( json::value&& data, partial_registry const& partials );
+
+    BOOST_MUSTACHE_DECL void set_root( data_ref data );
 
 public:
 
     BOOST_MUSTACHE_DECL ~renderer();
 
+    renderer( renderer const& ) = delete;
+    renderer& operator=( renderer const& ) = delete;
+
+    // data and partials must outlive the renderer and must not change
+    BOOST_MUSTACHE_DECL renderer( borrow_t, data_ref data, json::object const& partials, json::storage_ptr sp = {} );
+
     template<class T1, class T2> explicit renderer( T1 const& data, T2 const& partials, json::storage_ptr sp = {} ):
         renderer( json::value_from( data, sp ), json::value_from( partials, sp ).as_object(), sp )
     {
     }
 
+    // partials must outlive the renderer; it's used without being copied
+    BOOST_MUSTACHE_DECL renderer( borrow_t, data_ref data, partial_registry const& partials, json::storage_ptr sp = {} );
+
+    template<class T1> explicit renderer( T1 const& data, partial_registry const& partials, json::storage_ptr sp = {} ):
+        renderer( json::value_from( data, sp ), partials, sp )
+    {
+    }
+
     BOOST_MUSTACHE_DECL void render_some( core::string_view in, output_ref out );
     BOOST_MUSTACHE_DECL void finish( output_ref out );
+
+    BOOST_MUSTACHE_DECL void render( compiled_template const& tmpl, output_ref out );
+
+    // pull mode: start prepares read to render tmpl, which must remain
+    // valid until done; read renders into buf until it's full or the
+    // template ends, and returns the part of buf filled
+    BOOST_MUSTACHE_DECL void start( compiled_template const& tmpl );
+    BOOST_MUSTACHE_DECL core::string_view read( char* buf, std::size_t n );
+    BOOST_MUSTACHE_DECL bool done() const noexcept;
+
+    // prepares the renderer for a new template, keeping its buffers
+    BOOST_MUSTACHE_DECL void reset();
+
+    // as above, with new data and partials
+    BOOST_MUSTACHE_DECL void reset( borrow_t, data_ref data, json::object const& partials );
+    BOOST_MUSTACHE_DECL void reset( borrow_t, data_ref data, partial_registry const& partials );
+
+    template<class T1, class T2> void reset( T1 const& data, T2 const& partials )
+    {
+        json::storage_ptr const& sp = data_.storage();
+        reset_copy( json::value_from( data, sp ), json::value_from( partials, sp ).as_object() );
+    }
+
+    template<class T1> void reset( T1 const& data, partial_registry const& partials )
+    {
+        reset_copy( json::value_from( data, data_.storage() ), partials );
+    }
+
+    // st, if not null, must outlive the renderer
+    BOOST_MUSTACHE_DECL void set_stats( render_stats* st ) noexcept;
+
+    // tp, if not null, must outlive the renderer; list sections over
+    // JSON arrays of at least 2 * chunk elements are rendered on it
+    BOOST_MUSTACHE_DECL void set_thread_pool( thread_pool* tp, std::size_t chunk = 256 ) noexcept;
 };
 
 } // namespace mustache
@@ -0,0 +1,773 @@
+#ifndef BOOST_MUSTACHE_STATIC_TEMPLATE_HPP_INCLUDED
+#define BOOST_MUSTACHE_STATIC_TEMPLATE_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/generated.hpp>
+#include <boost/mustache/data_ref.hpp>
+#include <boost/mustache/output_ref.hpp>
+#include <boost/mustache/buffered_output.hpp>
+#include <boost/core/detail/string_view.hpp>
+#include <boost/config.hpp>
+
+#if defined(BOOST_NO_CXX17_IF_CONSTEXPR) || defined(BOOST_NO_CXX17_INLINE_VARIABLES) || defined(BOOST_NO_CXX17_AUTO_NONTYPE_TEMPLATE_PARAMS)
+# error "<boost/mustache/static_template.hpp> requires C++17"
+#endif
+
+#include <array>
+#include <utility>
+#include <cstddef>
+
+namespace boost
+{
+namespace mustache
+{
+
+// a named partial of a static template; the text must be a string
+// with static storage duration, such as a constexpr char array
+
+struct static_partial
+{
+    char const* name;
+    char const* text;
+};
+
+inline constexpr std::array<static_partial, 0> no_static_partials{};
+
+namespace detail
+{
+
+// not constexpr; a call to it during the compilation of a static
+// template is reported by the compiler along with the message
+
+inline void static_template_error( char const* /*message*/ )
+{
+}
+
+enum static_opcode: unsigned
+{
+    sop_literal,
+    sop_indent,
+    sop_escaped,
+    sop_unescaped,
+    sop_section,
+    sop_inverted_section,
+    sop_partial,
+    sop_standalone_partial,
+};
+
+constexpr std::size_t static_npos = ~std::size_t( 0 );
+
+// as in compiled_template; partial is the index of the partial in the
+// partials of the template, or static_npos when there's no such partial
+
+struct static_instruction
+{
+    unsigned op;
+    std::size_t first;
+    std::size_t size;
+    std::size_t arg;
+    std::size_t arg_size;
+    std::size_t partial;
+};
+
+struct static_segment
+{
+    std::size_t first;
+    std::size_t size;
+};
+
+template<std::size_t N, std::size_t M> struct static_code
+{
+    static_instruction code[ N + 1 ] = {};
+    std::size_t code_size = 0;
+
+    static_segment segments[ M + 1 ] = {};
+    std::size_t segments_size = 0;
+};
+
+constexpr bool static_is_space( char c )
+{
+    return c == ' ' || c == '\t';
+}
+
+constexpr core::string_view static_trim( core::string_view sv )
+{
+    while( !sv.empty() && static_is_space( sv.front() ) )
+    {
+        sv.remove_prefix( 1 );
+    }
+
+    while( !sv.empty() && static_is_space( sv.back() ) )
+    {
+        sv.remove_suffix( 1 );
+    }
+
+    return sv;
+}
+
+constexpr bool static_is_tag_standalone( core::string_view tag )
+{
+    while( !tag.empty() && static_is_space( tag.front() ) )
+    {
+        tag.remove_prefix( 1 );
+    }
+
+    if( tag.empty() )
+    {
+        return false;
+    }
+
+    char ch = tag.front();
+
+    return ch == '!' || ch == '=' || ch == '>' || ch == '#' || ch == '^' || ch == '/';
+}
+
+// the compiler of compiled_template, for the default delimiters, evaluated
+// at compile time; constructs the runtime compiler accepts leniently, such
+// as unclosed sections, are errors
+
+template<std::size_t N, std::size_t M, class P> class static_compiler
+{
+private:
+
+    struct tag_info
+    {
+        core::string_view text;
+        std::size_t end;
+        bool triple;
+    };
+
+public:
+
+    static_code<N, M> r;
+
+private:
+
+    core::string_view text_;
+    P const& partials_;
+
+    std::size_t open_ = 0;
+    bool pending_indent_ = false;
+    bool can_merge_ = false;
+
+public:
+
+    constexpr static_compiler( core::string_view text, P const& partials ): text_( text ), partials_( partials )
+    {
+    }
+
+    constexpr void compile()
+    {
+        std::size_t const n = text_.size();
+        std::size_t pos = 0;
+
+        bool line_start = true;
+
+        while( pos < n )
+        {
+            if( line_start )
+            {
+                line_start = false;
+
+                std::size_t p = pos;
+
+                while( p < n && static_is_space( text_[ p ] ) )
+                {
+                    ++p;
+                }
+
+                tag_info tag = {};
+
+                if( p < n && text_[ p ] == '{' && parse_tag( p, tag ) && !tag.triple && static_is_tag_standalone( tag.text ) )
+                {
+                    std::size_t m = line_ending_size( tag.end );
+
+                    if( m != static_npos )
+                    {
+                        handle_tag( tag.text, text_.substr( pos, p - pos ), true );
+
+                        pos = tag.end + m;
+                        line_start = true;
+
+                        continue;
+                    }
+                }
+
+                pending_indent_ = true;
+
+                emit_literal( pos, p - pos );
+                pos = p;
+
+                continue;
+            }
+
+            std::size_t p = pos;
+
+            while( p < n && text_[ p ] != '\n' && text_[ p ] != '{' )
+            {
+                ++p;
+            }
+
+            if( p == n )
+            {
+                emit_literal( pos, n - pos );
+                pos = n;
+
+                break;
+            }
+
+            if( text_[ p ] == '\n' )
+            {
+                emit_literal( pos, p + 1 - pos );
+                pos = p + 1;
+
+                line_start = true;
+                continue;
+            }
+
+            emit_literal( pos, p - pos );
+
+            tag_info tag = {};
+
+            if( parse_tag( p, tag ) )
+            {
+                handle_tag( tag.text, core::string_view(), false );
+            }
+            else
+            {
+                emit_literal( p, tag.end - p );
+            }
+
+            pos = tag.end;
+        }
+
+        if( open_ != 0 )
+        {
+            static_template_error( "unclosed section" );
+        }
+
+        if( pending_indent_ )
+        {
+            emit( sop_indent, 0, 0, 0, 0 );
+        }
+    }
+
+private:
+
+    constexpr std::size_t line_ending_size( std::size_t pos ) const
+    {
+        core::string_view rest = text_.substr( pos );
+
+        if( rest.empty() )
+        {
+            return 0;
+        }
+
+        if( rest[ 0 ] == '\n' )
+        {
+            return 1;
+        }
+
+        if( rest.size() >= 2 && rest[ 0 ] == '\r' && rest[ 1 ] == '\n' )
+        {
+            return 2;
+        }
+
+        return static_npos;
+    }
+
+    // returns false when there's no "{{" at pos
+
+    constexpr bool parse_tag( std::size_t pos, tag_info& tag ) const
+    {
+        if( text_.substr( pos, 2 ) != "{{" )
+        {
+            tag.end = pos + 1;
+            return false;
+        }
+
+        std::size_t first = pos + 2;
+        std::size_t i = text_.find( "}}", first );
+
+        if( i == core::string_view::npos )
+        {
+            static_template_error( "incomplete tag" );
+        }
+
+        tag.text = text_.substr( first, i - first );
+        tag.end = i + 2;
+        tag.triple = false;
+
+        if( !tag.text.empty() && tag.text.front() == '{' )
+        {
+            tag.triple = true;
+
+            if( tag.end < text_.size() && text_[ tag.end ] == '}' )
+            {
+                tag.text = text_.substr( first, i + 1 - first );
+                ++tag.end;
+            }
+            else
+            {
+                static_template_error( "triple mustache without closing '}}}'" );
+            }
+        }
+
+        return true;
+    }
+
+    constexpr void handle_tag( core::string_view tag, core::string_view wsp, bool standalone )
+    {
+        char ch = tag.empty()? '\0': tag.front();
+
+        if( ch == '!' )
+        {
+            return;
+        }
+
+        if( ch == '>' )
+        {
+            core::string_view name = static_trim( tag.substr( 1 ) );
+
+            std::size_t k = static_npos;
+            std::size_t j = 0;
+
+            for( static_partial const& p: partials_ )
+            {
+                if( k == static_npos && core::string_view( p.name ) == name )
+                {
+                    k = j;
+                }
+
+                ++j;
+            }
+
+            if( standalone )
+            {
+                emit( sop_standalone_partial, offset( name ), name.size(), offset( wsp ), wsp.size(), k );
+            }
+            else
+            {
+                emit( sop_partial, offset( name ), name.size(), 0, 0, k );
+            }
+
+            return;
+        }
+
+        if( ch == '#' || ch == '^' )
+        {
+            emit_name( ch == '^'? sop_inverted_section: sop_section, tag.substr( 1 ) );
+
+            r.code[ r.code_size - 1 ].arg = open_;
+            open_ = r.code_size;
+
+            return;
+        }
+
+        if( ch == '/' )
+        {
+            core::string_view name = static_trim( tag.substr( 1 ) );
+
+            if( open_ == 0 || section_name( open_ - 1 ) != name )
+            {
+                static_template_error( "closing tag doesn't match the open section" );
+            }
+
+            close_section();
+            return;
+        }
+
+        if( ch == '&' )
+        {
+            emit_name( sop_unescaped, tag.substr( 1 ) );
+            return;
+        }
+
+        if( ch == '=' )
+        {
+            static_template_error( "set delimiter tags aren't supported in static templates" );
+        }
+
+        if( ch == '{' )
+        {
+            emit_name( sop_unescaped, tag.substr( 1, tag.size() - 2 ) );
+            return;
+        }
+
+        emit_name( sop_escaped, tag );
+    }
+
+    constexpr std::size_t offset( core::string_view sv ) const
+    {
+        return sv.empty()? 0: static_cast<std::size_t>( sv.data() - text_.data() );
+    }
+
+    constexpr void emit_literal( std::size_t first, std::size_t size )
+    {
+        if( size == 0 )
+        {
+            return;
+        }
+
+        bool line_start = pending_indent_;
+        pending_indent_ = false;
+
+        if( can_merge_ )
+        {
+            static_instruction& last = r.code[ r.code_size - 1 ];
+
+            if( last.first + last.size == first )
+            {
+                last.size += size;
+                return;
+            }
+        }
+
+        push( { sop_literal, first, size, line_start, 0, static_npos } );
+
+        can_merge_ = true;
+    }
+
+    constexpr void emit( static_opcode op, std::size_t first, std::size_t size, std::size_t arg, std::size_t arg_size, std::size_t partial = static_npos )
+    {
+        if( pending_indent_ && op != sop_indent )
+        {
+            emit( sop_indent, 0, 0, 0, 0 );
+        }
+
+        pending_indent_ = false;
+
+        push( { op, first, size, arg, arg_size, partial } );
+
+        can_merge_ = false;
+    }
+
+    constexpr void push( static_instruction const& in )
+    {
+        if( r.code_size == N )
+        {
+            static_template_error( "internal error: too many instructions" );
+        }
+
+        r.code[ r.code_size++ ] = in;
+    }
+
+    constexpr void emit_name( static_opcode op, core::string_view name )
+    {
+        name = static_trim( name );
+
+        if( name.empty() )
+        {
+            static_template_error( "empty tag name" );
+        }
+
+        std::size_t first = r.segments_size;
+
+        if( name != "." )
+        {
+            for( ;; )
+            {
+                std::size_t i = name.find( '.' );
+                core::string_view s = name.substr( 0, i );
+
+                if( s.empty() )
+                {
+                    static_template_error( "empty component in tag name" );
+                }
+
+                if( r.segments_size == M )
+                {
+                    static_template_error( "internal error: too many name components" );
+                }
+
+                r.segments[ r.segments_size++ ] = { offset( s ), s.size() };
+
+                if( i == core::string_view::npos )
+                {
+                    break;
+                }
+
+                name.remove_prefix( i + 1 );
+            }
+        }
+
+        emit( op, first, r.segments_size - first, 0, 0 );
+    }
+
+    constexpr void close_section()
+    {
+        if( pending_indent_ )
+        {
+            emit( sop_indent, 0, 0, 0, 0 );
+        }
+
+        std::size_t i = open_ - 1;
+        open_ = r.code[ i ].arg;
+
+        r.code[ i ].arg = r.code_size - i - 1;
+
+        can_merge_ = false;
+    }
+
+    constexpr core::string_view section_name( std::size_t i ) const
+    {
+        static_instruction const& in = r.code[ i ];
+
+        if( in.size == 0 )
+        {
+            return ".";
+        }
+
+        static_segment const& s1 = r.segments[ in.first ];
+        static_segment const& s2 = r.segments[ in.first + in.size - 1 ];
+
+        return text_.substr( s1.first, s2.first + s2.size - s1.first );
+    }
+};
+
+struct static_sizes
+{
+    std::size_t code;
+    std::size_t segments;
+};
+
+// every instruction but op_indent consumes at least one character, and
+// op_indent precedes another instruction or ends the template
+
+template<std::size_t L, class P> constexpr static_sizes static_compile_sizes( core::string_view text, P const& partials )
+{
+    static_compiler<2 * L + 1, L, P> c( text, partials );
+    c.compile();
+
+    return { c.r.code_size, c.r.segments_size };
+}
+
+template<std::size_t N, std::size_t M, class P> constexpr static_code<N, M> static_compile( core::string_view text, P const& partials )
+{
+    static_compiler<N, M, P> c( text, partials );
+    c.compile();
+
+    return c.r;
+}
+
+template<char const* Text> struct static_text
+{
+    static constexpr core::string_view text = Text;
+};
+
+template<auto const& Partials, std::size_t K> struct static_partial_text
+{
+    static constexpr core::string_view text = Partials[ K ].text;
+};
+
+// a template compiled at compile time, whose text is S::text
+
+template<class S, auto const& Partials> class static_program
+{
+private:
+
+    template<class, auto const&> friend class static_program;
+
+    using partials_type = std::remove_cv_t<std::remove_reference_t<decltype( Partials )>>;
+
+    static constexpr core::string_view text_ = S::text;
+
+    static constexpr static_sizes sizes_ = static_compile_sizes<S::text.size()>( text_, Partials );
+    static constexpr static_code<sizes_.code, sizes_.segments> code_ = static_compile<sizes_.code, sizes_.segments>( text_, Partials );
+
+    // the instructions of [first, last) outside nested sections
+
+    static constexpr std::size_t level_size( std::size_t first, std::size_t last )
+    {
+        std::size_t r = 0;
+
+        for( std::size_t i = first; i < last; ++i )
+        {
+            static_instruction const& in = code_.code[ i ];
+
+            if( in.op == sop_section || in.op == sop_inverted_section )
+            {
+                i += in.arg;
+            }
+
+            ++r;
+        }
+
+        return r;
+    }
+
+    template<std::size_t First, std::size_t Last> static constexpr std::array<std::size_t, level_size( First, Last )> level()
+    {
+        std::array<std::size_t, level_size( First, Last )> r = {};
+        std::size_t j = 0;
+
+        for( std::size_t i = First; i < Last; ++i )
+        {
+            r[ j++ ] = i;
+
+            static_instruction const& in = code_.code[ i ];
+
+            if( in.op == sop_section || in.op == sop_inverted_section )
+            {
+                i += in.arg;
+            }
+        }
+
+        return r;
+    }
+
+    template<std::size_t I> static data_ref lookup( generated::context const* ctx )
+    {
+        constexpr static_instruction in = code_.code[ I ];
+
+        if constexpr( in.size == 0 )
+        {
+            // "."
+            return ctx->value;
+        }
+        else
+        {
+            constexpr static_segment s0 = code_.segments[ in.first ];
+            constexpr core::string_view n = text_.substr( s0.first, s0.size );
+
+            data_ref r = generated::lookup( ctx, n );
+
+            for( std::size_t k = 1; !r.empty() && k < in.size; ++k )
+            {
+                static_segment const& s = code_.segments[ in.first + k ];
+                r = r.lookup( text_.substr( s.first, s.size ) );
+            }
+
+            return r;
+        }
+    }
+
+    // as renderer::render_compiled_section
+
+    template<std::size_t I> static void render_section( data_ref p, output_ref out, generated::context const* ctx, generated::indent const* ind )
+    {
+        constexpr static_instruction in = code_.code[ I ];
+
+        constexpr std::size_t first = I + 1;
+        constexpr std::size_t last = first + in.arg;
+
+        constexpr bool inverted = in.op == sop_inverted_section;
+
+        if constexpr( inverted )
+        {
+            if( !p.is_true() )
+            {
+                render_range<first, last>( out, ctx, ind );
+            }
+        }
+        else
+        {
+            generated::render_section( p, ctx, [&]( generated::context const* c ){ render_range<first, last>( out, c, ind ); } );
+        }
+    }
+
+    template<std::size_t I> static void render_instruction( output_ref out, generated::context const* ctx, generated::indent const* ind )
+    {
+        constexpr static_instruction in = code_.code[ I ];
+
+        if constexpr( in.op == sop_literal )
+        {
+            generated::write_literal( out, text_.substr( in.first, in.size ), in.arg != 0, ind );
+        }
+        else if constexpr( in.op == sop_indent )
+        {
+            generated::write_indent( out, ind );
+        }
+        else if constexpr( in.op == sop_escaped || in.op == sop_unescaped )
+        {
+            lookup<I>( ctx ).output( out, in.op == sop_escaped );
+        }
+        else if constexpr( in.op == sop_section || in.op == sop_inverted_section )
+        {
+            render_section<I>( lookup<I>( ctx ), out, ctx, ind );
+        }
+        else if constexpr( in.partial != static_npos )
+        {
+            using P = static_program<static_partial_text<Partials, in.partial>, Partials>;
+
+            if constexpr( in.op == sop_standalone_partial )
+            {
+                // the partial is indented by the whitespace before the tag
+
+                generated::indent si = { text_.substr( in.arg, in.arg_size ), ind };
+                P::render( out, ctx, &si );
+            }
+            else
+            {
+                // a partial that isn't standalone isn't indented
+                P::render( out, ctx, nullptr );
+            }
+        }
+    }
+
+    template<std::size_t First, std::size_t Last, std::size_t... J> static void render_level( std::index_sequence<J...>, output_ref out, generated::context const* ctx, generated::indent const* ind )
+    {
+        // unused when the range is empty
+        (void)out, (void)ctx, (void)ind;
+
+        ( render_instruction<level<First, Last>()[ J ]>( out, ctx, ind ), ... );
+    }
+
+    template<std::size_t First, std::size_t Last> static void render_range( output_ref out, generated::context const* ctx, generated::indent const* ind )
+    {
+        render_level<First, Last>( std::make_index_sequence<level_size( First, Last )>(), out, ctx, ind );
+    }
+
+public:
+
+    static void render( output_ref out, generated::context const* ctx, generated::indent const* ind )
+    {
+        render_range<0, code_.code_size>( out, ctx, ind );
+    }
+};
+
+} // namespace detail
+
+// a template parsed at compile time, whose literal runs are written as
+// constants and whose names are looked up without parsing; Text is a
+// string with static storage duration, and Partials an array of
+// static_partial, to which partial tags are resolved at compile time
+//
+// Unclosed sections, unmatched closing tags, incomplete tags, and set
+// delimiter tags are compile errors. Recursive partials aren't supported.
+
+template<char const* Text, auto const& Partials = no_static_partials> class static_template
+{
+private:
+
+    using program = detail::static_program<detail::static_text<Text>, Partials>;
+
+public:
+
+    // renders the template with data, accessed in place
+    void render( output_ref out, data_ref data ) const
+    {
+        char buffer[ 1024 ];
+        buffered_output bo( out, buffer, sizeof( buffer ) );
+
+        generated::render_scope scope;
+
+        generated::context ctx = { data, nullptr };
+        program::render( bo, &ctx, nullptr );
+
+        bo.flush();
+    }
+};
+
+template<char const* Text, auto const& Partials> void render( static_template<Text, Partials> const& tmpl, output_ref out, data_ref data )
+{
+    tmpl.render( out, data );
+}
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_STATIC_TEMPLATE_HPP_INCLUDED
@@ -0,0 +1,142 @@
+#ifndef BOOST_MUSTACHE_STREAM_RENDERER_HPP_INCLUDED
+#define BOOST_MUSTACHE_STREAM_RENDERER_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/renderer.hpp>
+#include <boost/mustache/compiled_template.hpp>
+#include <boost/mustache/output_ref.hpp>
+#include <boost/mustache/config.hpp>
+#include <boost/json/stream_parser.hpp>
+#include <boost/json/value.hpp>
+#include <boost/json/array.hpp>
+#include <boost/json/object.hpp>
+#include <boost/json/string.hpp>
+#include <boost/json/storage_ptr.hpp>
+#include <boost/core/detail/string_view.hpp>
+#include <cstddef>
+
+namespace boost
+{
+namespace mustache
+{
+
+// renders a compiled template while its data is parsed from JSON text
+//
+// The members of a top-level object are parsed one at a time, and the
+// template is rendered as far as the members parsed so far allow. A
+// top-level list section whose array arrives when the template needs it,
+// and which isn't referred to elsewhere, is rendered an element at a time
+// as the elements are parsed, without keeping them. Other members are kept
+// until the end of the document.
+
+class stream_renderer
+{
+private:
+
+    enum state
+    {
+        state_start,
+        state_whole,
+        state_first_key,
+        state_key,
+        state_next_key,
+        state_key_string,
+        state_colon,
+        state_value,
+        state_member,
+        state_first_item,
+        state_item,
+        state_next_item,
+        state_item_value,
+        state_end,
+    };
+
+private:
+
+    compiled_template const* tmpl_;
+
+    json::storage_ptr sp_;
+
+    // the members parsed so far
+    json::value root_;
+
+    renderer rd_;
+
+    json::stream_parser parser_;
+
+    state state_ = state_start;
+
+    // the scanning of the value being parsed: its nesting depth,
+    // whether inside a string, after a backslash, and whether the
+    // value has ended
+    std::size_t depth_ = 0;
+    bool in_string_ = false;
+    bool escape_ = false;
+    bool ended_ = false;
+
+    // the key of the member being parsed
+    json::string key_;
+
+    // the next top-level instruction to render
+    std::size_t pc_ = 0;
+
+    // whether the rendering waits for the member root_missed_ of rd_,
+    // or for the end of the document when rd_.root_used_ is set
+    bool waiting_ = false;
+
+    // whether the document has been parsed completely
+    bool complete_ = false;
+
+    // the elements of the streamed list section at pc_ not yet rendered,
+    // and whether more are to be parsed
+    bool section_ = false;
+    bool section_open_ = false;
+
+    json::array items_;
+    std::size_t item_pos_ = 0;
+
+    // the output of instructions rendered before the document is complete,
+    // discarded when they need a member not yet parsed
+    json::string scratch_;
+
+private:
+
+    BOOST_MUSTACHE_DECL void write_impl( core::string_view in, output_ref out );
+
+    BOOST_MUSTACHE_DECL std::size_t scan( core::string_view in );
+
+    BOOST_MUSTACHE_DECL bool can_stream();
+    BOOST_MUSTACHE_DECL std::size_t count_references( compiled_template const& tmpl, core::string_view name ) const;
+    BOOST_MUSTACHE_DECL static bool uses_root( compiled_template const& tmpl );
+
+    BOOST_MUSTACHE_DECL void add_member( output_ref out );
+    BOOST_MUSTACHE_DECL void add_item( output_ref out );
+    BOOST_MUSTACHE_DECL void end_items( output_ref out );
+    BOOST_MUSTACHE_DECL void end_document( output_ref out );
+
+    BOOST_MUSTACHE_DECL void run( output_ref out );
+    BOOST_MUSTACHE_DECL bool render_items( output_ref out );
+    BOOST_MUSTACHE_DECL bool try_render( std::size_t first, std::size_t last, output_ref out );
+
+public:
+
+    BOOST_MUSTACHE_DECL stream_renderer( compiled_template const& tmpl, json::object const& partials, json::storage_ptr sp = {} );
+
+    stream_renderer( stream_renderer const& ) = delete;
+    stream_renderer& operator=( stream_renderer const& ) = delete;
+
+    // consumes the next part of the JSON data from in, and outputs the
+    // part of the template rendered so far
+    BOOST_MUSTACHE_DECL void write( core::string_view in, output_ref out );
+
+    // called once at the end of the data; outputs the rest
+    BOOST_MUSTACHE_DECL void finish( output_ref out );
+};
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_STREAM_RENDERER_HPP_INCLUDED
@@ -0,0 +1,112 @@
+#ifndef BOOST_MUSTACHE_TEMPLATE_CACHE_HPP_INCLUDED
+#define BOOST_MUSTACHE_TEMPLATE_CACHE_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/compiled_template.hpp>
+#include <boost/mustache/config.hpp>
+#include <boost/core/detail/string_view.hpp>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace boost
+{
+namespace mustache
+{
+
+struct template_cache_stats
+{
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+
+    // the templates currently in the cache, and their estimated size
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+};
+
+// compiled templates, keyed by a hash of the template text and the initial
+// delimiters, evicted least recently used first when their total size
+// exceeds the capacity; safe to use concurrently from multiple threads
+
+class template_cache
+{
+private:
+
+    struct entry
+    {
+        std::uint64_t hash;
+
+        std::string start_delim;
+        std::string end_delim;
+
+        std::shared_ptr<compiled_template const> tmpl;
+
+        std::size_t bytes;
+    };
+
+    // the keys are distributed over the shards by hash, and each shard
+    // has its own lock, list, and counters, so that threads looking up
+    // different templates rarely contend
+
+    struct shard
+    {
+        std::mutex mx;
+
+        // most recently used first
+        std::list<entry> lru;
+
+        // on a hash collision, the entry is replaced
+        std::unordered_map<std::uint64_t, std::list<entry>::iterator> index;
+
+        std::size_t bytes = 0;
+
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+    };
+
+    std::unique_ptr<shard[]> shards_;
+    std::size_t shard_count_;
+
+    // the capacity of each shard
+    std::size_t shard_bytes_;
+
+private:
+
+    BOOST_MUSTACHE_DECL static std::size_t memory_size( compiled_template const& tmpl ) noexcept;
+
+    // removes the least recently used entries until sh.bytes + n <= shard_bytes_
+    BOOST_MUSTACHE_DECL void evict( shard& sh, std::size_t n );
+
+public:
+
+    // the capacity is split evenly between the shards
+    BOOST_MUSTACHE_DECL explicit template_cache( std::size_t max_bytes = 16 * 1048576, std::size_t shards = 16 );
+    BOOST_MUSTACHE_DECL ~template_cache();
+
+    template_cache( template_cache const& ) = delete;
+    template_cache& operator=( template_cache const& ) = delete;
+
+    // the compiled template, from the cache, or compiled and inserted;
+    // remains valid while referenced, even after it has been evicted
+    BOOST_MUSTACHE_DECL std::shared_ptr<compiled_template const> get( core::string_view tmpl, core::string_view start_delim = "{{", core::string_view end_delim = "}}" );
+
+    BOOST_MUSTACHE_DECL template_cache_stats stats() const;
+
+    // removes all entries; the counters are kept
+    BOOST_MUSTACHE_DECL void clear();
+};
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_TEMPLATE_CACHE_HPP_INCLUDED
@@ -0,0 +1,99 @@
+#ifndef BOOST_MUSTACHE_TEMPLATE_SET_HPP_INCLUDED
+#define BOOST_MUSTACHE_TEMPLATE_SET_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/partial_registry.hpp>
+#include <boost/mustache/render.hpp>
+#include <boost/mustache/config.hpp>
+#include <boost/json/object.hpp>
+#include <boost/core/detail/string_view.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+
+namespace boost
+{
+namespace mustache
+{
+
+// a set of named templates, which are also each other's partials, that
+// can be replaced while being rendered; a render uses the snapshot current
+// when it starts until it finishes, and the read path takes no lock
+
+class template_set
+{
+private:
+
+    // the snapshot is in one of two slots; a reader announces itself in
+    // the slot it's about to read, then checks the slot is still current,
+    // and a publisher waits for the readers of a slot to leave before
+    // writing to it
+
+    struct slot
+    {
+        std::atomic<std::size_t> readers{ 0 };
+        std::shared_ptr<partial_registry const> snapshot;
+    };
+
+    mutable slot slots_[ 2 ];
+    std::atomic<unsigned> current_;
+
+    // serializes the publishers
+    std::mutex mx_;
+
+public:
+
+    // an empty set
+    BOOST_MUSTACHE_DECL template_set();
+
+    BOOST_MUSTACHE_DECL explicit template_set( std::shared_ptr<partial_registry const> templates );
+
+    explicit template_set( json::object const& templates ):
+        template_set( std::make_shared<partial_registry>( templates ) )
+    {
+    }
+
+    BOOST_MUSTACHE_DECL ~template_set();
+
+    template_set( template_set const& ) = delete;
+    template_set& operator=( template_set const& ) = delete;
+
+    // the current snapshot; never null
+    BOOST_MUSTACHE_DECL std::shared_ptr<partial_registry const> snapshot() const;
+
+    // makes templates the current snapshot; the previous one is destroyed
+    // when the last render using it finishes
+    BOOST_MUSTACHE_DECL void publish( std::shared_ptr<partial_registry const> templates );
+
+    void publish( json::object const& templates )
+    {
+        publish( std::make_shared<partial_registry>( templates ) );
+    }
+
+    // renders the template name of the current snapshot, with the others
+    // as partials; returns false, without output, when there's no such template
+
+    template<class T1 = json::value> bool render( core::string_view name, output_ref out, T1 const& data ) const
+    {
+        std::shared_ptr<partial_registry const> p = snapshot();
+
+        compiled_template const* tmpl = p->find( name );
+
+        if( tmpl == nullptr )
+        {
+            return false;
+        }
+
+        mustache::render( *tmpl, out, data, *p );
+        return true;
+    }
+};
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_TEMPLATE_SET_HPP_INCLUDED
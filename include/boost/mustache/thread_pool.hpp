@@ -0,0 +1,81 @@
+#ifndef BOOST_MUSTACHE_THREAD_POOL_HPP_INCLUDED
+#define BOOST_MUSTACHE_THREAD_POOL_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/config.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+namespace boost
+{
+namespace mustache
+{
+
+class renderer;
+
+// worker threads, shared by the renderers attached to them with
+// renderer::set_thread_pool, on which large list sections are rendered
+
+class thread_pool
+{
+private:
+
+    friend class renderer;
+
+    // a task is run by all the workers that pick it up while it's
+    // posted; it returns when it has no more work to hand out
+    struct task
+    {
+        void (*f)( void* ctx );
+        void* ctx;
+
+        // the number of workers currently running it
+        std::size_t running;
+
+        // whether it's still in the queue
+        bool posted;
+    };
+
+    std::mutex mx_;
+    std::condition_variable cv_;
+
+    // the posted tasks, oldest first
+    std::vector<task*> tasks_;
+
+    bool stop_ = false;
+
+    std::vector<std::thread> threads_;
+
+private:
+
+    BOOST_MUSTACHE_DECL void run();
+
+    BOOST_MUSTACHE_DECL void post( task& t );
+
+    // removes t from the queue, and waits for the workers running it
+    BOOST_MUSTACHE_DECL void retract( task& t );
+
+public:
+
+    BOOST_MUSTACHE_DECL explicit thread_pool( std::size_t threads = std::thread::hardware_concurrency() );
+    BOOST_MUSTACHE_DECL ~thread_pool();
+
+    thread_pool( thread_pool const& ) = delete;
+    thread_pool& operator=( thread_pool const& ) = delete;
+
+    std::size_t size() const noexcept
+    {
+        return threads_.size();
+    }
+};
+
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_THREAD_POOL_HPP_INCLUDED
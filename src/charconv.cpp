@@ -0,0 +1,500 @@
+// Copyright 2018 Ulf Adams
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// The shortest representation of a double is computed with the
+// Ryu algorithm (https://github.com/ulfjack/ryu), which is also
+// available under the Boost Software License
+
+#include "charconv.hpp"
+#include "d2s_tables.hpp"
+#include <boost/config.hpp>
+#include <cstring>
+
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+# include <intrin.h>
+#endif
+
+namespace
+{
+
+// integers
+
+char const digit_pairs[] =
+
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+int decimal_length( std::uint64_t v ) noexcept
+{
+    int n = 1;
+
+    for( ;; )
+    {
+        if( v < 10 ) return n;
+        if( v < 100 ) return n + 1;
+        if( v < 1000 ) return n + 2;
+        if( v < 10000 ) return n + 3;
+
+        v /= 10000;
+        n += 4;
+    }
+}
+
+// writes exactly n digits of v ending at last, two at a time
+
+void write_digits( char* last, std::uint64_t v, int n ) noexcept
+{
+    while( n >= 2 )
+    {
+        unsigned r = static_cast<unsigned>( v % 100 );
+        v /= 100;
+
+        last -= 2;
+        std::memcpy( last, digit_pairs + 2 * r, 2 );
+
+        n -= 2;
+    }
+
+    if( n > 0 )
+    {
+        *--last = static_cast<char>( '0' + v );
+    }
+}
+
+// 128 bit arithmetic
+
+#if defined(BOOST_HAS_INT128)
+
+inline std::uint64_t mul_shift_64( std::uint64_t m, std::uint64_t const* mul, int j ) noexcept
+{
+    boost::uint128_type b0 = static_cast<boost::uint128_type>( m ) * mul[ 0 ];
+    boost::uint128_type b2 = static_cast<boost::uint128_type>( m ) * mul[ 1 ];
+
+    return static_cast<std::uint64_t>( ( ( b0 >> 64 ) + b2 ) >> ( j - 64 ) );
+}
+
+#else
+
+inline std::uint64_t umul128( std::uint64_t a, std::uint64_t b, std::uint64_t* hi ) noexcept
+{
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+
+    return _umul128( a, b, hi );
+
+#else
+
+    std::uint64_t a0 = static_cast<std::uint32_t>( a ), a1 = a >> 32;
+    std::uint64_t b0 = static_cast<std::uint32_t>( b ), b1 = b >> 32;
+
+    std::uint64_t p00 = a0 * b0;
+    std::uint64_t p01 = a0 * b1;
+    std::uint64_t p10 = a1 * b0;
+    std::uint64_t p11 = a1 * b1;
+
+    std::uint64_t mid = ( p00 >> 32 ) + static_cast<std::uint32_t>( p01 ) + static_cast<std::uint32_t>( p10 );
+
+    *hi = p11 + ( p01 >> 32 ) + ( p10 >> 32 ) + ( mid >> 32 );
+    return ( mid << 32 ) | static_cast<std::uint32_t>( p00 );
+
+#endif
+}
+
+inline std::uint64_t mul_shift_64( std::uint64_t m, std::uint64_t const* mul, int j ) noexcept
+{
+    std::uint64_t high1;
+    std::uint64_t const low1 = umul128( m, mul[ 1 ], &high1 );
+
+    std::uint64_t high0;
+    umul128( m, mul[ 0 ], &high0 );
+
+    std::uint64_t const sum = high0 + low1;
+
+    if( sum < high0 )
+    {
+        ++high1;
+    }
+
+    // 0 < j - 64 < 64
+    int const dist = j - 64;
+    return ( high1 << ( 64 - dist ) ) | ( sum >> dist );
+}
+
+#endif
+
+// Ryu helpers
+
+inline int pow5_bits( int e ) noexcept
+{
+    // ceil( log2( 5^e ) ), or 1 for e == 0
+    return static_cast<int>( ( static_cast<std::uint32_t>( e ) * 1217359 ) >> 19 ) + 1;
+}
+
+inline int log10_pow2( int e ) noexcept
+{
+    // floor( log10( 2^e ) )
+    return static_cast<int>( ( static_cast<std::uint32_t>( e ) * 78913 ) >> 18 );
+}
+
+inline int log10_pow5( int e ) noexcept
+{
+    // floor( log10( 5^e ) )
+    return static_cast<int>( ( static_cast<std::uint32_t>( e ) * 732923 ) >> 20 );
+}
+
+inline bool multiple_of_power_of_5( std::uint64_t v, int p ) noexcept
+{
+    int n = 0;
+
+    while( v % 5 == 0 )
+    {
+        v /= 5;
+        ++n;
+    }
+
+    return n >= p;
+}
+
+inline bool multiple_of_power_of_2( std::uint64_t v, int p ) noexcept
+{
+    return ( v & ( ( std::uint64_t( 1 ) << p ) - 1 ) ) == 0;
+}
+
+struct decimal
+{
+    std::uint64_t mantissa;
+    int exponent;
+};
+
+// returns the shortest decimal that converts back to the finite
+// nonzero double with the given mantissa and exponent bits
+
+decimal d2d( std::uint64_t ieee_mantissa, std::uint32_t ieee_exponent ) noexcept
+{
+    using boost::mustache::detail::double_pow5_inv_split;
+    using boost::mustache::detail::double_pow5_split;
+
+    int const mantissa_bits = 52;
+    int const bias = 1023;
+    int const pow5_bitcount = 125;
+
+    int e2;
+    std::uint64_t m2;
+
+    if( ieee_exponent == 0 )
+    {
+        e2 = 1 - bias - mantissa_bits - 2;
+        m2 = ieee_mantissa;
+    }
+    else
+    {
+        e2 = static_cast<int>( ieee_exponent ) - bias - mantissa_bits - 2;
+        m2 = ( std::uint64_t( 1 ) << mantissa_bits ) | ieee_mantissa;
+    }
+
+    bool const accept_bounds = ( m2 & 1 ) == 0;
+
+    // the interval of valid representations is [mm, mp] / 4 * 2^e2
+
+    std::uint64_t const mv = 4 * m2;
+    std::uint32_t const mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+
+    std::uint64_t vr, vp, vm;
+    int e10;
+
+    bool vm_is_trailing_zeros = false;
+    bool vr_is_trailing_zeros = false;
+
+    if( e2 >= 0 )
+    {
+        int const q = log10_pow2( e2 ) - ( e2 > 3 );
+        e10 = q;
+
+        int const k = pow5_bitcount + pow5_bits( q ) - 1;
+        int const i = -e2 + q + k;
+
+        vr = mul_shift_64( 4 * m2, double_pow5_inv_split[ q ], i );
+        vp = mul_shift_64( 4 * m2 + 2, double_pow5_inv_split[ q ], i );
+        vm = mul_shift_64( 4 * m2 - 1 - mm_shift, double_pow5_inv_split[ q ], i );
+
+        if( q <= 21 )
+        {
+            // only one of mp, mv, and mm can be a multiple of 5, if any
+
+            if( mv % 5 == 0 )
+            {
+                vr_is_trailing_zeros = multiple_of_power_of_5( mv, q );
+            }
+            else if( accept_bounds )
+            {
+                vm_is_trailing_zeros = multiple_of_power_of_5( mv - 1 - mm_shift, q );
+            }
+            else
+            {
+                vp -= multiple_of_power_of_5( mv + 2, q );
+            }
+        }
+    }
+    else
+    {
+        int const q = log10_pow5( -e2 ) - ( -e2 > 1 );
+        e10 = q + e2;
+
+        int const i = -e2 - q;
+        int const k = pow5_bits( i ) - pow5_bitcount;
+        int const j = q - k;
+
+        vr = mul_shift_64( 4 * m2, double_pow5_split[ i ], j );
+        vp = mul_shift_64( 4 * m2 + 2, double_pow5_split[ i ], j );
+        vm = mul_shift_64( 4 * m2 - 1 - mm_shift, double_pow5_split[ i ], j );
+
+        if( q <= 1 )
+        {
+            // mv = 4 * m2 has at least two trailing zero bits
+            vr_is_trailing_zeros = true;
+
+            if( accept_bounds )
+            {
+                vm_is_trailing_zeros = mm_shift == 1;
+            }
+            else
+            {
+                --vp;
+            }
+        }
+        else if( q < 63 )
+        {
+            vr_is_trailing_zeros = multiple_of_power_of_2( mv, q );
+        }
+    }
+
+    // remove digits while the interval still contains a shorter number
+
+    int removed = 0;
+    std::uint64_t output;
+
+    if( vm_is_trailing_zeros || vr_is_trailing_zeros )
+    {
+        // rare general case
+
+        unsigned last_removed_digit = 0;
+
+        while( vp / 10 > vm / 10 )
+        {
+            vm_is_trailing_zeros &= vm % 10 == 0;
+            vr_is_trailing_zeros &= last_removed_digit == 0;
+
+            last_removed_digit = static_cast<unsigned>( vr % 10 );
+
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+
+            ++removed;
+        }
+
+        if( vm_is_trailing_zeros )
+        {
+            while( vm % 10 == 0 )
+            {
+                vr_is_trailing_zeros &= last_removed_digit == 0;
+
+                last_removed_digit = static_cast<unsigned>( vr % 10 );
+
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+
+                ++removed;
+            }
+        }
+
+        if( vr_is_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0 )
+        {
+            // round to even if the exact number is ...50..0
+            last_removed_digit = 4;
+        }
+
+        output = vr + ( ( vr == vm && ( !accept_bounds || !vm_is_trailing_zeros ) ) || last_removed_digit >= 5 );
+    }
+    else
+    {
+        // common case
+
+        bool round_up = false;
+
+        if( vp / 100 > vm / 100 )
+        {
+            round_up = vr % 100 >= 50;
+
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+
+            removed += 2;
+        }
+
+        while( vp / 10 > vm / 10 )
+        {
+            round_up = vr % 10 >= 5;
+
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+
+            ++removed;
+        }
+
+        output = vr + ( vr == vm || round_up );
+    }
+
+    return { output, e10 + removed };
+}
+
+char* write_special( char* p, char const* s ) noexcept
+{
+    std::size_t n = std::strlen( s );
+
+    std::memcpy( p, s, n );
+    return p + n;
+}
+
+} // unnamed namespace
+
+char* boost::mustache::detail::format_uint64( char* first, std::uint64_t v ) noexcept
+{
+    int n = decimal_length( v );
+
+    write_digits( first + n, v, n );
+    return first + n;
+}
+
+char* boost::mustache::detail::format_int64( char* first, std::int64_t v ) noexcept
+{
+    std::uint64_t w = static_cast<std::uint64_t>( v );
+
+    if( v < 0 )
+    {
+        *first++ = '-';
+        w = 0 - w;
+    }
+
+    return format_uint64( first, w );
+}
+
+char* boost::mustache::detail::format_double( char* first, double v ) noexcept
+{
+    std::uint64_t bits;
+    std::memcpy( &bits, &v, sizeof( bits ) );
+
+    std::uint64_t const ieee_mantissa = bits & ( ( std::uint64_t( 1 ) << 52 ) - 1 );
+    std::uint32_t const ieee_exponent = static_cast<std::uint32_t>( ( bits >> 52 ) & 0x7FF );
+
+    char* p = first;
+
+    if( bits >> 63 )
+    {
+        *p++ = '-';
+    }
+
+    if( ieee_exponent == 0x7FF )
+    {
+        return write_special( p, ieee_mantissa == 0? "inf": "nan" );
+    }
+
+    if( ieee_exponent == 0 && ieee_mantissa == 0 )
+    {
+        *p++ = '0';
+        return p;
+    }
+
+    decimal d = d2d( ieee_mantissa, ieee_exponent );
+
+    while( d.mantissa % 10 == 0 )
+    {
+        d.mantissa /= 10;
+        ++d.exponent;
+    }
+
+    char digits[ 20 ];
+
+    int const n = decimal_length( d.mantissa );
+    write_digits( digits + n, d.mantissa, n );
+
+    // the exponent in scientific notation
+    int const x = d.exponent + n - 1;
+
+    // the rules of "%.16g", without trailing zeros
+
+    if( x < -4 || x >= 16 )
+    {
+        *p++ = digits[ 0 ];
+
+        if( n > 1 )
+        {
+            *p++ = '.';
+
+            std::memcpy( p, digits + 1, n - 1 );
+            p += n - 1;
+        }
+
+        *p++ = 'e';
+        *p++ = x < 0? '-': '+';
+
+        int ax = x < 0? -x: x;
+
+        if( ax >= 100 )
+        {
+            *p++ = static_cast<char>( '0' + ax / 100 );
+            ax %= 100;
+        }
+
+        std::memcpy( p, digit_pairs + 2 * ax, 2 );
+        p += 2;
+    }
+    else if( x >= 0 )
+    {
+        int const m = x + 1; // digits before the decimal point
+
+        if( n <= m )
+        {
+            std::memcpy( p, digits, n );
+            p += n;
+
+            std::memset( p, '0', m - n );
+            p += m - n;
+        }
+        else
+        {
+            std::memcpy( p, digits, m );
+            p += m;
+
+            *p++ = '.';
+
+            std::memcpy( p, digits + m, n - m );
+            p += n - m;
+        }
+    }
+    else
+    {
+        *p++ = '0';
+        *p++ = '.';
+
+        std::memset( p, '0', -x - 1 );
+        p += -x - 1;
+
+        std::memcpy( p, digits, n );
+        p += n;
+    }
+
+    return p;
+}
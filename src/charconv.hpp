@@ -0,0 +1,33 @@
+#ifndef BOOST_MUSTACHE_SRC_CHARCONV_HPP_INCLUDED
+#define BOOST_MUSTACHE_SRC_CHARCONV_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// number formatting for interpolated values; independent of
+// the C locale, and producing the same output everywhere
+
+#include <cstdint>
+
+namespace boost
+{
+namespace mustache
+{
+namespace detail
+{
+
+// these write to [first, first + 32) and return the end of the output
+
+char* format_int64( char* first, std::int64_t v ) noexcept;
+char* format_uint64( char* first, std::uint64_t v ) noexcept;
+
+// formats v in the style of printf "%.16g", but with the shortest
+// sequence of digits that converts back to v
+char* format_double( char* first, double v ) noexcept;
+
+} // namespace detail
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_SRC_CHARCONV_HPP_INCLUDED
@@ -0,0 +1,626 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/compiled_template.hpp>
+#include "utility.hpp"
+#include "scan.hpp"
+#include <boost/throw_exception.hpp>
+#include <boost/assert.hpp>
+#include <stdexcept>
+#include <limits>
+#include <utility>
+
+// The compiler makes a single pass over the template text and produces
+// the same output as the renderer state machine would, but instead of
+// writing the output, it records it as instructions: literal runs (with
+// the whitespace and line endings of standalone lines already removed),
+// interpolations, sections, and partials.
+
+class boost::mustache::compiled_template::compiler
+{
+private:
+
+    enum tag_result
+    {
+        // not a start delimiter, the first tag.end - p characters are literal
+        tag_none,
+
+        // a start delimiter without an end delimiter; dropped
+        tag_incomplete,
+
+        // a complete tag
+        tag_complete
+    };
+
+    struct tag_info
+    {
+        // tag contents, between the delimiters
+        core::string_view text;
+
+        // the position after the end delimiter
+        std::size_t end;
+
+        // whether the tag is a triple mustache
+        bool triple;
+    };
+
+private:
+
+    compiled_template& tmpl_;
+    core::string_view text_;
+
+    core::string_view start_delim_;
+    core::string_view end_delim_;
+
+    // whether the end of input terminates a standalone line
+    bool eof_line_end_;
+
+    // one past the index in code_ of the innermost open section, or 0;
+    // the arg of an open section links to the enclosing one in the
+    // same way, until the section is closed
+    std::size_t open_ = 0;
+
+    // whether a line has started and nothing has been output for it yet;
+    // the indentation is output before the next instruction
+    bool pending_indent_ = false;
+
+    // whether the last instruction is a literal that can be extended
+    bool can_merge_ = false;
+
+public:
+
+    compiler( compiled_template& tmpl, core::string_view start_delim, core::string_view end_delim, bool eof_line_end ):
+        tmpl_( tmpl ), text_( tmpl.text_ ), start_delim_( start_delim ), end_delim_( end_delim ), eof_line_end_( eof_line_end )
+    {
+    }
+
+    void compile( bool line_start );
+
+private:
+
+    std::uint32_t offset( core::string_view sv ) const
+    {
+        return static_cast<std::uint32_t>( sv.data() - text_.data() );
+    }
+
+    std::size_t skip_whitespace( std::size_t pos ) const;
+    std::size_t find_line_end_or_delim( std::size_t pos ) const;
+    std::size_t line_ending_size( std::size_t pos ) const;
+
+    tag_result parse_tag( std::size_t pos, tag_info& tag ) const;
+
+    void handle_tag( core::string_view tag, core::string_view wsp, bool standalone );
+
+    void emit_literal( std::size_t first, std::size_t size );
+    void emit( opcode op, std::uint32_t first, std::uint32_t size, std::uint32_t arg, std::uint32_t arg_size );
+    void emit_name( opcode op, core::string_view name );
+
+    void open_section( core::string_view name, bool inverted );
+    void close_section();
+
+    core::string_view section_name( std::size_t i ) const;
+};
+
+std::size_t boost::mustache::compiled_template::compiler::skip_whitespace( std::size_t pos ) const
+{
+    char const* p = text_.data();
+    return detail::skip_spaces( p + pos, p + text_.size() ) - p;
+}
+
+std::size_t boost::mustache::compiled_template::compiler::find_line_end_or_delim( std::size_t pos ) const
+{
+    char const* p = text_.data();
+    return detail::find_either( p + pos, p + text_.size(), '\n', start_delim_[ 0 ] ) - p;
+}
+
+// returns the size of the line ending at pos, zero at end of input
+// (if eof_line_end_), or npos when pos isn't at a line ending
+
+std::size_t boost::mustache::compiled_template::compiler::line_ending_size( std::size_t pos ) const
+{
+    core::string_view rest = text_.substr( pos );
+
+    if( rest.empty() )
+    {
+        return eof_line_end_? 0: core::string_view::npos;
+    }
+
+    if( rest[ 0 ] == '\n' )
+    {
+        return 1;
+    }
+
+    if( rest.size() >= 2 && rest[ 0 ] == '\r' && rest[ 1 ] == '\n' )
+    {
+        return 2;
+    }
+
+    return core::string_view::npos;
+}
+
+// matches the delimiters in the same way as the renderer does,
+// one character at a time, restarting after a mismatch
+
+boost::mustache::compiled_template::compiler::tag_result boost::mustache::compiled_template::compiler::parse_tag( std::size_t pos, tag_info& tag ) const
+{
+    std::size_t const n = text_.size();
+
+    std::size_t k = 0;
+
+    while( k < start_delim_.size() && pos + k < n && text_[ pos + k ] == start_delim_[ k ] )
+    {
+        ++k;
+    }
+
+    if( k < start_delim_.size() )
+    {
+        BOOST_ASSERT( k > 0 );
+
+        tag.end = pos + k;
+        return tag_none;
+    }
+
+    std::size_t first = pos + k;
+    std::size_t i = first;
+
+    for( ;; )
+    {
+        i = text_.find( end_delim_[ 0 ], i );
+
+        if( i == core::string_view::npos )
+        {
+            return tag_incomplete;
+        }
+
+        k = 0;
+
+        while( k < end_delim_.size() && i + k < n && text_[ i + k ] == end_delim_[ k ] )
+        {
+            ++k;
+        }
+
+        if( k == end_delim_.size() )
+        {
+            break;
+        }
+
+        if( i + k == n )
+        {
+            return tag_incomplete;
+        }
+
+        i += k;
+    }
+
+    tag.text = text_.substr( first, i - first );
+    tag.end = i + k;
+    tag.triple = false;
+
+    if( end_delim_ == "}}" && !tag.text.empty() && tag.text.front() == '{' )
+    {
+        // "{{{ something }}}"; the closing brace is part of the tag
+
+        tag.triple = true;
+
+        if( tag.end < n && text_[ tag.end ] == '}' )
+        {
+            tag.text = text_.substr( first, i + 1 - first );
+            ++tag.end;
+        }
+    }
+
+    return tag_complete;
+}
+
+void boost::mustache::compiled_template::compiler::compile( bool line_start )
+{
+    std::size_t const n = text_.size();
+    std::size_t pos = 0;
+
+    while( pos < n )
+    {
+        if( line_start )
+        {
+            line_start = false;
+
+            std::size_t p = skip_whitespace( pos );
+
+            tag_info tag;
+
+            if( p < n && text_[ p ] == start_delim_[ 0 ] && parse_tag( p, tag ) == tag_complete && !tag.triple && detail::is_tag_standalone( tag.text ) )
+            {
+                std::size_t m = line_ending_size( tag.end );
+
+                if( m != core::string_view::npos )
+                {
+                    // standalone tag, drop the whitespace and the line ending
+
+                    handle_tag( tag.text, text_.substr( pos, p - pos ), true );
+
+                    pos = tag.end + m;
+                    line_start = true;
+
+                    continue;
+                }
+            }
+
+            pending_indent_ = true;
+
+            emit_literal( pos, p - pos );
+            pos = p;
+
+            continue;
+        }
+
+        std::size_t p = find_line_end_or_delim( pos );
+
+        if( p == n )
+        {
+            emit_literal( pos, n - pos );
+            pos = n;
+
+            break;
+        }
+
+        if( text_[ p ] == '\n' )
+        {
+            emit_literal( pos, p + 1 - pos );
+            pos = p + 1;
+
+            line_start = true;
+            continue;
+        }
+
+        emit_literal( pos, p - pos );
+
+        tag_info tag;
+
+        switch( parse_tag( p, tag ) )
+        {
+        case tag_none:
+
+            emit_literal( p, tag.end - p );
+            pos = tag.end;
+
+            break;
+
+        case tag_incomplete:
+
+            pos = n;
+            break;
+
+        case tag_complete:
+
+            handle_tag( tag.text, core::string_view(), false );
+            pos = tag.end;
+
+            break;
+        }
+    }
+
+    if( open_ != 0 )
+    {
+        // unclosed sections produce no output
+
+        std::size_t i = open_ - 1;
+
+        while( tmpl_.code_buffer_[ i ].arg != 0 )
+        {
+            i = tmpl_.code_buffer_[ i ].arg - 1;
+        }
+
+        tmpl_.code_buffer_.resize( i );
+    }
+    else if( pending_indent_ )
+    {
+        emit( op_indent, 0, 0, 0, 0 );
+    }
+}
+
+void boost::mustache::compiled_template::compiler::handle_tag( core::string_view tag, core::string_view wsp, bool standalone )
+{
+    char ch = tag.empty()? '\0': tag.front();
+
+    if( ch == '!' )
+    {
+        // comment
+        return;
+    }
+
+    if( ch == '>' )
+    {
+        core::string_view name = detail::trim_whitespace( tag.substr( 1 ) );
+
+        if( standalone )
+        {
+            emit( op_standalone_partial, offset( name ), static_cast<std::uint32_t>( name.size() ), offset( wsp ), static_cast<std::uint32_t>( wsp.size() ) );
+        }
+        else
+        {
+            emit( op_partial, offset( name ), static_cast<std::uint32_t>( name.size() ), 0, 0 );
+        }
+
+        return;
+    }
+
+    if( ch == '#' || ch == '^' )
+    {
+        open_section( detail::trim_whitespace( tag.substr( 1 ) ), ch == '^' );
+        return;
+    }
+
+    if( ch == '/' )
+    {
+        core::string_view name = detail::trim_whitespace( tag.substr( 1 ) );
+
+        if( open_ != 0 && section_name( open_ - 1 ) == name )
+        {
+            close_section();
+            return;
+        }
+
+        // unmatched closing tags are interpolations
+    }
+
+    if( ch == '&' )
+    {
+        emit_name( op_unescaped, tag.substr( 1 ) );
+        return;
+    }
+
+    if( ch == '=' && tag.size() >= 2 && tag.back() == '=' )
+    {
+        core::string_view d1, d2;
+
+        if( detail::parse_delimiters( tag.substr( 1, tag.size() - 2 ), d1, d2 ) )
+        {
+            start_delim_ = d1;
+            end_delim_ = d2;
+        }
+
+        return;
+    }
+
+    if( ch == '{' && tag.size() >= 2 && tag.back() == '}' )
+    {
+        emit_name( op_unescaped, tag.substr( 1, tag.size() - 2 ) );
+        return;
+    }
+
+    emit_name( op_escaped, tag );
+}
+
+void boost::mustache::compiled_template::compiler::emit_literal( std::size_t first, std::size_t size )
+{
+    if( size == 0 )
+    {
+        return;
+    }
+
+    bool line_start = pending_indent_;
+    pending_indent_ = false;
+
+    if( can_merge_ )
+    {
+        instruction& last = tmpl_.code_buffer_.back();
+
+        BOOST_ASSERT( last.op == op_literal );
+
+        if( last.first + last.size == first )
+        {
+            // contiguous text; a line start here always follows a newline
+            // at the end of the last literal, so it's indented as well
+
+            last.size += static_cast<std::uint32_t>( size );
+            return;
+        }
+    }
+
+    instruction in = { op_literal, static_cast<std::uint32_t>( first ), static_cast<std::uint32_t>( size ), line_start, 0 };
+    tmpl_.code_buffer_.push_back( in );
+
+    can_merge_ = true;
+}
+
+void boost::mustache::compiled_template::compiler::emit( opcode op, std::uint32_t first, std::uint32_t size, std::uint32_t arg, std::uint32_t arg_size )
+{
+    if( pending_indent_ && op != op_indent )
+    {
+        emit( op_indent, 0, 0, 0, 0 );
+    }
+
+    pending_indent_ = false;
+
+    instruction in = { static_cast<std::uint32_t>( op ), first, size, arg, arg_size };
+    tmpl_.code_buffer_.push_back( in );
+
+    can_merge_ = false;
+}
+
+void boost::mustache::compiled_template::compiler::emit_name( opcode op, core::string_view name )
+{
+    name = detail::trim_whitespace( name );
+
+    std::uint32_t first = static_cast<std::uint32_t>( tmpl_.segments_buffer_.size() );
+
+    if( name != "." )
+    {
+        for( ;; )
+        {
+            std::size_t i = name.find( '.' );
+
+            segment sg = { offset( name ), static_cast<std::uint32_t>( name.substr( 0, i ).size() ) };
+            tmpl_.segments_buffer_.push_back( sg );
+
+            if( i == core::string_view::npos )
+            {
+                break;
+            }
+
+            name.remove_prefix( i + 1 );
+        }
+    }
+
+    std::uint32_t size = static_cast<std::uint32_t>( tmpl_.segments_buffer_.size() - first );
+
+    emit( op, first, size, 0, 0 );
+}
+
+void boost::mustache::compiled_template::compiler::open_section( core::string_view name, bool inverted )
+{
+    emit_name( inverted? op_inverted_section: op_section, name );
+
+    tmpl_.code_buffer_.back().arg = static_cast<std::uint32_t>( open_ );
+    open_ = tmpl_.code_buffer_.size();
+}
+
+void boost::mustache::compiled_template::compiler::close_section()
+{
+    if( pending_indent_ )
+    {
+        // the line started inside the section
+        emit( op_indent, 0, 0, 0, 0 );
+    }
+
+    std::size_t i = open_ - 1;
+    open_ = tmpl_.code_buffer_[ i ].arg;
+
+    tmpl_.code_buffer_[ i ].arg = static_cast<std::uint32_t>( tmpl_.code_buffer_.size() - i - 1 );
+
+    can_merge_ = false;
+}
+
+// the name of the section at code_[ i ], as in its opening tag, recovered
+// from its segments, which are contiguous in the template text
+
+boost::core::string_view boost::mustache::compiled_template::compiler::section_name( std::size_t i ) const
+{
+    instruction const& in = tmpl_.code_buffer_[ i ];
+
+    if( in.size == 0 )
+    {
+        return ".";
+    }
+
+    segment const& s1 = tmpl_.segments_buffer_[ in.first ];
+    segment const& s2 = tmpl_.segments_buffer_[ in.first + in.size - 1 ];
+
+    return text_.substr( s1.first, s2.first + s2.size - s1.first );
+}
+
+//
+
+boost::mustache::compiled_template::compiled_template( core::string_view tmpl, core::string_view start_delim, core::string_view end_delim ):
+    compiled_template( tmpl, start_delim, end_delim, true, true )
+{
+}
+
+boost::mustache::compiled_template::compiled_template( core::string_view tmpl, core::string_view start_delim, core::string_view end_delim, bool line_start, bool eof_line_end )
+{
+    assign( tmpl, start_delim, end_delim, line_start, eof_line_end );
+}
+
+boost::mustache::compiled_template::~compiled_template()
+{
+}
+
+void boost::mustache::compiled_template::assign( core::string_view tmpl, core::string_view start_delim, core::string_view end_delim, bool line_start, bool eof_line_end )
+{
+    if( tmpl.size() > std::numeric_limits<std::uint32_t>::max() )
+    {
+        boost::throw_exception( std::length_error( "compiled_template: template too long" ), BOOST_CURRENT_LOCATION );
+    }
+
+    BOOST_ASSERT( !start_delim.empty() && !end_delim.empty() );
+
+    image_ = false;
+
+    text_buffer_.assign( tmpl.data(), tmpl.size() );
+
+    code_buffer_.clear();
+    segments_buffer_.clear();
+
+    linked_ = nullptr;
+    links_buffer_.clear();
+
+    bind();
+
+    compiler( *this, start_delim, end_delim, eof_line_end ).compile( line_start );
+
+    bind();
+}
+
+void boost::mustache::compiled_template::bind() noexcept
+{
+    if( !image_ )
+    {
+        text_ = text_buffer_;
+        code_ = code_buffer_;
+        segments_ = segments_buffer_;
+        links_ = links_buffer_;
+    }
+}
+
+// the views are copied as they are when they refer to an image, and
+// rebound to the new buffers otherwise
+
+boost::mustache::compiled_template::compiled_template( compiled_template const& r ):
+    text_( r.text_ ), code_( r.code_ ), segments_( r.segments_ ), linked_( r.linked_ ), links_( r.links_ ), image_( r.image_ ),
+    text_buffer_( r.text_buffer_ ), code_buffer_( r.code_buffer_ ), segments_buffer_( r.segments_buffer_ ), links_buffer_( r.links_buffer_ )
+{
+    bind();
+}
+
+boost::mustache::compiled_template::compiled_template( compiled_template&& r ) noexcept:
+    text_( r.text_ ), code_( r.code_ ), segments_( r.segments_ ), linked_( r.linked_ ), links_( r.links_ ), image_( r.image_ ),
+    text_buffer_( std::move( r.text_buffer_ ) ), code_buffer_( std::move( r.code_buffer_ ) ), segments_buffer_( std::move( r.segments_buffer_ ) ), links_buffer_( std::move( r.links_buffer_ ) )
+{
+    bind();
+    r.bind();
+}
+
+boost::mustache::compiled_template& boost::mustache::compiled_template::operator=( compiled_template const& r )
+{
+    if( this != &r )
+    {
+        text_buffer_ = r.text_buffer_;
+        code_buffer_ = r.code_buffer_;
+        segments_buffer_ = r.segments_buffer_;
+        links_buffer_ = r.links_buffer_;
+
+        text_ = r.text_;
+        code_ = r.code_;
+        segments_ = r.segments_;
+        linked_ = r.linked_;
+        links_ = r.links_;
+        image_ = r.image_;
+
+        bind();
+    }
+
+    return *this;
+}
+
+boost::mustache::compiled_template& boost::mustache::compiled_template::operator=( compiled_template&& r ) noexcept
+{
+    if( this != &r )
+    {
+        text_buffer_ = std::move( r.text_buffer_ );
+        code_buffer_ = std::move( r.code_buffer_ );
+        segments_buffer_ = std::move( r.segments_buffer_ );
+        links_buffer_ = std::move( r.links_buffer_ );
+
+        text_ = r.text_;
+        code_ = r.code_;
+        segments_ = r.segments_;
+        linked_ = r.linked_;
+        links_ = r.links_;
+        image_ = r.image_;
+
+        bind();
+        r.bind();
+    }
+
+    return *this;
+}
@@ -0,0 +1,315 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/data_ref.hpp>
+#include "scan.hpp"
+#include "charconv.hpp"
+#include <boost/json/serializer.hpp>
+#include <boost/assert.hpp>
+
+// output
+
+static void quoted_write( boost::core::string_view sv, boost::mustache::output_ref out )
+{
+    char const* p = sv.data();
+    char const* end = p + sv.size();
+
+    for( ;; )
+    {
+        // write the run of characters that need no escaping at once
+
+        char const* q = boost::mustache::detail::find_html_special( p, end );
+
+        if( q != p )
+        {
+            out.write( { p, static_cast<std::size_t>( q - p ) } );
+        }
+
+        if( q == end )
+        {
+            break;
+        }
+
+        switch( *q )
+        {
+        case '<': out.write( "&lt;" ); break;
+        case '>': out.write( "&gt;" ); break;
+        case '"': out.write( "&quot;" ); break;
+        default: out.write( "&amp;" ); break;
+        }
+
+        p = q + 1;
+    }
+}
+
+void boost::mustache::detail::output_string( core::string_view sv, output_ref out, bool quoted )
+{
+    if( quoted )
+    {
+        quoted_write( sv, out );
+    }
+    else
+    {
+        out.write( sv );
+    }
+}
+
+void boost::mustache::detail::output_bool( bool v, output_ref out, bool quoted )
+{
+    output_string( v? "true": "false", out, quoted );
+}
+
+// numbers never need escaping
+
+void boost::mustache::detail::output_int64( std::int64_t v, output_ref out, bool /*quoted*/ )
+{
+    char buffer[ 32 ];
+    char* p = format_int64( buffer, v );
+
+    out.write( { buffer, static_cast<std::size_t>( p - buffer ) } );
+}
+
+void boost::mustache::detail::output_uint64( std::uint64_t v, output_ref out, bool /*quoted*/ )
+{
+    char buffer[ 32 ];
+    char* p = format_uint64( buffer, v );
+
+    out.write( { buffer, static_cast<std::size_t>( p - buffer ) } );
+}
+
+void boost::mustache::detail::output_double( double v, output_ref out, bool /*quoted*/ )
+{
+    char buffer[ 32 ];
+    char* p = format_double( buffer, v );
+
+    out.write( { buffer, static_cast<std::size_t>( p - buffer ) } );
+}
+
+void boost::mustache::detail::output_json( json::value const& jv, output_ref out, bool quoted )
+{
+    switch( jv.kind() )
+    {
+    case boost::json::kind::null:
+
+        break;
+
+    case boost::json::kind::bool_:
+
+        output_bool( jv.get_bool(), out, quoted );
+        break;
+
+    case boost::json::kind::int64:
+
+        output_int64( jv.get_int64(), out, quoted );
+        break;
+
+    case boost::json::kind::uint64:
+
+        output_uint64( jv.get_uint64(), out, quoted );
+        break;
+
+    case boost::json::kind::double_:
+
+        output_double( jv.get_double(), out, quoted );
+        break;
+
+    case boost::json::kind::string:
+
+        output_string( jv.get_string(), out, quoted );
+        break;
+
+    case boost::json::kind::array:
+    case boost::json::kind::object:
+    default:
+
+        serialize_json( jv, out, quoted );
+        break;
+    }
+}
+
+void boost::mustache::detail::serialize_string( core::string_view sv, output_ref out, bool quoted )
+{
+    // escapes the same characters as json::serializer
+
+    static char const hex[] = "0123456789abcdef";
+
+    output_string( "\"", out, quoted );
+
+    char const* p = sv.data();
+    char const* end = p + sv.size();
+
+    char const* q = p;
+
+    for( ; p != end; ++p )
+    {
+        unsigned char ch = static_cast<unsigned char>( *p );
+
+        if( ch >= 0x20 && ch != '"' && ch != '\\' )
+        {
+            continue;
+        }
+
+        output_string( { q, static_cast<std::size_t>( p - q ) }, out, quoted );
+        q = p + 1;
+
+        char buffer[ 6 ] = { '\\', 'u', '0', '0', hex[ ch >> 4 ], hex[ ch & 15 ] };
+        std::size_t n = 2;
+
+        switch( ch )
+        {
+        case '"': buffer[ 1 ] = '"'; break;
+        case '\\': buffer[ 1 ] = '\\'; break;
+        case '\b': buffer[ 1 ] = 'b'; break;
+        case '\f': buffer[ 1 ] = 'f'; break;
+        case '\n': buffer[ 1 ] = 'n'; break;
+        case '\r': buffer[ 1 ] = 'r'; break;
+        case '\t': buffer[ 1 ] = 't'; break;
+        default: n = 6; break;
+        }
+
+        output_string( { buffer, n }, out, quoted );
+    }
+
+    output_string( { q, static_cast<std::size_t>( p - q ) }, out, quoted );
+    output_string( "\"", out, quoted );
+}
+
+void boost::mustache::detail::serialize_json( json::value const& jv, output_ref out, bool quoted )
+{
+    boost::json::serializer sr; // sp?
+    sr.reset( &jv );
+
+    while( !sr.done() )
+    {
+        char buffer[ 32 ];
+        output_string( sr.read( buffer ), out, quoted );
+    }
+}
+
+// JSON values
+
+static bool json_is_true( void const * p )
+{
+    boost::json::value const & jv = *static_cast<boost::json::value const*>( p );
+
+    switch( jv.kind() )
+    {
+    case boost::json::kind::null:
+
+        return false;
+
+    case boost::json::kind::bool_:
+
+        return jv.get_bool();
+
+    case boost::json::kind::int64:
+
+        return jv.get_int64() != 0;
+
+    case boost::json::kind::uint64:
+
+        return jv.get_uint64() != 0;
+
+    case boost::json::kind::double_:
+
+        return jv.get_double() != 0;
+
+    case boost::json::kind::string:
+
+        return !jv.get_string().empty();
+
+    case boost::json::kind::array:
+
+        return !jv.get_array().empty();
+
+    case boost::json::kind::object:
+
+        return true;
+
+    default:
+
+        BOOST_ASSERT( false );
+        return true;
+    }
+}
+
+static boost::mustache::data_ref json_lookup( void const * p, boost::core::string_view name )
+{
+    boost::json::value const & jv = *static_cast<boost::json::value const*>( p );
+
+    if( auto const* po = jv.if_object() )
+    {
+        if( auto const* r = po->if_contains( name ) )
+        {
+            return *r;
+        }
+    }
+
+    return {};
+}
+
+static bool json_for_each( void const * p, void * ctx, boost::mustache::data_ref::callback f )
+{
+    boost::json::value const & jv = *static_cast<boost::json::value const*>( p );
+
+    if( auto const* pa = jv.if_array() )
+    {
+        for( auto const& item: *pa )
+        {
+            f( ctx, item );
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+static boost::mustache::data_ref json_convert( void const * p )
+{
+    return *static_cast<boost::json::value const*>( p );
+}
+
+static bool json_begin( void const * p, boost::mustache::detail::data_cursor& c, boost::json::memory_resource* mr )
+{
+    boost::json::value const & jv = *static_cast<boost::json::value const*>( p );
+
+    if( auto const* pa = jv.if_array() )
+    {
+        c = boost::mustache::detail::data_cursor::make<boost::mustache::detail::json_array_cursor>( mr, *pa );
+        return true;
+    }
+
+    return false;
+}
+
+static void json_output( void const * p, boost::mustache::output_ref out, bool quoted )
+{
+    boost::mustache::detail::output_json( *static_cast<boost::json::value const*>( p ), out, quoted );
+}
+
+boost::mustache::data_ref::vtable const* boost::mustache::data_ref::json_vtable() noexcept
+{
+    static constexpr vtable vt = { &json_is_true, &json_lookup, &json_for_each, &json_convert, &json_begin, &json_output };
+    return &vt;
+}
+
+// data_store
+
+static thread_local boost::mustache::detail::data_store* current_store = nullptr;
+
+boost::mustache::detail::data_store* boost::mustache::detail::data_store::current() noexcept
+{
+    return current_store;
+}
+
+boost::mustache::detail::data_store_scope::data_store_scope( data_store& st ) noexcept: prev_( current_store )
+{
+    current_store = &st;
+}
+
+boost::mustache::detail::data_store_scope::~data_store_scope()
+{
+    current_store = prev_;
+}
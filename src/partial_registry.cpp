@@ -0,0 +1,488 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/partial_registry.hpp>
+#include <boost/throw_exception.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+
+// The image of a partial registry holds the compiled partials and their
+// links in the layout used by compiled_template, so that it can be used
+// in place. All the integers are native std::uint32_t, and all positions
+// are offsets or indices within an area, or within the text of a partial,
+// so that the image can be mapped at any address.
+//
+//   image_header
+//   image_record[ template_count ]
+//   instruction[ instruction_count ]
+//   segment[ segment_count ]
+//   std::uint32_t link[ instruction_count ]
+//   char strings[ strings_size ], padded to a multiple of 4
+//
+// A link is the index of the partial referenced by the instruction, or
+// no_link. The partials are sorted by name.
+
+namespace
+{
+
+char const image_magic[ 8 ] = { 'M', 'U', 'S', 'T', 'A', 'C', 'H', 'E' };
+
+// incremented on every change of the layout
+std::uint32_t const image_version = 1;
+
+std::uint32_t const image_byte_order = 0x01020304;
+
+std::uint32_t const no_link = 0xFFFFFFFFu;
+
+struct image_header
+{
+    char magic[ 8 ];
+
+    std::uint32_t version;
+    std::uint32_t byte_order;
+
+    // sizeof( compiled_template::instruction ), as a check of the layout
+    std::uint32_t instruction_size;
+
+    std::uint32_t template_count;
+    std::uint32_t instruction_count;
+    std::uint32_t segment_count;
+    std::uint32_t strings_size;
+
+    // of the whole image
+    std::uint32_t size;
+
+    // FNV-1a over the 32 bit words after the header
+    std::uint32_t checksum[ 2 ];
+};
+
+struct image_record
+{
+    // in the strings
+    std::uint32_t name_first;
+    std::uint32_t name_size;
+
+    std::uint32_t text_first;
+    std::uint32_t text_size;
+
+    // in the instructions and the links
+    std::uint32_t code_first;
+    std::uint32_t code_size;
+
+    // in the segments
+    std::uint32_t segments_first;
+    std::uint32_t segments_size;
+};
+
+std::uint64_t image_checksum( void const* p, std::size_t n ) noexcept
+{
+    std::uint64_t h = 0xCBF29CE484222325ull;
+
+    for( std::size_t i = 0; i < n; i += 4 )
+    {
+        std::uint32_t w;
+        std::memcpy( &w, static_cast<unsigned char const*>( p ) + i, 4 );
+
+        h ^= w;
+        h *= 0x100000001B3ull;
+    }
+
+    return h;
+}
+
+std::uint32_t to_uint32( std::size_t n )
+{
+    if( n > std::numeric_limits<std::uint32_t>::max() )
+    {
+        boost::throw_exception( std::length_error( "partial_registry: template image too large" ), BOOST_CURRENT_LOCATION );
+    }
+
+    return static_cast<std::uint32_t>( n );
+}
+
+void invalid_image( char const* what )
+{
+    boost::throw_exception( std::invalid_argument( what ), BOOST_CURRENT_LOCATION );
+}
+
+// whether [ first, first + size ) is within [ 0, n )
+bool in_range( std::uint64_t first, std::uint64_t size, std::uint64_t n ) noexcept
+{
+    return first <= n && size <= n - first;
+}
+
+} // unnamed namespace
+
+boost::mustache::partial_registry::partial_registry( json::object const& partials )
+{
+    // the names are stored in names_, which isn't reallocated afterwards
+
+    std::size_t n = 0;
+
+    for( auto const& kv: partials )
+    {
+        n += kv.key().size();
+    }
+
+    names_.reserve( n );
+    entries_.reserve( partials.size() );
+
+    for( auto const& kv: partials )
+    {
+        // partials that aren't strings are treated as missing
+
+        if( json::string const* p = kv.value().if_string() )
+        {
+            std::size_t first = names_.size();
+            names_.append( kv.key().data(), kv.key().size() );
+
+            entries_.push_back( { core::string_view( names_.data() + first, kv.key().size() ), compiled_template( *p ) } );
+        }
+    }
+
+    std::sort( entries_.begin(), entries_.end(), []( entry const& e1, entry const& e2 ){ return e1.name < e2.name; } );
+
+    // entries_ doesn't change from here on, so the links remain valid
+
+    for( auto& e: entries_ )
+    {
+        link( e.tmpl );
+    }
+}
+
+boost::mustache::partial_registry::partial_registry( borrow_t, core::string_view image )
+{
+    if( reinterpret_cast<std::uintptr_t>( image.data() ) % alignof( image_header ) != 0 )
+    {
+        invalid_image( "partial_registry: misaligned template image" );
+    }
+
+    image_header h;
+
+    if( image.size() < sizeof( h ) )
+    {
+        invalid_image( "partial_registry: truncated template image" );
+    }
+
+    std::memcpy( &h, image.data(), sizeof( h ) );
+
+    if( std::memcmp( h.magic, image_magic, sizeof( image_magic ) ) != 0 )
+    {
+        invalid_image( "partial_registry: not a template image" );
+    }
+
+    if( h.version != image_version || h.byte_order != image_byte_order || h.instruction_size != sizeof( compiled_template::instruction ) )
+    {
+        invalid_image( "partial_registry: incompatible template image version" );
+    }
+
+    // the areas; every size is a multiple of 4, so they are all aligned
+
+    std::uint64_t const records_offset = sizeof( image_header );
+    std::uint64_t const code_offset = records_offset + std::uint64_t( h.template_count ) * sizeof( image_record );
+    std::uint64_t const segments_offset = code_offset + std::uint64_t( h.instruction_count ) * sizeof( compiled_template::instruction );
+    std::uint64_t const links_offset = segments_offset + std::uint64_t( h.segment_count ) * sizeof( compiled_template::segment );
+    std::uint64_t const strings_offset = links_offset + std::uint64_t( h.instruction_count ) * sizeof( std::uint32_t );
+    std::uint64_t const size = strings_offset + ( ( std::uint64_t( h.strings_size ) + 3 ) & ~std::uint64_t( 3 ) );
+
+    if( h.size != size || image.size() < size )
+    {
+        invalid_image( "partial_registry: truncated template image" );
+    }
+
+    std::uint64_t checksum = image_checksum( image.data() + sizeof( h ), static_cast<std::size_t>( size - sizeof( h ) ) );
+
+    if( h.checksum[ 0 ] != static_cast<std::uint32_t>( checksum ) || h.checksum[ 1 ] != static_cast<std::uint32_t>( checksum >> 32 ) )
+    {
+        invalid_image( "partial_registry: template image checksum mismatch" );
+    }
+
+    image_record const* records = reinterpret_cast<image_record const*>( image.data() + records_offset );
+    compiled_template::instruction const* code = reinterpret_cast<compiled_template::instruction const*>( image.data() + code_offset );
+    compiled_template::segment const* segments = reinterpret_cast<compiled_template::segment const*>( image.data() + segments_offset );
+    std::uint32_t const* links = reinterpret_cast<std::uint32_t const*>( image.data() + links_offset );
+    char const* strings = image.data() + strings_offset;
+
+    // the checksum only guards against accidental corruption, so the
+    // structure is validated as well, to the extent the renderer relies
+    // on it: everything it indexes is in range, and sections are nested
+
+    std::vector<std::uint64_t> open;
+
+    for( std::uint32_t k = 0; k < h.template_count; ++k )
+    {
+        image_record const& r = records[ k ];
+
+        bool valid = in_range( r.name_first, r.name_size, h.strings_size ) && in_range( r.text_first, r.text_size, h.strings_size ) && in_range( r.code_first, r.code_size, h.instruction_count ) && in_range( r.segments_first, r.segments_size, h.segment_count );
+
+        for( std::uint32_t i = 0; valid && i < r.segments_size; ++i )
+        {
+            compiled_template::segment const& sg = segments[ r.segments_first + i ];
+            valid = in_range( sg.first, sg.size, r.text_size );
+        }
+
+        open.clear();
+
+        for( std::uint32_t i = 0; valid && i < r.code_size; ++i )
+        {
+            compiled_template::instruction const& in = code[ r.code_first + i ];
+            std::uint32_t link = links[ r.code_first + i ];
+
+            while( !open.empty() && open.back() == i )
+            {
+                open.pop_back();
+            }
+
+            bool partial = false;
+
+            switch( in.op )
+            {
+            case compiled_template::op_literal:
+            case compiled_template::op_indent:
+
+                valid = in_range( in.first, in.size, r.text_size );
+                break;
+
+            case compiled_template::op_escaped:
+            case compiled_template::op_unescaped:
+
+                valid = in_range( in.first, in.size, r.segments_size );
+                break;
+
+            case compiled_template::op_section:
+            case compiled_template::op_inverted_section:
+
+                {
+                    std::uint64_t end = std::uint64_t( i ) + 1 + in.arg;
+
+                    valid = in_range( in.first, in.size, r.segments_size ) && end <= ( open.empty()? r.code_size: open.back() );
+                    open.push_back( end );
+                }
+
+                break;
+
+            case compiled_template::op_partial:
+
+                valid = in_range( in.first, in.size, r.text_size );
+                partial = true;
+
+                break;
+
+            case compiled_template::op_standalone_partial:
+
+                valid = in_range( in.first, in.size, r.text_size ) && in_range( in.arg, in.arg_size, r.text_size );
+                partial = true;
+
+                break;
+
+            default:
+
+                valid = false;
+            }
+
+            valid = valid && ( partial? link == no_link || link < h.template_count: link == no_link );
+        }
+
+        // sorted by name, for find
+
+        if( valid && k > 0 )
+        {
+            image_record const& r2 = records[ k - 1 ];
+            valid = core::string_view( strings + r2.name_first, r2.name_size ) < core::string_view( strings + r.name_first, r.name_size );
+        }
+
+        if( !valid )
+        {
+            invalid_image( "partial_registry: malformed template image" );
+        }
+    }
+
+    // the partials refer to the image, and their links to links_; the
+    // entries and the links are the only allocations
+
+    entries_.reserve( h.template_count );
+    links_.resize( h.instruction_count );
+
+    for( std::uint32_t k = 0; k < h.template_count; ++k )
+    {
+        image_record const& r = records[ k ];
+
+        entries_.push_back( { core::string_view( strings + r.name_first, r.name_size ), compiled_template() } );
+
+        compiled_template& tmpl = entries_.back().tmpl;
+
+        tmpl.image_ = true;
+
+        tmpl.text_ = core::string_view( strings + r.text_first, r.text_size );
+        tmpl.code_ = { code + r.code_first, r.code_size };
+        tmpl.segments_ = { segments + r.segments_first, r.segments_size };
+
+        tmpl.linked_ = this;
+        tmpl.links_ = { links_.data() + r.code_first, r.code_size };
+    }
+
+    for( std::uint32_t i = 0; i < h.instruction_count; ++i )
+    {
+        if( links[ i ] != no_link )
+        {
+            links_[ i ] = &entries_[ links[ i ] ].tmpl;
+        }
+    }
+}
+
+boost::mustache::partial_registry::~partial_registry()
+{
+}
+
+std::size_t boost::mustache::partial_registry::find_index( core::string_view name ) const noexcept
+{
+    auto it = std::lower_bound( entries_.begin(), entries_.end(), name, []( entry const& e, core::string_view n ){ return e.name < n; } );
+
+    if( it == entries_.end() || it->name != name )
+    {
+        return entries_.size();
+    }
+
+    return it - entries_.begin();
+}
+
+boost::mustache::compiled_template const* boost::mustache::partial_registry::find( core::string_view name ) const noexcept
+{
+    std::size_t i = find_index( name );
+    return i < entries_.size()? &entries_[ i ].tmpl: nullptr;
+}
+
+void boost::mustache::partial_registry::link( compiled_template& tmpl ) const
+{
+    tmpl.links_buffer_.assign( tmpl.code_.size(), nullptr );
+
+    for( std::size_t i = 0; i < tmpl.code_.size(); ++i )
+    {
+        compiled_template::instruction const& in = tmpl.code_[ i ];
+
+        if( in.op == compiled_template::op_partial || in.op == compiled_template::op_standalone_partial )
+        {
+            tmpl.links_buffer_[ i ] = find( tmpl.text_.substr( in.first, in.size ) );
+        }
+    }
+
+    tmpl.linked_ = this;
+    tmpl.bind();
+}
+
+void boost::mustache::partial_registry::write_image( std::string& out ) const
+{
+    image_header h = {};
+
+    std::memcpy( h.magic, image_magic, sizeof( image_magic ) );
+
+    h.version = image_version;
+    h.byte_order = image_byte_order;
+    h.instruction_size = sizeof( compiled_template::instruction );
+
+    std::size_t instruction_count = 0;
+    std::size_t segment_count = 0;
+    std::size_t strings_size = 0;
+
+    for( auto const& e: entries_ )
+    {
+        instruction_count += e.tmpl.code_.size();
+        segment_count += e.tmpl.segments_.size();
+        strings_size += e.name.size() + e.tmpl.text_.size();
+    }
+
+    h.template_count = to_uint32( entries_.size() );
+    h.instruction_count = to_uint32( instruction_count );
+    h.segment_count = to_uint32( segment_count );
+    h.strings_size = to_uint32( strings_size );
+
+    std::size_t const size = sizeof( image_header ) + entries_.size() * sizeof( image_record ) + instruction_count * ( sizeof( compiled_template::instruction ) + sizeof( std::uint32_t ) ) + segment_count * sizeof( compiled_template::segment ) + ( ( strings_size + 3 ) & ~std::size_t( 3 ) );
+
+    h.size = to_uint32( size );
+
+    std::size_t const base = out.size();
+    out.resize( base + size );
+
+    char* p = &out[ base ];
+
+    char* records = p + sizeof( image_header );
+    char* code = records + entries_.size() * sizeof( image_record );
+    char* segments = code + instruction_count * sizeof( compiled_template::instruction );
+    char* links = segments + segment_count * sizeof( compiled_template::segment );
+    char* strings = links + instruction_count * sizeof( std::uint32_t );
+
+    std::uint32_t code_first = 0;
+    std::uint32_t segments_first = 0;
+    std::uint32_t strings_first = 0;
+
+    for( auto const& e: entries_ )
+    {
+        compiled_template const& tmpl = e.tmpl;
+
+        image_record r;
+
+        r.name_first = strings_first;
+        r.name_size = static_cast<std::uint32_t>( e.name.size() );
+
+        r.text_first = r.name_first + r.name_size;
+        r.text_size = static_cast<std::uint32_t>( tmpl.text_.size() );
+
+        r.code_first = code_first;
+        r.code_size = static_cast<std::uint32_t>( tmpl.code_.size() );
+
+        r.segments_first = segments_first;
+        r.segments_size = static_cast<std::uint32_t>( tmpl.segments_.size() );
+
+        std::memcpy( records, &r, sizeof( r ) );
+        records += sizeof( r );
+
+        std::memcpy( strings + r.name_first, e.name.data(), r.name_size );
+        std::memcpy( strings + r.text_first, tmpl.text_.data(), r.text_size );
+
+        if( r.code_size != 0 )
+        {
+            std::memcpy( code + std::size_t( r.code_first ) * sizeof( compiled_template::instruction ), tmpl.code_.data(), r.code_size * sizeof( compiled_template::instruction ) );
+        }
+
+        if( r.segments_size != 0 )
+        {
+            std::memcpy( segments + std::size_t( r.segments_first ) * sizeof( compiled_template::segment ), tmpl.segments_.data(), r.segments_size * sizeof( compiled_template::segment ) );
+        }
+
+        for( std::size_t i = 0; i < tmpl.code_.size(); ++i )
+        {
+            compiled_template::instruction const& in = tmpl.code_[ i ];
+
+            std::uint32_t link = no_link;
+
+            if( in.op == compiled_template::op_partial || in.op == compiled_template::op_standalone_partial )
+            {
+                std::size_t j = find_index( tmpl.text_.substr( in.first, in.size ) );
+
+                if( j < entries_.size() )
+                {
+                    link = static_cast<std::uint32_t>( j );
+                }
+            }
+
+            std::memcpy( links + ( r.code_first + i ) * sizeof( std::uint32_t ), &link, sizeof( link ) );
+        }
+
+        code_first += r.code_size;
+        segments_first += r.segments_size;
+        strings_first += r.name_size + r.text_size;
+    }
+
+    // the padding is zero, from resize
+
+    std::uint64_t checksum = image_checksum( p + sizeof( image_header ), size - sizeof( image_header ) );
+
+    h.checksum[ 0 ] = static_cast<std::uint32_t>( checksum );
+    h.checksum[ 1 ] = static_cast<std::uint32_t>( checksum >> 32 );
+
+    std::memcpy( p, &h, sizeof( h ) );
+}
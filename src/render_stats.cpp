@@ -0,0 +1,55 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/render_stats.hpp>
+
+boost::mustache::render_stats::render_stats( json::storage_ptr upstream ) noexcept: upstream_( upstream )
+{
+}
+
+void boost::mustache::render_stats::clear() noexcept
+{
+    allocations = 0;
+    bytes_allocated = 0;
+    peak_bytes = bytes_in_use_;
+
+    bytes_emitted = 0;
+    escaped_bytes = 0;
+
+    interpolation_tags = 0;
+    section_tags = 0;
+    partial_tags = 0;
+    comment_tags = 0;
+    delimiter_tags = 0;
+
+    lookup_misses = 0;
+}
+
+void* boost::mustache::render_stats::do_allocate( std::size_t n, std::size_t align )
+{
+    void* p = upstream_->allocate( n, align );
+
+    ++allocations;
+    bytes_allocated += n;
+
+    bytes_in_use_ += n;
+
+    if( peak_bytes < bytes_in_use_ )
+    {
+        peak_bytes = bytes_in_use_;
+    }
+
+    return p;
+}
+
+void boost::mustache::render_stats::do_deallocate( void* p, std::size_t n, std::size_t align )
+{
+    upstream_->deallocate( p, n, align );
+    bytes_in_use_ -= n;
+}
+
+bool boost::mustache::render_stats::do_is_equal( json::memory_resource const& r ) const noexcept
+{
+    return this == &r;
+}
@@ -3,63 +3,278 @@
 // https://www.boost.org/LICENSE_1_0.txt
 
 #include <boost/mustache/renderer.hpp>
-#include <boost/json/serializer.hpp>
+#include <boost/mustache/buffered_output.hpp>
+#include <boost/mustache/render_stats.hpp>
+#include <boost/mustache/thread_pool.hpp>
+#include <boost/mustache/partial_registry.hpp>
+#include "utility.hpp"
+#include "scan.hpp"
 #include <boost/assert.hpp>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
 #include <utility>
 #include <algorithm>
-#include <clocale>
+#include <cstring>
 
 boost::mustache::renderer::renderer( json::value&& data, json::object&& partials, json::storage_ptr sp ):
-    context_stack_( sp ), partials_( std::move( partials ), sp ),
-    whitespace_( sp ), start_delim_( "{{", sp ), end_delim_( "}}", sp ),
-    tag_( sp ), section_stack_( sp ), section_text_( sp ), partial_lwsp_( sp )
+    data_( std::move( data ), sp ), partials_copy_( std::move( partials ), sp ), context_stack_( detail::storage_allocator<data_ref>( sp ) ), partials_( &partials_copy_ ),
+    whitespace_( sp ), standalone_wsp_( sp ), start_delim_( "{{", sp ), end_delim_( "}}", sp ),
+    tag_( sp ), section_stack_( sp ), section_text_( sp ), section_start_delim_( sp ),
+    section_end_delim_( sp ), partial_saved_( sp ), indent_( sp ), compiled_partials_( compiled_partial_map::allocator_type( sp ) ),
+    links_( detail::storage_allocator<cached_partial>( sp ) ), lookup_cache_( detail::storage_allocator<cached_lookup>( sp ) ), converted_( sp ),
+    pull_stack_( detail::storage_allocator<pull_frame>( sp ) ), pending_( sp )
 {
-    context_stack_.push_back( std::move( data ) );
+    context_stack_.push_back( data_ );
 }
 
-boost::mustache::renderer::~renderer()
+boost::mustache::renderer::renderer( borrow_t, data_ref data, json::object const& partials, json::storage_ptr sp ):
+    data_( sp ), partials_copy_( sp ), context_stack_( detail::storage_allocator<data_ref>( sp ) ), partials_( &partials ),
+    whitespace_( sp ), standalone_wsp_( sp ), start_delim_( "{{", sp ), end_delim_( "}}", sp ),
+    tag_( sp ), section_stack_( sp ), section_text_( sp ), section_start_delim_( sp ),
+    section_end_delim_( sp ), partial_saved_( sp ), indent_( sp ), compiled_partials_( compiled_partial_map::allocator_type( sp ) ),
+    links_( detail::storage_allocator<cached_partial>( sp ) ), lookup_cache_( detail::storage_allocator<cached_lookup>( sp ) ), converted_( sp ),
+    pull_stack_( detail::storage_allocator<pull_frame>( sp ) ), pending_( sp )
+{
+    context_stack_.push_back( data_ref() );
+    set_root( data );
+}
+
+boost::mustache::renderer::renderer( json::value&& data, partial_registry const& partials, json::storage_ptr sp ):
+    renderer( std::move( data ), json::object( sp ), sp )
+{
+    registry_ = &partials;
+}
+
+// partials_ refers to the empty partials_copy_
+
+boost::mustache::renderer::renderer( borrow_t, data_ref data, partial_registry const& partials, json::storage_ptr sp ):
+    renderer( borrow, data, partials_copy_, sp )
 {
+    registry_ = &partials;
 }
 
-// utility functions
+boost::mustache::renderer::~renderer()
+{
+    pull_clear();
+}
 
-static boost::core::string_view trim_leading_whitespace( boost::core::string_view sv )
+void boost::mustache::renderer::reset()
 {
-    char const* p = sv.data();
-    char const* end = p + sv.size();
+    context_stack_.resize( 1 );
+
+    state_ = state_leading_wsp;
+    in_section_ = false;
+
+    whitespace_.clear();
+    standalone_wsp_.clear();
+
+    standalone_ = false;
+    had_cr_ = false;
+
+    start_delim_ = "{{";
+    end_delim_ = "}}";
+
+    delim_index_ = 0;
+
+    tag_.clear();
+
+    section_depth_ = 0;
+    inverted_ = false;
+    section_context_ = data_ref();
+    section_text_.clear();
+    section_line_start_ = false;
+
+    section_start_delim_.clear();
+    section_end_delim_.clear();
+
+    partial_saved_.clear();
+
+    indent_.clear();
+
+    links_tmpl_ = nullptr;
+    links_.clear();
+
+    lookup_cache_.clear();
+
+    converted_.unpin( converted_root_ );
+    converted_.release( 0 );
+
+    pull_clear();
+    pending_.clear();
+    pending_pos_ = 0;
+}
 
-    while( p != end && ( *p == ' ' || *p == '\t' ) )
+void boost::mustache::renderer::reset( borrow_t, data_ref data, json::object const& partials )
+{
+    if( partials_ != &partials )
     {
-        ++p;
+        compiled_partials_.clear();
     }
+    else
+    {
+        // the partials may have been modified since they were passed,
+        // so the compiled ones are kept, but checked on first use
 
-    return { p, static_cast<std::size_t>( end - p ) };
+        for( auto& kv: compiled_partials_ )
+        {
+            kv.second.checked = false;
+        }
+    }
+
+    data_ = nullptr;
+    partials_copy_.clear();
+
+    partials_ = &partials;
+    registry_ = nullptr;
+
+    reset();
+    set_root( data );
+}
+
+void boost::mustache::renderer::reset_copy( json::value&& data, json::object&& partials )
+{
+    compiled_partials_.clear();
+
+    data_ = std::move( data );
+    partials_copy_ = std::move( partials );
+
+    partials_ = &partials_copy_;
+    registry_ = nullptr;
+
+    reset();
+    set_root( data_ );
+}
+
+void boost::mustache::renderer::reset( borrow_t, data_ref data, partial_registry const& partials )
+{
+    compiled_partials_.clear();
+
+    data_ = nullptr;
+    partials_copy_.clear();
+
+    partials_ = &partials_copy_;
+    registry_ = &partials;
+
+    reset();
+    set_root( data );
+}
+
+void boost::mustache::renderer::reset_copy( json::value&& data, partial_registry const& partials )
+{
+    compiled_partials_.clear();
+
+    data_ = std::move( data );
+    partials_copy_.clear();
+
+    partials_ = &partials_copy_;
+    registry_ = &partials;
+
+    reset();
+    set_root( data_ );
+}
+
+// a root converted to JSON is converted once, rather than for each lookup
+
+void boost::mustache::renderer::set_root( data_ref data )
+{
+    converted_.clear();
+
+    detail::data_store_scope scope( converted_ );
+
+    context_stack_.front() = data.convert();
+
+    converted_.pin();
+    converted_root_ = converted_.size();
+}
+
+void boost::mustache::renderer::set_stats( render_stats* st ) noexcept
+{
+    stats_ = st;
+}
+
+void boost::mustache::renderer::set_thread_pool( thread_pool* tp, std::size_t chunk ) noexcept
+{
+    pool_ = tp;
+    chunk_size_ = chunk != 0? chunk: 1;
 }
 
-static boost::core::string_view trim_trailing_whitespace( boost::core::string_view sv )
+// counts the bytes written through it
+
+namespace
+{
+
+struct counting_output
 {
-    char const* p = sv.data();
-    char const* end = p + sv.size();
+    using value_type = char;
+
+    boost::mustache::output_ref out;
+    std::size_t* n;
 
-    while( p != end && ( end[ -1 ] == ' ' || end[ -1 ] == '\t' ) )
+    void append( char const* first, char const* last )
     {
-        --end;
+        *n += static_cast<std::size_t>( last - first );
+        out.write( { first, static_cast<std::size_t>( last - first ) } );
     }
+};
 
-    return { p, static_cast<std::size_t>( end - p ) };
+} // unnamed namespace
+
+// the public functions collect the output into a buffer, so that the
+// number of writes to the output depends on its size rather than on
+// the number of fragments it's made of
+
+void boost::mustache::renderer::render_some( core::string_view in, output_ref out )
+{
+    detail::data_store_scope scope( converted_ );
+
+    counting_output co = { out, stats_? &stats_->bytes_emitted: nullptr };
+
+    char buffer[ 1024 ];
+    buffered_output bo( stats_? output_ref( co ): out, buffer, sizeof( buffer ) );
+
+    render_some_impl( in, bo );
+
+    bo.flush();
 }
 
-static boost::core::string_view trim_whitespace( boost::core::string_view sv )
+void boost::mustache::renderer::finish( output_ref out )
 {
-    sv = trim_leading_whitespace( sv );
-    sv = trim_trailing_whitespace( sv );
+    detail::data_store_scope scope( converted_ );
 
-    return sv;
+    counting_output co = { out, stats_? &stats_->bytes_emitted: nullptr };
+
+    char buffer[ 1024 ];
+    buffered_output bo( stats_? output_ref( co ): out, buffer, sizeof( buffer ) );
+
+    finish_impl( bo );
+
+    bo.flush();
 }
 
-//
+void boost::mustache::renderer::render( compiled_template const& tmpl, output_ref out )
+{
+    detail::data_store_scope scope( converted_ );
 
-void boost::mustache::renderer::render_some( core::string_view in, output_ref out )
+    counting_output co = { out, stats_? &stats_->bytes_emitted: nullptr };
+
+    char buffer[ 1024 ];
+    buffered_output bo( stats_? output_ref( co ): out, buffer, sizeof( buffer ) );
+
+    // tmpl may be another template at the address of the last one
+    links_tmpl_ = nullptr;
+
+    std::size_t m = converted_.size();
+
+    render_compiled( tmpl, 0, tmpl.code_.size(), no_cache, bo );
+
+    converted_.release( m );
+
+    bo.flush();
+}
+
+void boost::mustache::renderer::render_some_impl( core::string_view in, output_ref out )
 {
     while( !in.empty() )
     {
@@ -126,10 +341,7 @@ boost::core::string_view boost::mustache::renderer::handle_state_leading_wsp( co
     char const* p = in.data();
     char const* end = p + in.size();
 
-    while( p != end && ( *p == ' ' || *p == '\t' ) )
-    {
-        ++p;
-    }
+    p = detail::skip_spaces( p, end );
 
     whitespace_.append( in.data(), p );
 
@@ -162,11 +374,8 @@ void boost::mustache::renderer::finish_state_leading_wsp( output_ref out )
     {
         in_section_ = false;
     }
-    else if( whitespace_ != partial_lwsp_ )
+    else
     {
-        // if all whitespace comes from the partial indentation,
-        // we shouldn't be outputting it at partial end
-
         out.write( whitespace_ );
 
         whitespace_.clear();
@@ -240,9 +449,13 @@ boost::core::string_view boost::mustache::renderer::handle_state_tag( core::stri
     char const* p = in.data();
     char const* end = p + in.size();
 
-    while( p != end && *p != end_delim_[0] )
+    if( void const* q = std::memchr( p, end_delim_[0], static_cast<std::size_t>( end - p ) ) )
     {
-        ++p;
+        p = static_cast<char const*>( q );
+    }
+    else
+    {
+        p = end;
     }
 
     tag_.append( in.data(), p );
@@ -274,20 +487,6 @@ void boost::mustache::renderer::finish_state_tag( output_ref out )
     state_ = state_passthrough;
 }
 
-static bool is_tag_standalone( boost::core::string_view tag )
-{
-    tag = trim_leading_whitespace( tag );
-
-    if( tag.empty() )
-    {
-        return false;
-    }
-
-    char ch = tag.front();
-
-    return ch == '!' || ch == '=' || ch == '>' || ch == '#' || ch == '^' || ch == '/';
-}
-
 // state_end_delim consumes the end delimiter ('}}' by default)
 
 boost::core::string_view boost::mustache::renderer::handle_state_end_delim( core::string_view in, output_ref out )
@@ -312,7 +511,7 @@ boost::core::string_view boost::mustache::renderer::handle_state_end_delim( core
     {
         // end delimiter
 
-        if( standalone_ && !is_tag_standalone( tag_ ) )
+        if( standalone_ && !detail::is_tag_standalone( tag_ ) )
         {
             standalone_ = false;
         }
@@ -440,10 +639,7 @@ boost::core::string_view boost::mustache::renderer::handle_state_passthrough( co
     char const* p = in.data();
     char const* end = p + in.size();
 
-    while( p != end && *p != '\n' && *p != start_delim_[0] )
-    {
-        ++p;
-    }
+    p = detail::find_either( p, end, '\n', start_delim_[0] );
 
     out.write( { in.data(), static_cast<std::size_t>( p - in.data() ) } );
 
@@ -455,7 +651,7 @@ boost::core::string_view boost::mustache::renderer::handle_state_passthrough( co
             ++p;
 
             state_ = state_leading_wsp;
-            whitespace_ = partial_lwsp_;
+            whitespace_.clear();
         }
         else
         {
@@ -508,12 +704,12 @@ boost::core::string_view boost::mustache::renderer::handle_state_standalone( cor
     {
         ++p;
 
-        json::string old_wsp( whitespace_, whitespace_.storage() );
+        standalone_wsp_ = whitespace_;
 
         state_ = state_leading_wsp;
-        whitespace_ = partial_lwsp_;
+        whitespace_.clear();
 
-        handle_tag( tag_, out2, old_wsp );
+        handle_tag( tag_, out2, standalone_wsp_ );
         tag_.clear();
     }
     else
@@ -523,6 +719,8 @@ boost::core::string_view boost::mustache::renderer::handle_state_standalone( cor
         whitespace_.clear();
         state_ = state_passthrough;
 
+        standalone_ = false;
+
         handle_tag( tag_, out2, "" );
         tag_.clear();
     }
@@ -534,12 +732,12 @@ boost::core::string_view boost::mustache::renderer::handle_state_standalone( cor
 
 void boost::mustache::renderer::finish_state_standalone( output_ref out )
 {
-    json::string old_wsp( whitespace_, whitespace_.storage() );
+    standalone_wsp_ = whitespace_;
 
     state_ = state_leading_wsp;
-    whitespace_ = partial_lwsp_;
+    whitespace_.clear();
 
-    handle_tag( tag_, out, old_wsp );
+    handle_tag( tag_, out, standalone_wsp_ );
     tag_.clear();
 
     in_section_ = false;
@@ -566,12 +764,12 @@ boost::core::string_view boost::mustache::renderer::handle_state_standalone_2( c
     {
         ++p;
 
-        json::string old_wsp( whitespace_, whitespace_.storage() );
+        standalone_wsp_ = whitespace_;
 
         state_ = state_leading_wsp;
-        whitespace_ = partial_lwsp_;
+        whitespace_.clear();
 
-        handle_tag( tag_, out2, old_wsp );
+        handle_tag( tag_, out2, standalone_wsp_ );
         tag_.clear();
     }
     else
@@ -581,6 +779,8 @@ boost::core::string_view boost::mustache::renderer::handle_state_standalone_2( c
         whitespace_.clear();
         state_ = state_passthrough;
 
+        standalone_ = false;
+
         handle_tag( tag_, out2, "" );
         tag_.clear();
 
@@ -630,21 +830,21 @@ void boost::mustache::renderer::handle_tag( core::string_view tag, output_ref ou
 
         if( ch == '#' || ch == '^' )
         {
-            auto sn = trim_whitespace( tag.substr( 1 ) );
-            section_stack_.push_back( sn );
+            auto sn = detail::trim_whitespace( tag.substr( 1 ) );
+            push_section( sn );
         }
         else if( ch == '/' )
         {
-            auto sn = trim_whitespace( tag.substr( 1 ) );
+            auto sn = detail::trim_whitespace( tag.substr( 1 ) );
 
-            BOOST_ASSERT( !section_stack_.empty() );
+            BOOST_ASSERT( section_depth_ != 0 );
 
-            if( section_stack_.back() == sn )
+            if( section_stack_[ section_depth_ - 1 ].get_string() == sn )
             {
-                section_stack_.pop_back();
+                --section_depth_;
             }
 
-            if( section_stack_.empty() )
+            if( section_depth_ == 0 )
             {
                 ends = true;
             }
@@ -654,7 +854,8 @@ void boost::mustache::renderer::handle_tag( core::string_view tag, output_ref ou
         {
             if( standalone_ )
             {
-                section_text_ += whitespace_;
+                // whitespace_ has already been reset for the next line
+                section_text_ += old_wsp;
             }
 
             section_text_ += start_delim_;
@@ -670,6 +871,16 @@ void boost::mustache::renderer::handle_tag( core::string_view tag, output_ref ou
 
                 section_text_ += "\n";
             }
+
+            core::string_view d1, d2;
+
+            if( ch == '=' && tag.size() >= 2 && tag.back() == '=' && detail::parse_delimiters( tag.substr( 1, tag.size() - 2 ), d1, d2 ) )
+            {
+                // the tags that follow, up to the closing one, use
+                // the new delimiters, and so does the compiler
+                start_delim_ = d1;
+                end_delim_ = d2;
+            }
         }
         else
         {
@@ -731,194 +942,53 @@ void boost::mustache::renderer::handle_tag( core::string_view tag, output_ref ou
 
 void boost::mustache::renderer::handle_comment_tag( core::string_view /*tag*/, output_ref /*out*/ )
 {
-    // do nothing
-}
-
-static void quoted_write( boost::core::string_view sv, boost::mustache::output_ref out )
-{
-    char const* p = sv.data();
-    char const* end = p + sv.size();
-
-    while( p != end )
-    {
-        if( *p == '<' )
-        {
-            out.write( "&lt;" );
-        }
-        else if( *p == '>' )
-        {
-            out.write( "&gt;" );
-        }
-        else if( *p == '"' )
-        {
-            out.write( "&quot;" );
-        }
-        else if( *p == '&' )
-        {
-            out.write( "&amp;" );
-        }
-        else
-        {
-            out.write( { p, 1 } );
-        }
-
-        ++p;
-    }
-}
-
-static void maybe_quoted_write( boost::core::string_view sv, boost::mustache::output_ref out, bool quoted )
-{
-    if( quoted )
-    {
-        quoted_write( sv, out );
-    }
-    else
-    {
-        out.write( sv );
-    }
-}
-
-static void gcvt( char* buffer, std::size_t size, double v )
-{
-    std::size_t n = std::snprintf( buffer, size, "%.16g", v );
-
-    char dp = std::localeconv()->decimal_point[0];
-
-    if( dp != '.' )
-    {
-        std::replace( buffer, buffer + std::min( n, size ), dp, '.' );
-    }
-}
-
-static void output_value( boost::json::value const& jv, boost::mustache::output_ref out, bool quoted )
-{
-    switch( jv.kind() )
+    if( stats_ )
     {
-    case boost::json::kind::null:
-
-        break;
-
-    case boost::json::kind::bool_:
-
-        maybe_quoted_write( jv.get_bool()? "true": "false", out, quoted );
-        break;
-
-    case boost::json::kind::int64:
-
-        {
-            char buffer[ 32 ];
-            std::snprintf( buffer, sizeof( buffer ), "%lld", static_cast<long long>( jv.get_int64() ) );
-
-            maybe_quoted_write( buffer, out, quoted );
-        }
-
-        break;
-
-    case boost::json::kind::uint64:
-
-        {
-            char buffer[ 32 ];
-            std::snprintf( buffer, sizeof( buffer ), "%llu", static_cast<unsigned long long>( jv.get_uint64() ) );
-
-            maybe_quoted_write( buffer, out, quoted );
-        }
-
-        break;
-
-    case boost::json::kind::double_:
-
-        {
-            char buffer[ 32 ] = {};
-            gcvt( buffer, sizeof( buffer ), jv.get_double() );
-
-            maybe_quoted_write( buffer, out, quoted );
-        }
-
-        break;
-
-    case boost::json::kind::string:
-
-        maybe_quoted_write( jv.get_string(), out, quoted );
-        break;
-
-    case boost::json::kind::array:
-    case boost::json::kind::object:
-    default:
-
-        {
-            boost::json::serializer sr; // sp?
-            sr.reset( &jv );
-
-            while( !sr.done() )
-            {
-                char buffer[ 32 ];
-                maybe_quoted_write( sr.read( buffer ), out, quoted );
-            }
-        }
-
-        break;
+        ++stats_->comment_tags;
     }
 }
 
 void boost::mustache::renderer::handle_interpolation_tag( core::string_view tag, output_ref out, bool quoted )
 {
-    tag = trim_whitespace( tag );
-
-    json::value const* p = lookup_value( tag );
-
-    if( p == 0 )
-    {
-        return;
-    }
+    tag = detail::trim_whitespace( tag );
 
-    output_value( *p, out, quoted );
+    output_value( lookup_value( tag ), out, quoted );
 }
 
 void boost::mustache::renderer::handle_section_tag( core::string_view tag, output_ref /*out*/, bool inverted )
 {
-    tag = trim_whitespace( tag );
+    tag = detail::trim_whitespace( tag );
 
-    section_stack_.clear();
-    section_stack_.push_back( tag );
+    section_depth_ = 0;
+    push_section( tag );
 
     inverted_ = inverted;
     section_context_ = lookup_value( tag );
 
-    section_text_.clear();
+    count_section( section_context_ );
 
-    in_section_ = true;
-}
+    section_text_.clear();
 
-static boost::core::string_view get_leading_token( boost::core::string_view sv )
-{
-    char const* p = sv.data();
-    char const* end = p + sv.size();
+    section_start_delim_ = start_delim_;
+    section_end_delim_ = end_delim_;
 
-    while( p != end && ( *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' ) )
-    {
-        ++p;
-    }
+    // a standalone section tag has already consumed its line ending
+    section_line_start_ = state_ == state_leading_wsp;
 
-    return { sv.data(), static_cast<std::size_t>( p - sv.data() ) };
+    in_section_ = true;
 }
 
 void boost::mustache::renderer::handle_delimiter_tag( core::string_view tag, output_ref /*out*/ )
 {
-    tag = trim_leading_whitespace( tag );
-
-    auto d1 = get_leading_token( tag );
-    tag.remove_prefix( d1.size() );
-
-    tag = trim_leading_whitespace( tag );
-
-    auto d2 = get_leading_token( tag );
-    tag.remove_prefix( d2.size() );
+    if( stats_ )
+    {
+        ++stats_->delimiter_tags;
+    }
 
-    tag = trim_leading_whitespace( tag );
+    core::string_view d1, d2;
 
-    if( d1.empty() || d2.empty() || !tag.empty() )
+    if( !detail::parse_delimiters( tag, d1, d2 ) )
     {
-        // the tag contents must be exactly two non-whitespace sequences
         return;
     }
 
@@ -928,204 +998,1154 @@ void boost::mustache::renderer::handle_delimiter_tag( core::string_view tag, out
 
 void boost::mustache::renderer::handle_partial_tag( core::string_view tag, output_ref out, core::string_view old_wsp )
 {
-    tag = trim_whitespace( tag );
-
-    if( json::value const* p1 = partials_.if_contains( tag ) )
+    if( stats_ )
     {
-        if( json::string const* p2 = p1->if_string() )
-        {
-            json::string old_start_delim( start_delim_, start_delim_.storage() );
-            json::string old_end_delim( end_delim_, end_delim_.storage() );
+        ++stats_->partial_tags;
+    }
 
-            start_delim_ = "{{";
-            end_delim_ = "}}";
+    tag = detail::trim_whitespace( tag );
 
-            json::string old_partial_lwsp( partial_lwsp_, partial_lwsp_.storage() );
-            partial_lwsp_ = old_wsp;
+    // the partial is rendered compiled, indented by old_wsp, which
+    // is empty when the tag isn't standalone; the state after the
+    // tag is that of the enclosing template, as when rendering it
+    // compiled, so a line ending at the end of the partial doesn't
+    // start a line in the enclosing template
 
-            if( state_ == state_leading_wsp )
-            {
-                whitespace_ = partial_lwsp_;
-            }
+    if( compiled_template const* p = find_compiled_partial( tag ) )
+    {
+        indent_ = old_wsp;
 
-            render_some( *p2, out );
-            finish( out );
+        render_compiled( *p, 0, p->code_.size(), no_cache, out );
 
-            if( state_ == state_leading_wsp && whitespace_ == partial_lwsp_ )
-            {
-                whitespace_ = old_partial_lwsp;
-            }
+        indent_.clear();
+    }
+}
 
-            start_delim_ = old_start_delim;
-            end_delim_ = old_end_delim;
-            partial_lwsp_ = old_partial_lwsp;
-        }
+void boost::mustache::renderer::push_section( core::string_view name )
+{
+    if( section_depth_ < section_stack_.size() )
+    {
+        section_stack_[ section_depth_ ].get_string() = name;
+    }
+    else
+    {
+        section_stack_.push_back( name );
     }
+
+    ++section_depth_;
 }
 
-boost::json::value const* boost::mustache::renderer::lookup_value( core::string_view name ) const
+// the names of the tags outside of sections, rendered once as they're
+// parsed; splitting them here costs the same as compiling them would
+
+boost::mustache::data_ref boost::mustache::renderer::lookup_value( core::string_view name ) const
 {
     if( name == "." )
     {
-        return &context_stack_.back();
+        return context_stack_.back();
     }
 
     std::size_t i = name.find( '.' );
 
     core::string_view n = name.substr( 0, i );
 
-    boost::json::value const* r = 0;
+    data_ref r;
     std::size_t j = context_stack_.size();
 
     while( j > 0 )
     {
         --j;
 
-        if( auto const* p = context_stack_[ j ].if_object() )
+        r = context_stack_[ j ].lookup( n );
+
+        if( !r.empty() )
         {
-            if( p->contains( n ) )
-            {
-                r = &p->at( n );
-                break;
-            }
+            break;
         }
     }
 
-    if( r == 0 )
+    while( !r.empty() && i != core::string_view::npos )
     {
-        return r;
-    }
+        name.remove_prefix( i + 1 );
 
-    if( i == core::string_view::npos )
-    {
-        return r;
+        i = name.find( '.' );
+        n = name.substr( 0, i );
+
+        r = r.lookup( n );
+    }
+
+    return r;
+}
+
+void boost::mustache::renderer::output_value( data_ref r, output_ref out, bool quoted )
+{
+    if( stats_ == 0 )
+    {
+        r.output( out, quoted );
+        return;
+    }
+
+    ++stats_->interpolation_tags;
+
+    if( r.empty() )
+    {
+        ++stats_->lookup_misses;
+    }
+
+    if( quoted )
+    {
+        counting_output co = { out, &stats_->escaped_bytes };
+        r.output( co, quoted );
+    }
+    else
+    {
+        r.output( out, quoted );
+    }
+}
+
+void boost::mustache::renderer::count_section( data_ref r )
+{
+    if( stats_ )
+    {
+        ++stats_->section_tags;
+
+        if( r.empty() )
+        {
+            ++stats_->lookup_misses;
+        }
     }
+}
+
+//
+
+void boost::mustache::renderer::render_section( output_ref out )
+{
+    std::size_t m = converted_.size();
+
+    data_ref p = section_context_.convert();
+
+    if( p.is_true() == inverted_ )
+    {
+        converted_.release( m );
+        return;
+    }
+
+    // the section contents are compiled once, then replayed for each
+    // element; nested sections are compiled along with them
+
+    compiled_template& tmpl = section_template_;
+    tmpl.assign( section_text_, section_start_delim_, section_end_delim_, section_line_start_, false );
+
+    if( registry_ )
+    {
+        // the partials are looked up once, rather than per element
+        registry_->link( tmpl );
+    }
+
+    render_compiled_section( p, inverted_, tmpl, 0, tmpl.code_.size(), no_cache, out );
+
+    converted_.release( m );
+}
+
+// compiled templates
+
+// cache is the lookup_cache_ slot of the instruction at first, or no_cache
+
+void boost::mustache::renderer::render_compiled( compiled_template const& tmpl, std::size_t first, std::size_t last, std::size_t cache, output_ref out )
+{
+    for( std::size_t i = first; i < last; ++i )
+    {
+        compiled_template::instruction const& in = tmpl.code_[ i ];
+
+        std::size_t slot = cache == no_cache? cache: cache + ( i - first );
+
+        switch( in.op )
+        {
+        case compiled_template::op_literal:
+
+            render_compiled_literal( { tmpl.text_.data() + in.first, in.size }, in.arg != 0, out );
+            break;
+
+        case compiled_template::op_indent:
+
+            out.write( indent_ );
+            break;
+
+        case compiled_template::op_escaped:
+        case compiled_template::op_unescaped:
+
+            output_value( lookup_value( tmpl, in.first, in.size, slot ), out, in.op == compiled_template::op_escaped );
+            break;
+
+        case compiled_template::op_section:
+        case compiled_template::op_inverted_section:
+        {
+            data_ref r = lookup_value( tmpl, in.first, in.size, slot );
+
+            count_section( r );
+
+            render_compiled_section( r, in.op == compiled_template::op_inverted_section, tmpl, i + 1, i + 1 + in.arg, slot == no_cache? slot: slot + 1, out );
+            i += in.arg;
+
+            break;
+        }
+
+        case compiled_template::op_partial:
+        case compiled_template::op_standalone_partial:
+
+            if( stats_ )
+            {
+                ++stats_->partial_tags;
+            }
+
+            render_compiled_partial( tmpl, i, out );
+            break;
+
+        default:
+
+            BOOST_ASSERT( false );
+            return;
+        }
+    }
+}
+
+// indents every line in text when rendering a standalone partial
+
+void boost::mustache::renderer::render_compiled_literal( core::string_view text, bool line_start, output_ref out )
+{
+    if( indent_.empty() )
+    {
+        out.write( text );
+        return;
+    }
+
+    if( line_start )
+    {
+        out.write( indent_ );
+    }
+
+    char const* p = text.data();
+    char const* end = p + text.size();
 
     for( ;; )
     {
-        name.remove_prefix( i + 1 );
+        char const* q = static_cast<char const*>( std::memchr( p, '\n', end - p ) );
 
-        i = name.find( '.' );
-        n = name.substr( 0, i );
+        if( q == 0 || q + 1 == end )
+        {
+            out.write( { p, static_cast<std::size_t>( end - p ) } );
+            break;
+        }
+
+        ++q;
+
+        out.write( { p, static_cast<std::size_t>( q - p ) } );
+        out.write( indent_ );
+
+        p = q;
+    }
+}
+
+struct boost::mustache::renderer::section_frame
+{
+    renderer* self;
+
+    compiled_template const* tmpl;
+    std::size_t first;
+    std::size_t last;
+
+    std::size_t cache;
+
+    output_ref out;
+};
+
+void boost::mustache::renderer::render_section_element( void * frame, data_ref item )
+{
+    section_frame& f = *static_cast<section_frame*>( frame );
+
+    // the values converted for the element are released with it
+
+    std::size_t m = f.self->converted_.size();
+
+    f.self->context_stack_.back() = item.convert();
+    f.self->render_compiled( *f.tmpl, f.first, f.last, f.cache, f.out );
+
+    f.self->converted_.release( m );
+}
+
+void boost::mustache::renderer::render_compiled_section( data_ref p, bool inverted, compiled_template const& tmpl, std::size_t first, std::size_t last, std::size_t cache, output_ref out )
+{
+    // the data doesn't change during rendering, so the context
+    // stack refers to it directly instead of holding copies; a
+    // value converted to JSON is converted once, for the section
+
+    std::size_t m = converted_.size();
+
+    p = p.convert();
+
+    if( p.is_true() == inverted )
+    {
+        converted_.release( m );
+        return;
+    }
+
+    if( inverted )
+    {
+        converted_.release( m );
+
+        // the context stack is unchanged, so the enclosing
+        // section's lookups remain valid
+        render_compiled( tmpl, first, last, cache, out );
+        return;
+    }
+
+    context_stack_.push_back( p );
+
+    // the contexts below the elements stay the same while
+    // iterating, so the lookups in them are done once, and
+    // the values converted for them are pinned until done
 
-        auto const* p = r->if_object();
+    std::size_t n = lookup_cache_.size();
+    lookup_cache_.resize( n + ( last - first ) );
 
-        if( p && p->contains( n ) )
+    std::size_t pinned = converted_.pinned();
+
+    json::value const* jv = pool_ && pool_->size() != 0? p.if_json(): nullptr;
+    json::array const* items = jv? jv->if_array(): nullptr;
+
+    if( items && items->size() >= 2 * chunk_size_ )
+    {
+        render_parallel_section( *items, tmpl, first, last, n, out );
+    }
+    else
+    {
+        section_frame frame = { this, &tmpl, first, last, n, out };
+
+        if( !p.for_each( &frame, &render_section_element ) )
         {
-            r = &p->at( n );
+            // not a list, render once with p as the context
+            render_compiled( tmpl, first, last, no_cache, out );
+        }
+    }
+
+    lookup_cache_.resize( n );
+
+    context_stack_.pop_back();
+
+    converted_.unpin( pinned );
+    converted_.release( m );
+}
+
+// the partial with the given name, compiled on first use, or nullptr
+
+boost::mustache::compiled_template const* boost::mustache::renderer::find_compiled_partial( core::string_view name )
+{
+    if( registry_ )
+    {
+        return registry_->find( name );
+    }
+
+    json::value const* p1 = partials_->if_contains( name );
+
+    if( p1 == 0 )
+    {
+        return nullptr;
+    }
+
+    json::string const* p2 = p1->if_string();
+
+    if( p2 == 0 )
+    {
+        return nullptr;
+    }
+
+    auto it = compiled_partials_.find( p2 );
+
+    if( it == compiled_partials_.end() )
+    {
+        compiled_partial cp = { compiled_template( *p2 ), true };
+        it = compiled_partials_.emplace( p2, std::move( cp ) ).first;
+    }
+    else if( !it->second.checked )
+    {
+        // *p2 may be another string at the address of the one compiled
+
+        if( it->second.tmpl.text_ != *p2 )
+        {
+            it->second.tmpl.assign( *p2, "{{", "}}", true, true );
+        }
+
+        it->second.checked = true;
+    }
+
+    return &it->second.tmpl;
+}
+
+// the partial referenced by the instruction at i, resolved in advance when
+// tmpl is linked to the registry, and on first use in the render when not;
+// a template shared by several renderers, as one from a template_cache,
+// can't be linked in place
+
+boost::mustache::compiled_template const* boost::mustache::renderer::find_compiled_partial( compiled_template const& tmpl, std::size_t i )
+{
+    compiled_template::instruction const& in = tmpl.code_[ i ];
+
+    if( registry_ == nullptr )
+    {
+        return find_compiled_partial( { tmpl.text_.data() + in.first, in.size } );
+    }
+
+    if( tmpl.linked_ == registry_ )
+    {
+        return tmpl.links_[ i ];
+    }
+
+    if( links_tmpl_ != &tmpl )
+    {
+        // the partials of the registry, and the section contents, are
+        // linked, so this is the template passed to render or start
+
+        links_tmpl_ = &tmpl;
+
+        cached_partial c = { false, nullptr };
+        links_.assign( tmpl.code_.size(), c );
+    }
+
+    cached_partial& c = links_[ i ];
+
+    if( !c.valid )
+    {
+        c.valid = true;
+        c.tmpl = registry_->find( { tmpl.text_.data() + in.first, in.size } );
+    }
+
+    return c.tmpl;
+}
+
+void boost::mustache::renderer::render_compiled_partial( compiled_template const& tmpl, std::size_t i, output_ref out )
+{
+    compiled_template::instruction const& in = tmpl.code_[ i ];
+
+    compiled_template const* p = find_compiled_partial( tmpl, i );
+
+    if( p == 0 )
+    {
+        return;
+    }
+
+    compiled_template const& partial = *p;
+
+    if( in.op == compiled_template::op_standalone_partial )
+    {
+        // the partial is indented by the whitespace before the tag
+
+        std::size_t n = indent_.size();
+        indent_.append( core::string_view( tmpl.text_.data() + in.arg, in.arg_size ) );
+
+        render_compiled( partial, 0, partial.code_.size(), no_cache, out );
+
+        indent_.resize( n );
+    }
+    else
+    {
+        // a partial that isn't standalone isn't indented
+
+        json::string old_indent( indent_.storage() );
+        old_indent.swap( indent_ );
+
+        render_compiled( partial, 0, partial.code_.size(), no_cache, out );
+
+        indent_.swap( old_indent );
+    }
+}
+
+// pull mode
+//
+// read renders the template one instruction at a time, keeping the state
+// of the sections and partials being rendered in pull_stack_ instead of
+// on the call stack, so it can stop when the caller's buffer is full.
+
+namespace
+{
+
+// fills the caller's buffer, and keeps what doesn't fit in pending
+
+struct pull_output
+{
+    using value_type = char;
+
+    char* p;
+    char* end;
+
+    boost::json::string* pending;
+
+    void append( char const* first, char const* last )
+    {
+        std::size_t n = last - first;
+        std::size_t m = static_cast<std::size_t>( end - p );
+
+        if( n <= m )
+        {
+            std::memcpy( p, first, n );
+            p += n;
         }
         else
         {
-            return 0;
+            std::memcpy( p, first, m );
+            p += m;
+
+            pending->append( boost::core::string_view( first + m, n - m ) );
         }
+    }
+};
+
+} // unnamed namespace
+
+void boost::mustache::renderer::start( compiled_template const& tmpl )
+{
+    // a previous start may have been abandoned in the middle of a
+    // section or a partial, so its contexts and indentation go too
+
+    context_stack_.resize( 1 );
+
+    partial_saved_.clear();
+    indent_.clear();
+
+    links_tmpl_ = nullptr;
+
+    lookup_cache_.clear();
+
+    converted_.unpin( converted_root_ );
+    converted_.release( 0 );
+
+    pull_clear();
+    pending_.clear();
+    pending_pos_ = 0;
+
+    pull_frame f = { &tmpl, 0, 0, tmpl.code_.size(), no_cache, nullptr, 0, {}, no_cache, no_cache, no_cache, 0, 0 };
+    pull_stack_.push_back( f );
+}
+
+boost::core::string_view boost::mustache::renderer::read( char* buf, std::size_t n )
+{
+    detail::data_store_scope scope( converted_ );
+
+    char* p = buf;
+    char* end = buf + n;
+
+    // the output left over from the last read goes first
+
+    {
+        std::size_t m = pending_.size() - pending_pos_;
+
+        if( m > n )
+        {
+            m = n;
+        }
+
+        std::memcpy( p, pending_.data() + pending_pos_, m );
+
+        p += m;
+        pending_pos_ += m;
 
-        if( i == core::string_view::npos )
+        if( pending_pos_ == pending_.size() )
         {
-            return r;
+            pending_.clear();
+            pending_pos_ = 0;
         }
     }
+
+    pull_output po = { p, end, &pending_ };
+
+    while( po.p != end && !pull_stack_.empty() )
+    {
+        pull_step( po );
+    }
+
+    if( stats_ )
+    {
+        stats_->bytes_emitted += po.p - buf;
+    }
+
+    return { buf, static_cast<std::size_t>( po.p - buf ) };
 }
 
-//
+bool boost::mustache::renderer::done() const noexcept
+{
+    return pull_stack_.empty() && pending_.empty();
+}
+
+// renders the next instruction of the innermost frame, mirroring render_compiled
 
-static bool is_value_true( boost::json::value const & jv )
+void boost::mustache::renderer::pull_step( output_ref out )
 {
-    switch( jv.kind() )
+    pull_frame& f = pull_stack_.back();
+
+    if( f.i == f.last )
     {
-    case boost::json::kind::null:
+        if( f.items && ++f.k < f.items->size() )
+        {
+            // the next element of a list section
+            converted_.release( f.converted_item );
+
+            context_stack_.back() = ( *f.items )[ f.k ];
+            f.i = f.first;
+
+            return;
+        }
+
+        if( !f.cursor.empty() )
+        {
+            converted_.release( f.converted_item );
 
-        return false;
+            f.cursor.next();
 
-    case boost::json::kind::bool_:
+            data_ref item = f.cursor.get();
+
+            if( !item.empty() )
+            {
+                context_stack_.back() = item.convert();
+                f.i = f.first;
+
+                return;
+            }
+        }
 
-        return jv.get_bool();
+        pull_pop();
+        return;
+    }
 
-    case boost::json::kind::int64:
+    compiled_template const& tmpl = *f.tmpl;
 
-        return jv.get_int64() != 0;
+    std::size_t i = f.i++;
 
-    case boost::json::kind::uint64:
+    compiled_template::instruction const& in = tmpl.code_[ i ];
 
-        return jv.get_uint64() != 0;
+    std::size_t slot = f.cache == no_cache? f.cache: f.cache + ( i - f.first );
 
-    case boost::json::kind::double_:
+    switch( in.op )
+    {
+    case compiled_template::op_literal:
 
-        return jv.get_double() != 0;
+        render_compiled_literal( { tmpl.text_.data() + in.first, in.size }, in.arg != 0, out );
+        break;
 
-    case boost::json::kind::string:
+    case compiled_template::op_indent:
 
-        return !jv.get_string().empty();
+        out.write( indent_ );
+        break;
 
-    case boost::json::kind::array:
+    case compiled_template::op_escaped:
+    case compiled_template::op_unescaped:
 
-        return !jv.get_array().empty();
+        output_value( lookup_value( tmpl, in.first, in.size, slot ), out, in.op == compiled_template::op_escaped );
+        break;
 
-    case boost::json::kind::object:
+    case compiled_template::op_section:
+    case compiled_template::op_inverted_section:
+    {
+        data_ref r = lookup_value( tmpl, in.first, in.size, slot );
 
-        return true;
+        count_section( r );
+
+        // f is invalidated by pushing the section's frame
+        f.i += in.arg;
+
+        pull_section( r, in.op == compiled_template::op_inverted_section, tmpl, i + 1, i + 1 + in.arg, slot == no_cache? slot: slot + 1 );
+        break;
+    }
+
+    case compiled_template::op_partial:
+    case compiled_template::op_standalone_partial:
+
+        if( stats_ )
+        {
+            ++stats_->partial_tags;
+        }
+
+        pull_partial( tmpl, i );
+        break;
 
     default:
 
         BOOST_ASSERT( false );
-        return true;
+        return;
     }
 }
 
-void boost::mustache::renderer::render_section( output_ref out )
+// pushes the frame of a section, mirroring render_compiled_section
+
+void boost::mustache::renderer::pull_section( data_ref p, bool inverted, compiled_template const& tmpl, std::size_t first, std::size_t last, std::size_t cache )
 {
-    json::value const * p = section_context_;
+    std::size_t m = converted_.size();
+
+    p = p.convert();
 
-    if( inverted_ )
+    if( p.is_true() == inverted )
     {
-        if( p == 0 || !is_value_true( *p ) )
+        converted_.release( m );
+        return;
+    }
+
+    if( inverted )
+    {
+        converted_.release( m );
+
+        pull_frame f = { &tmpl, first, first, last, cache, nullptr, 0, {}, no_cache, no_cache, no_cache, 0, 0 };
+        pull_stack_.push_back( f );
+
+        return;
+    }
+
+    context_stack_.push_back( p );
+
+    std::size_t n = lookup_cache_.size();
+    lookup_cache_.resize( n + ( last - first ) );
+
+    std::size_t pinned = converted_.pinned();
+
+    json::value const* jv = p.if_json();
+    json::array const* items = jv? jv->if_array(): nullptr;
+
+    if( items )
+    {
+        // JSON arrays are iterated by index, one element at a time;
+        // an empty array is false, so there's a first element
+
+        context_stack_.back() = items->front();
+
+        pull_frame f = { &tmpl, first, first, last, n, items, 0, {}, n, no_cache, m, pinned, converted_.size() };
+        pull_stack_.push_back( f );
+
+        return;
+    }
+
+    // other lists are iterated by a cursor, one element at a time;
+    // the frame is pushed first, so that pull_pop releases it
+
+    pull_frame f = { &tmpl, first, first, last, n, nullptr, 0, {}, n, no_cache, m, pinned, converted_.size() };
+    pull_stack_.push_back( f );
+
+    pull_frame& f2 = pull_stack_.back();
+
+    if( !p.begin( f2.cursor, pending_.storage().get() ) )
+    {
+        // not a list, render once with p as the context
+        f2.cache = no_cache;
+        return;
+    }
+
+    data_ref item = f2.cursor.get();
+
+    if( item.empty() )
+    {
+        // a range that tested nonempty, but has no elements
+        pull_pop();
+        return;
+    }
+
+    context_stack_.back() = item.convert();
+}
+
+// pushes the frame of a partial, mirroring render_compiled_partial
+
+void boost::mustache::renderer::pull_partial( compiled_template const& tmpl, std::size_t i )
+{
+    compiled_template::instruction const& in = tmpl.code_[ i ];
+
+    compiled_template const* p = find_compiled_partial( tmpl, i );
+
+    if( p == 0 )
+    {
+        return;
+    }
+
+    // the indentation is restored from partial_saved_ by pull_pop
+
+    std::size_t saved = partial_saved_.size();
+    partial_saved_.append( indent_ );
+
+    if( in.op == compiled_template::op_standalone_partial )
+    {
+        indent_.append( core::string_view( tmpl.text_.data() + in.arg, in.arg_size ) );
+    }
+    else
+    {
+        indent_.clear();
+    }
+
+    pull_frame f = { p, 0, 0, p->code_.size(), no_cache, nullptr, 0, {}, no_cache, saved, no_cache, 0, 0 };
+    pull_stack_.push_back( f );
+}
+
+void boost::mustache::renderer::pull_pop()
+{
+    pull_frame const& f = pull_stack_.back();
+
+    if( f.cache_size != no_cache )
+    {
+        lookup_cache_.resize( f.cache_size );
+        context_stack_.pop_back();
+    }
+
+    if( f.saved != no_cache )
+    {
+        indent_.assign( core::string_view( partial_saved_ ).substr( f.saved ) );
+        partial_saved_.resize( f.saved );
+    }
+
+    if( f.converted != no_cache )
+    {
+        converted_.unpin( f.pinned );
+        converted_.release( f.converted );
+    }
+
+    pull_stack_.back().cursor.release( pending_.storage().get() );
+    pull_stack_.pop_back();
+}
+
+void boost::mustache::renderer::pull_clear() noexcept
+{
+    for( pull_frame& f: pull_stack_ )
+    {
+        f.cursor.release( pending_.storage().get() );
+    }
+
+    pull_stack_.clear();
+}
+
+// parallel rendering of list sections
+//
+// The elements are split into chunks, which the calling thread and the
+// workers of the pool claim in order, render into a buffer each, and
+// which the calling thread outputs in order. At most one chunk per slot
+// is rendered ahead of the output, which bounds the memory used.
+
+struct boost::mustache::renderer::parallel_job
+{
+    renderer const* self;
+
+    json::array const* items;
+
+    compiled_template const* tmpl;
+    std::size_t first;
+    std::size_t last;
+
+    std::size_t cache;
+
+    // elements per chunk, and the number of chunks
+    std::size_t chunk;
+    std::size_t count;
+
+    struct slot
+    {
+        std::string text;
+        bool ready;
+    };
+
+    // chunk i is rendered into slots[ i % slots.size() ]
+    std::vector<slot> slots;
+
+    std::mutex mx;
+    std::condition_variable cv;
+
+    // the next chunk to claim, and the chunks output so far
+    std::size_t next;
+    std::size_t output;
+
+    // set when rendering a chunk has thrown
+    std::exception_ptr error;
+
+    // a chunk can be claimed when its slot has been output
+    bool can_claim() const noexcept
+    {
+        return next < count && next < output + slots.size();
+    }
+};
+
+namespace
+{
+
+void add_stats( boost::mustache::render_stats& st, boost::mustache::render_stats const& st2 )
+{
+    st.escaped_bytes += st2.escaped_bytes;
+
+    st.interpolation_tags += st2.interpolation_tags;
+    st.section_tags += st2.section_tags;
+    st.partial_tags += st2.partial_tags;
+    st.comment_tags += st2.comment_tags;
+    st.delimiter_tags += st2.delimiter_tags;
+
+    st.lookup_misses += st2.lookup_misses;
+}
+
+} // unnamed namespace
+
+void boost::mustache::renderer::render_chunk( parallel_job const& job, std::size_t i, output_ref out )
+{
+    std::size_t k1 = i * job.chunk;
+    std::size_t k2 = std::min( k1 + job.chunk, job.items->size() );
+
+    std::size_t m = converted_.size();
+
+    for( std::size_t k = k1; k < k2; ++k )
+    {
+        context_stack_.back() = ( *job.items )[ k ];
+        render_compiled( *job.tmpl, job.first, job.last, job.cache, out );
+
+        converted_.release( m );
+    }
+}
+
+// run by the workers; the chunks are rendered by a renderer of their own,
+// which allocates from the default resource, because the storage of the
+// renderer isn't necessarily thread-safe
+
+void boost::mustache::renderer::run_parallel_job( void * p )
+{
+    parallel_job& job = *static_cast<parallel_job*>( p );
+    renderer const& self = *job.self;
+
+    try
+    {
+        // setting up the renderer allocates, and is handled
+        // as a failure to render when it throws
+
+        renderer rd( borrow, data_ref(), *self.partials_ );
+
+        rd.registry_ = self.registry_;
+        rd.links_tmpl_ = self.links_tmpl_;
+        rd.links_.assign( self.links_.begin(), self.links_.end() );
+        rd.context_stack_ = self.context_stack_;
+        rd.lookup_cache_ = self.lookup_cache_;
+        rd.indent_ = self.indent_;
+
+        detail::data_store_scope scope( rd.converted_ );
+
+        render_stats st;
+
+        if( self.stats_ )
+        {
+            rd.stats_ = &st;
+        }
+
+        std::unique_lock<std::mutex> lock( job.mx );
+
+        for( ;; )
         {
-            json::string tmp( section_text_, section_text_.storage() );
+            job.cv.wait( lock, [&]{ return job.error || job.next == job.count || job.can_claim(); } );
+
+            if( job.error || job.next == job.count )
+            {
+                break;
+            }
+
+            std::size_t i = job.next++;
+            parallel_job::slot& s = job.slots[ i % job.slots.size() ];
+
+            lock.unlock();
+
+            rd.render_chunk( job, i, s.text );
+
+            lock.lock();
 
-            render_some( tmp, out );
-            finish( out );
+            s.ready = true;
+            job.cv.notify_all();
+        }
+
+        if( self.stats_ )
+        {
+            add_stats( *self.stats_, st );
         }
     }
-    else
+    catch( ... )
     {
-        if( p != 0 && is_value_true( *p ) )
+        std::lock_guard<std::mutex> lock( job.mx );
+
+        job.error = std::current_exception();
+        job.cv.notify_all();
+    }
+}
+
+void boost::mustache::renderer::render_parallel_section( json::array const& items, compiled_template const& tmpl, std::size_t first, std::size_t last, std::size_t cache, output_ref out )
+{
+    parallel_job job;
+
+    job.self = this;
+    job.items = &items;
+    job.tmpl = &tmpl;
+    job.first = first;
+    job.last = last;
+    job.cache = cache;
+    job.chunk = chunk_size_;
+    job.count = ( items.size() + chunk_size_ - 1 ) / chunk_size_;
+    job.slots.resize( 4 * ( pool_->size() + 1 ) );
+    job.next = 0;
+    job.output = 0;
+
+    thread_pool::task task = { &run_parallel_job, &job, 0, false };
+    pool_->post( task );
+
+    try
+    {
+        // the calling thread takes part in the rendering, so that the
+        // section is completed even when all the workers are busy
+
+        renderer rd( borrow, data_ref(), *partials_ );
+
+        rd.registry_ = registry_;
+        rd.links_tmpl_ = links_tmpl_;
+        rd.links_.assign( links_.begin(), links_.end() );
+        rd.context_stack_ = context_stack_;
+        rd.lookup_cache_ = lookup_cache_;
+        rd.indent_ = indent_;
+
+        render_stats st;
+
+        if( stats_ )
+        {
+            rd.stats_ = &st;
+        }
+
+        std::unique_lock<std::mutex> lock( job.mx );
+
+        while( !job.error && job.output < job.count )
         {
-            json::string tmp( section_text_, section_text_.storage() );
-            json::value const jv( *p, p->storage() );
+            parallel_job::slot& s = job.slots[ job.output % job.slots.size() ];
 
-            if( jv.is_array() )
+            if( s.ready )
             {
-                context_stack_.push_back( {} );
+                lock.unlock();
 
-                auto st = state_;
+                out.write( s.text );
+                s.text.clear();
 
-                for( auto const& item: jv.get_array() )
-                {
-                    context_stack_.back() = item;
+                lock.lock();
 
-                    render_some( tmp, out );
-                    finish( out );
+                s.ready = false;
+                ++job.output;
 
-                    state_ = st;
-                }
+                job.cv.notify_all();
+            }
+            else if( job.can_claim() )
+            {
+                std::size_t i = job.next++;
+                parallel_job::slot& s2 = job.slots[ i % job.slots.size() ];
+
+                lock.unlock();
 
-                context_stack_.pop_back();
+                rd.render_chunk( job, i, s2.text );
+
+                lock.lock();
+
+                s2.ready = true;
             }
             else
             {
-                context_stack_.push_back( jv );
+                job.cv.wait( lock );
+            }
+        }
 
-                render_some( tmp, out );
-                finish( out );
+        // the workers add their statistics under the lock as well
 
-                context_stack_.pop_back();
-            }
+        if( stats_ )
+        {
+            add_stats( *stats_, st );
+        }
+    }
+    catch( ... )
+    {
+        {
+            std::lock_guard<std::mutex> lock( job.mx );
+            job.error = std::current_exception();
+        }
+
+        job.cv.notify_all();
+    }
+
+    pool_->retract( task );
+
+    if( job.error )
+    {
+        std::rethrow_exception( job.error );
+    }
+}
+
+boost::mustache::data_ref boost::mustache::renderer::lookup_value( compiled_template const& tmpl, std::size_t first, std::size_t size, std::size_t cache )
+{
+    if( size == 0 )
+    {
+        // "."
+
+        if( root_incomplete_ && context_stack_.size() == 1 )
+        {
+            root_used_ = true;
         }
+
+        return context_stack_.back();
+    }
+
+    compiled_template::segment const* sg = tmpl.segments_.data() + first;
+    compiled_template::segment const* end = sg + size;
+
+    core::string_view n( tmpl.text_.data() + sg->first, sg->size );
+
+    std::size_t j = context_stack_.size() - 1;
+    data_ref r = context_stack_[ j ].lookup( n );
+
+    cached_lookup* c = 0;
+    std::size_t m = 0;
+
+    if( r.empty() && cache != no_cache )
+    {
+        // not in the current element, the rest of the stack
+        // is the same as for the previous elements
+
+        c = &lookup_cache_[ cache ];
+
+        if( c->valid )
+        {
+            return c->value;
+        }
+
+        m = converted_.size();
     }
+
+    while( r.empty() && j > 0 )
+    {
+        --j;
+        r = context_stack_[ j ].lookup( n );
+    }
+
+    if( r.empty() && root_incomplete_ && root_missed_.data() == nullptr )
+    {
+        root_missed_ = n;
+    }
+
+    for( ++sg; !r.empty() && sg != end; ++sg )
+    {
+        r = r.lookup( core::string_view( tmpl.text_.data() + sg->first, sg->size ) );
+    }
+
+    if( c )
+    {
+        c->valid = true;
+        c->value = r;
+
+        if( converted_.size() != m )
+        {
+            // the result refers to values converted for the lookup,
+            // which are kept for the rest of the section
+            converted_.pin();
+        }
+    }
+
+    return r;
 }
 
 //
 
-void boost::mustache::renderer::finish( output_ref out )
+void boost::mustache::renderer::finish_impl( output_ref out )
 {
     switch( state_ )
     {
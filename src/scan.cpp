@@ -0,0 +1,323 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include "scan.hpp"
+#include <boost/config.hpp>
+
+#if !defined(BOOST_MUSTACHE_NO_SIMD) && ( defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) )
+# define BOOST_MUSTACHE_SCAN_SSE2
+# include <emmintrin.h>
+#endif
+
+#if defined(BOOST_MUSTACHE_SCAN_SSE2) && ( defined(__x86_64__) || defined(_M_X64) ) && ( defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER) )
+# define BOOST_MUSTACHE_SCAN_AVX2
+# include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+# include <intrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+# define BOOST_MUSTACHE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+# define BOOST_MUSTACHE_TARGET_AVX2
+#endif
+
+namespace
+{
+
+// scalar
+
+char const* find_either_scalar( char const* p, char const* end, char c1, char c2 )
+{
+    while( p != end && *p != c1 && *p != c2 )
+    {
+        ++p;
+    }
+
+    return p;
+}
+
+char const* skip_spaces_scalar( char const* p, char const* end )
+{
+    while( p != end && ( *p == ' ' || *p == '\t' ) )
+    {
+        ++p;
+    }
+
+    return p;
+}
+
+char const* find_html_special_scalar( char const* p, char const* end )
+{
+    while( p != end && *p != '<' && *p != '>' && *p != '"' && *p != '&' )
+    {
+        ++p;
+    }
+
+    return p;
+}
+
+#if defined(BOOST_MUSTACHE_SCAN_SSE2)
+
+inline int countr_zero( unsigned x )
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+
+    unsigned long r;
+    _BitScanForward( &r, x );
+    return static_cast<int>( r );
+
+#else
+
+    return __builtin_ctz( x );
+
+#endif
+}
+
+// SSE2, 16 bytes at a time
+
+char const* find_either_sse2( char const* p, char const* end, char c1, char c2 )
+{
+    __m128i const v1 = _mm_set1_epi8( c1 );
+    __m128i const v2 = _mm_set1_epi8( c2 );
+
+    while( end - p >= 16 )
+    {
+        __m128i x = _mm_loadu_si128( reinterpret_cast<__m128i const*>( p ) );
+
+        unsigned m = static_cast<unsigned>( _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( x, v1 ), _mm_cmpeq_epi8( x, v2 ) ) ) );
+
+        if( m != 0 )
+        {
+            return p + countr_zero( m );
+        }
+
+        p += 16;
+    }
+
+    return find_either_scalar( p, end, c1, c2 );
+}
+
+char const* skip_spaces_sse2( char const* p, char const* end )
+{
+    __m128i const v1 = _mm_set1_epi8( ' ' );
+    __m128i const v2 = _mm_set1_epi8( '\t' );
+
+    while( end - p >= 16 )
+    {
+        __m128i x = _mm_loadu_si128( reinterpret_cast<__m128i const*>( p ) );
+
+        unsigned m = static_cast<unsigned>( _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( x, v1 ), _mm_cmpeq_epi8( x, v2 ) ) ) ) ^ 0xFFFFu;
+
+        if( m != 0 )
+        {
+            return p + countr_zero( m );
+        }
+
+        p += 16;
+    }
+
+    return skip_spaces_scalar( p, end );
+}
+
+char const* find_html_special_sse2( char const* p, char const* end )
+{
+    __m128i const v1 = _mm_set1_epi8( '<' );
+    __m128i const v2 = _mm_set1_epi8( '>' );
+    __m128i const v3 = _mm_set1_epi8( '"' );
+    __m128i const v4 = _mm_set1_epi8( '&' );
+
+    while( end - p >= 16 )
+    {
+        __m128i x = _mm_loadu_si128( reinterpret_cast<__m128i const*>( p ) );
+
+        __m128i y1 = _mm_or_si128( _mm_cmpeq_epi8( x, v1 ), _mm_cmpeq_epi8( x, v2 ) );
+        __m128i y2 = _mm_or_si128( _mm_cmpeq_epi8( x, v3 ), _mm_cmpeq_epi8( x, v4 ) );
+
+        unsigned m = static_cast<unsigned>( _mm_movemask_epi8( _mm_or_si128( y1, y2 ) ) );
+
+        if( m != 0 )
+        {
+            return p + countr_zero( m );
+        }
+
+        p += 16;
+    }
+
+    return find_html_special_scalar( p, end );
+}
+
+#endif // #if defined(BOOST_MUSTACHE_SCAN_SSE2)
+
+#if defined(BOOST_MUSTACHE_SCAN_AVX2)
+
+// AVX2, 32 bytes at a time
+
+BOOST_MUSTACHE_TARGET_AVX2 char const* find_either_avx2( char const* p, char const* end, char c1, char c2 )
+{
+    __m256i const v1 = _mm256_set1_epi8( c1 );
+    __m256i const v2 = _mm256_set1_epi8( c2 );
+
+    while( end - p >= 32 )
+    {
+        __m256i x = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( p ) );
+
+        unsigned m = static_cast<unsigned>( _mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi8( x, v1 ), _mm256_cmpeq_epi8( x, v2 ) ) ) );
+
+        if( m != 0 )
+        {
+            return p + countr_zero( m );
+        }
+
+        p += 32;
+    }
+
+    return find_either_sse2( p, end, c1, c2 );
+}
+
+BOOST_MUSTACHE_TARGET_AVX2 char const* skip_spaces_avx2( char const* p, char const* end )
+{
+    __m256i const v1 = _mm256_set1_epi8( ' ' );
+    __m256i const v2 = _mm256_set1_epi8( '\t' );
+
+    while( end - p >= 32 )
+    {
+        __m256i x = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( p ) );
+
+        unsigned m = ~static_cast<unsigned>( _mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi8( x, v1 ), _mm256_cmpeq_epi8( x, v2 ) ) ) );
+
+        if( m != 0 )
+        {
+            return p + countr_zero( m );
+        }
+
+        p += 32;
+    }
+
+    return skip_spaces_sse2( p, end );
+}
+
+BOOST_MUSTACHE_TARGET_AVX2 char const* find_html_special_avx2( char const* p, char const* end )
+{
+    __m256i const v1 = _mm256_set1_epi8( '<' );
+    __m256i const v2 = _mm256_set1_epi8( '>' );
+    __m256i const v3 = _mm256_set1_epi8( '"' );
+    __m256i const v4 = _mm256_set1_epi8( '&' );
+
+    while( end - p >= 32 )
+    {
+        __m256i x = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( p ) );
+
+        __m256i y1 = _mm256_or_si256( _mm256_cmpeq_epi8( x, v1 ), _mm256_cmpeq_epi8( x, v2 ) );
+        __m256i y2 = _mm256_or_si256( _mm256_cmpeq_epi8( x, v3 ), _mm256_cmpeq_epi8( x, v4 ) );
+
+        unsigned m = static_cast<unsigned>( _mm256_movemask_epi8( _mm256_or_si256( y1, y2 ) ) );
+
+        if( m != 0 )
+        {
+            return p + countr_zero( m );
+        }
+
+        p += 32;
+    }
+
+    return find_html_special_sse2( p, end );
+}
+
+bool has_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+
+    int r[ 4 ];
+
+    __cpuid( r, 0 );
+
+    if( r[ 0 ] < 7 )
+    {
+        return false;
+    }
+
+    __cpuid( r, 1 );
+
+    // OSXSAVE and AVX
+    int const mask = ( 1 << 27 ) | ( 1 << 28 );
+
+    if( ( r[ 2 ] & mask ) != mask )
+    {
+        return false;
+    }
+
+    // the OS saves the YMM registers
+    if( ( _xgetbv( 0 ) & 6 ) != 6 )
+    {
+        return false;
+    }
+
+    __cpuidex( r, 7, 0 );
+    return ( r[ 1 ] & ( 1 << 5 ) ) != 0;
+
+#else
+
+    return __builtin_cpu_supports( "avx2" );
+
+#endif
+}
+
+#endif // #if defined(BOOST_MUSTACHE_SCAN_AVX2)
+
+// run time dispatch
+
+struct scan_functions
+{
+    char const* (*find_either)( char const* p, char const* end, char c1, char c2 );
+    char const* (*skip_spaces)( char const* p, char const* end );
+    char const* (*find_html_special)( char const* p, char const* end );
+};
+
+scan_functions select_scan_functions()
+{
+#if defined(BOOST_MUSTACHE_SCAN_AVX2)
+
+    if( has_avx2() )
+    {
+        return { &find_either_avx2, &skip_spaces_avx2, &find_html_special_avx2 };
+    }
+
+#endif
+
+#if defined(BOOST_MUSTACHE_SCAN_SSE2)
+
+    return { &find_either_sse2, &skip_spaces_sse2, &find_html_special_sse2 };
+
+#else
+
+    return { &find_either_scalar, &skip_spaces_scalar, &find_html_special_scalar };
+
+#endif
+}
+
+scan_functions const& get_scan_functions()
+{
+    static scan_functions const fns = select_scan_functions();
+    return fns;
+}
+
+} // unnamed namespace
+
+char const* boost::mustache::detail::find_either( char const* first, char const* last, char c1, char c2 )
+{
+    return get_scan_functions().find_either( first, last, c1, c2 );
+}
+
+char const* boost::mustache::detail::skip_spaces( char const* first, char const* last )
+{
+    return get_scan_functions().skip_spaces( first, last );
+}
+
+char const* boost::mustache::detail::find_html_special( char const* first, char const* last )
+{
+    return get_scan_functions().find_html_special( first, last );
+}
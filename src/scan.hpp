@@ -0,0 +1,33 @@
+#ifndef BOOST_MUSTACHE_SRC_SCAN_HPP_INCLUDED
+#define BOOST_MUSTACHE_SRC_SCAN_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// scanning functions used by the renderer, the template compiler, and
+// the output functions; these use SSE2 or AVX2, selected at run time,
+// when available
+
+namespace boost
+{
+namespace mustache
+{
+namespace detail
+{
+
+// returns the first position in [first, last) holding c1 or c2, or last
+char const* find_either( char const* first, char const* last, char c1, char c2 );
+
+// returns the first position in [first, last) not holding ' ' or '\t', or last
+char const* skip_spaces( char const* first, char const* last );
+
+// returns the first position in [first, last) holding a character that
+// needs HTML escaping ('<', '>', '"', or '&'), or last
+char const* find_html_special( char const* first, char const* last );
+
+} // namespace detail
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_SRC_SCAN_HPP_INCLUDED
@@ -0,0 +1,617 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/stream_renderer.hpp>
+#include <boost/mustache/buffered_output.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/assert.hpp>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+
+bool is_json_whitespace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void fail()
+{
+    boost::throw_exception( std::invalid_argument( "stream_renderer: invalid JSON" ), BOOST_CURRENT_LOCATION );
+}
+
+// collects output to be discarded or written later
+
+struct string_output
+{
+    using value_type = char;
+
+    boost::json::string* s;
+
+    void append( char const* first, char const* last )
+    {
+        s->append( boost::core::string_view( first, last - first ) );
+    }
+};
+
+} // unnamed namespace
+
+boost::mustache::stream_renderer::stream_renderer( compiled_template const& tmpl, json::object const& partials, json::storage_ptr sp ):
+    tmpl_( &tmpl ), sp_( sp ), root_( json::object( sp ) ), rd_( borrow, root_, partials, sp ), parser_( sp ),
+    key_( sp ), items_( sp ), scratch_( sp )
+{
+    rd_.root_incomplete_ = true;
+}
+
+void boost::mustache::stream_renderer::write( core::string_view in, output_ref out )
+{
+    char buffer[ 1024 ];
+    buffered_output bo( out, buffer, sizeof( buffer ) );
+
+    write_impl( in, bo );
+
+    bo.flush();
+}
+
+void boost::mustache::stream_renderer::finish( output_ref out )
+{
+    char buffer[ 1024 ];
+    buffered_output bo( out, buffer, sizeof( buffer ) );
+
+    if( state_ == state_whole )
+    {
+        // not an object, parsed as a whole
+
+        parser_.finish();
+        root_ = parser_.release();
+
+        end_document( bo );
+    }
+    else if( state_ != state_end )
+    {
+        fail();
+    }
+
+    bo.flush();
+}
+
+// splits the top-level object into members, and the arrays of streamed
+// sections into elements, which are parsed separately by parser_
+
+void boost::mustache::stream_renderer::write_impl( core::string_view in, output_ref out )
+{
+    while( !in.empty() )
+    {
+        char c = in.front();
+
+        if( state_ != state_whole && state_ != state_key_string && state_ != state_member && state_ != state_item_value && is_json_whitespace( c ) )
+        {
+            in.remove_prefix( 1 );
+            continue;
+        }
+
+        switch( state_ )
+        {
+        case state_start:
+
+            if( c == '{' )
+            {
+                in.remove_prefix( 1 );
+                state_ = state_first_key;
+
+                // the text before the first tag
+                run( out );
+            }
+            else
+            {
+                state_ = state_whole;
+            }
+
+            break;
+
+        case state_whole:
+
+            parser_.write( in );
+            in = {};
+
+            break;
+
+        case state_first_key:
+        case state_key:
+
+            if( c == '}' && state_ == state_first_key )
+            {
+                in.remove_prefix( 1 );
+                state_ = state_end;
+
+                end_document( out );
+            }
+            else if( c == '"' )
+            {
+                state_ = state_key_string;
+            }
+            else
+            {
+                fail();
+            }
+
+            break;
+
+        case state_next_key:
+
+            if( c == ',' )
+            {
+                in.remove_prefix( 1 );
+                state_ = state_key;
+            }
+            else if( c == '}' )
+            {
+                in.remove_prefix( 1 );
+                state_ = state_end;
+
+                end_document( out );
+            }
+            else
+            {
+                fail();
+            }
+
+            break;
+
+        case state_key_string:
+        case state_member:
+        case state_item_value:
+        {
+            std::size_t n = scan( in );
+
+            parser_.write( in.substr( 0, n ) );
+            in.remove_prefix( n );
+
+            if( !ended_ )
+            {
+                // the value continues in the next input; a scalar ending
+                // at the end of in is only known to end then
+                break;
+            }
+
+            ended_ = false;
+
+            parser_.finish();
+
+            json::value v = parser_.release();
+            parser_.reset( sp_ );
+
+            if( state_ == state_key_string )
+            {
+                if( !v.is_string() )
+                {
+                    fail();
+                }
+
+                key_ = v.get_string();
+                state_ = state_colon;
+            }
+            else if( state_ == state_member )
+            {
+                root_.get_object().emplace( key_, std::move( v ) );
+                state_ = state_next_key;
+
+                add_member( out );
+            }
+            else
+            {
+                items_.push_back( std::move( v ) );
+                state_ = state_next_item;
+
+                add_item( out );
+            }
+
+            break;
+        }
+
+        case state_colon:
+
+            if( c != ':' )
+            {
+                fail();
+            }
+
+            in.remove_prefix( 1 );
+            state_ = state_value;
+
+            break;
+
+        case state_value:
+
+            if( c == '[' && can_stream() )
+            {
+                in.remove_prefix( 1 );
+                state_ = state_first_item;
+            }
+            else
+            {
+                state_ = state_member;
+            }
+
+            break;
+
+        case state_first_item:
+        case state_item:
+
+            if( c == ']' && state_ == state_first_item )
+            {
+                in.remove_prefix( 1 );
+                state_ = state_next_key;
+
+                end_items( out );
+            }
+            else
+            {
+                state_ = state_item_value;
+            }
+
+            break;
+
+        case state_next_item:
+
+            if( c == ',' )
+            {
+                in.remove_prefix( 1 );
+                state_ = state_item;
+            }
+            else if( c == ']' )
+            {
+                in.remove_prefix( 1 );
+                state_ = state_next_key;
+
+                end_items( out );
+            }
+            else
+            {
+                fail();
+            }
+
+            break;
+
+        case state_end:
+
+            fail();
+            break;
+        }
+    }
+}
+
+// the length of the prefix of in that belongs to the value being scanned;
+// sets ended_ when the value ends there
+
+std::size_t boost::mustache::stream_renderer::scan( core::string_view in )
+{
+    for( std::size_t i = 0; i < in.size(); ++i )
+    {
+        char c = in[ i ];
+
+        if( in_string_ )
+        {
+            if( escape_ )
+            {
+                escape_ = false;
+            }
+            else if( c == '\\' )
+            {
+                escape_ = true;
+            }
+            else if( c == '"' )
+            {
+                in_string_ = false;
+
+                if( depth_ == 0 )
+                {
+                    ended_ = true;
+                    return i + 1;
+                }
+            }
+        }
+        else if( c == '"' )
+        {
+            in_string_ = true;
+        }
+        else if( c == '{' || c == '[' )
+        {
+            ++depth_;
+        }
+        else if( c == '}' || c == ']' )
+        {
+            if( depth_ == 0 )
+            {
+                // the end of a scalar
+                ended_ = true;
+                return i;
+            }
+
+            if( --depth_ == 0 )
+            {
+                ended_ = true;
+                return i + 1;
+            }
+        }
+        else if( depth_ == 0 && ( c == ',' || c == ':' || is_json_whitespace( c ) ) )
+        {
+            // the end of a scalar
+            ended_ = true;
+            return i;
+        }
+    }
+
+    return in.size();
+}
+
+// the number of tags in tmpl whose name starts with name
+
+std::size_t boost::mustache::stream_renderer::count_references( compiled_template const& tmpl, core::string_view name ) const
+{
+    std::size_t r = 0;
+
+    for( auto const& in: tmpl.code_ )
+    {
+        switch( in.op )
+        {
+        case compiled_template::op_escaped:
+        case compiled_template::op_unescaped:
+        case compiled_template::op_section:
+        case compiled_template::op_inverted_section:
+
+            if( in.size != 0 )
+            {
+                compiled_template::segment const& sg = tmpl.segments_[ in.first ];
+
+                if( core::string_view( tmpl.text_.data() + sg.first, sg.size ) == name )
+                {
+                    ++r;
+                }
+            }
+
+            break;
+
+        default:
+
+            break;
+        }
+    }
+
+    return r;
+}
+
+// whether tmpl uses "." outside of the sections that change the context,
+// where it refers to the root when tmpl is rendered at the top level
+
+bool boost::mustache::stream_renderer::uses_root( compiled_template const& tmpl )
+{
+    for( std::size_t i = 0; i < tmpl.code_.size(); ++i )
+    {
+        compiled_template::instruction const& in = tmpl.code_[ i ];
+
+        switch( in.op )
+        {
+        case compiled_template::op_escaped:
+        case compiled_template::op_unescaped:
+        case compiled_template::op_inverted_section:
+
+            // the contents of an inverted section keep the context
+
+            if( in.size == 0 )
+            {
+                return true;
+            }
+
+            break;
+
+        case compiled_template::op_section:
+
+            if( in.size == 0 )
+            {
+                return true;
+            }
+
+            i += in.arg;
+            break;
+
+        default:
+
+            break;
+        }
+    }
+
+    return false;
+}
+
+// whether the array of the member key_ can be rendered as it's parsed:
+// the template waits for it, in a list section that's the only reference
+// to it, so that its elements aren't needed afterwards, also not as part
+// of the root
+
+bool boost::mustache::stream_renderer::can_stream()
+{
+    if( !waiting_ || rd_.root_used_ || rd_.root_missed_ != key_ || pc_ == tmpl_->code_.size() )
+    {
+        return false;
+    }
+
+    compiled_template::instruction const& in = tmpl_->code_[ pc_ ];
+
+    if( in.op != compiled_template::op_section || in.size != 1 )
+    {
+        return false;
+    }
+
+    if( count_references( *tmpl_, key_ ) != 1 || uses_root( *tmpl_ ) )
+    {
+        return false;
+    }
+
+    for( auto const& kv: *rd_.partials_ )
+    {
+        compiled_template const* p = rd_.find_compiled_partial( kv.key() );
+
+        if( p && ( count_references( *p, key_ ) != 0 || uses_root( *p ) ) )
+        {
+            return false;
+        }
+    }
+
+    waiting_ = false;
+
+    section_ = true;
+    section_open_ = true;
+
+    return true;
+}
+
+void boost::mustache::stream_renderer::add_member( output_ref out )
+{
+    if( waiting_ && !rd_.root_used_ && rd_.root_missed_ == key_ )
+    {
+        waiting_ = false;
+        run( out );
+    }
+}
+
+void boost::mustache::stream_renderer::add_item( output_ref out )
+{
+    if( !waiting_ )
+    {
+        run( out );
+    }
+}
+
+void boost::mustache::stream_renderer::end_items( output_ref out )
+{
+    section_open_ = false;
+
+    if( !waiting_ )
+    {
+        run( out );
+    }
+}
+
+void boost::mustache::stream_renderer::end_document( output_ref out )
+{
+    complete_ = true;
+    waiting_ = false;
+
+    rd_.root_incomplete_ = false;
+
+    run( out );
+}
+
+// renders the top-level instructions as far as the members parsed so far allow
+
+void boost::mustache::stream_renderer::run( output_ref out )
+{
+    compiled_template const& tmpl = *tmpl_;
+
+    while( !waiting_ )
+    {
+        if( section_ )
+        {
+            if( !render_items( out ) || section_open_ )
+            {
+                return;
+            }
+
+            section_ = false;
+            pc_ += 1 + tmpl.code_[ pc_ ].arg;
+
+            continue;
+        }
+
+        if( pc_ == tmpl.code_.size() )
+        {
+            return;
+        }
+
+        compiled_template::instruction const& in = tmpl.code_[ pc_ ];
+
+        std::size_t last = pc_ + 1;
+
+        if( in.op == compiled_template::op_section || in.op == compiled_template::op_inverted_section )
+        {
+            last += in.arg;
+        }
+
+        if( complete_ || in.op == compiled_template::op_literal || in.op == compiled_template::op_indent )
+        {
+            rd_.render_compiled( tmpl, pc_, last, renderer::no_cache, out );
+        }
+        else if( !try_render( pc_, last, out ) )
+        {
+            return;
+        }
+
+        pc_ = last;
+    }
+}
+
+// renders the parsed elements of the streamed section, and releases them
+
+bool boost::mustache::stream_renderer::render_items( output_ref out )
+{
+    compiled_template const& tmpl = *tmpl_;
+
+    std::size_t first = pc_ + 1;
+    std::size_t last = first + tmpl.code_[ pc_ ].arg;
+
+    while( item_pos_ < items_.size() )
+    {
+        rd_.context_stack_.push_back( items_[ item_pos_ ] );
+
+        bool r = true;
+
+        if( complete_ )
+        {
+            rd_.render_compiled( tmpl, first, last, renderer::no_cache, out );
+        }
+        else
+        {
+            r = try_render( first, last, out );
+        }
+
+        rd_.context_stack_.pop_back();
+
+        if( !r )
+        {
+            return false;
+        }
+
+        ++item_pos_;
+    }
+
+    items_.clear();
+    item_pos_ = 0;
+
+    return true;
+}
+
+// renders [first, last) aside; if it needs a member not yet parsed,
+// discards the output and waits for the member
+
+bool boost::mustache::stream_renderer::try_render( std::size_t first, std::size_t last, output_ref out )
+{
+    scratch_.clear();
+
+    rd_.root_missed_ = {};
+    rd_.root_used_ = false;
+
+    string_output so = { &scratch_ };
+    rd_.render_compiled( *tmpl_, first, last, renderer::no_cache, so );
+
+    if( rd_.root_missed_.data() != nullptr || rd_.root_used_ )
+    {
+        waiting_ = true;
+        return false;
+    }
+
+    out.write( scratch_ );
+    return true;
+}
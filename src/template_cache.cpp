@@ -0,0 +1,170 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/template_cache.hpp>
+
+namespace
+{
+
+// FNV-1a
+
+std::uint64_t hash_append( std::uint64_t h, boost::core::string_view s ) noexcept
+{
+    for( unsigned char ch: s )
+    {
+        h ^= ch;
+        h *= 0x100000001B3ull;
+    }
+
+    return h;
+}
+
+std::uint64_t hash_template( boost::core::string_view tmpl, boost::core::string_view start_delim, boost::core::string_view end_delim ) noexcept
+{
+    std::uint64_t h = 0xCBF29CE484222325ull;
+
+    // the delimiters can't contain whitespace or '=', so the separators
+    // keep ( "{{", "}} x" ) and ( "{{ }}", "x" ) apart
+
+    h = hash_append( h, start_delim );
+    h = hash_append( h, " " );
+    h = hash_append( h, end_delim );
+    h = hash_append( h, "=" );
+    h = hash_append( h, tmpl );
+
+    return h;
+}
+
+} // unnamed namespace
+
+boost::mustache::template_cache::template_cache( std::size_t max_bytes, std::size_t shards ):
+    shards_( new shard[ shards? shards: 1 ] ), shard_count_( shards? shards: 1 ), shard_bytes_( max_bytes / shard_count_ )
+{
+}
+
+boost::mustache::template_cache::~template_cache()
+{
+}
+
+// an estimate of the memory used by tmpl and its cache entry
+
+std::size_t boost::mustache::template_cache::memory_size( compiled_template const& tmpl ) noexcept
+{
+    return sizeof( entry ) + sizeof( compiled_template ) + tmpl.text_buffer_.capacity() + tmpl.code_buffer_.capacity() * sizeof( compiled_template::instruction ) + tmpl.segments_buffer_.capacity() * sizeof( compiled_template::segment );
+}
+
+void boost::mustache::template_cache::evict( shard& sh, std::size_t n )
+{
+    while( !sh.lru.empty() && sh.bytes + n > shard_bytes_ )
+    {
+        entry const& e = sh.lru.back();
+
+        sh.bytes -= e.bytes;
+        ++sh.evictions;
+
+        sh.index.erase( e.hash );
+        sh.lru.pop_back();
+    }
+}
+
+std::shared_ptr<boost::mustache::compiled_template const> boost::mustache::template_cache::get( core::string_view tmpl, core::string_view start_delim, core::string_view end_delim )
+{
+    std::uint64_t h = hash_template( tmpl, start_delim, end_delim );
+
+    // the low bits of h select the bucket in the shard's index
+
+    shard& sh = shards_[ ( h >> 40 ) % shard_count_ ];
+
+    {
+        std::lock_guard<std::mutex> lock( sh.mx );
+
+        auto it = sh.index.find( h );
+
+        if( it != sh.index.end() )
+        {
+            entry const& e = *it->second;
+
+            if( e.tmpl->text_ == tmpl && e.start_delim == start_delim && e.end_delim == end_delim )
+            {
+                ++sh.hits;
+
+                sh.lru.splice( sh.lru.begin(), sh.lru, it->second );
+                return e.tmpl;
+            }
+        }
+
+        ++sh.misses;
+    }
+
+    // compiled without holding the lock, so that a long template doesn't
+    // block the lookups of the others in the shard; should another thread
+    // compile it at the same time, the last one inserted is kept
+
+    std::shared_ptr<compiled_template const> p = std::make_shared<compiled_template>( tmpl, start_delim, end_delim );
+
+    std::size_t n = memory_size( *p ) + start_delim.size() + end_delim.size();
+
+    if( n > shard_bytes_ )
+    {
+        // doesn't fit; returned without being cached
+        return p;
+    }
+
+    std::lock_guard<std::mutex> lock( sh.mx );
+
+    auto it = sh.index.find( h );
+
+    if( it != sh.index.end() )
+    {
+        sh.bytes -= it->second->bytes;
+
+        sh.lru.erase( it->second );
+        sh.index.erase( it );
+    }
+
+    evict( sh, n );
+
+    sh.lru.push_front( { h, std::string( start_delim ), std::string( end_delim ), p, n } );
+    sh.index[ h ] = sh.lru.begin();
+
+    sh.bytes += n;
+
+    return p;
+}
+
+boost::mustache::template_cache_stats boost::mustache::template_cache::stats() const
+{
+    template_cache_stats r;
+
+    for( std::size_t i = 0; i < shard_count_; ++i )
+    {
+        shard& sh = shards_[ i ];
+
+        std::lock_guard<std::mutex> lock( sh.mx );
+
+        r.hits += sh.hits;
+        r.misses += sh.misses;
+        r.evictions += sh.evictions;
+
+        r.entries += sh.lru.size();
+        r.bytes += sh.bytes;
+    }
+
+    return r;
+}
+
+void boost::mustache::template_cache::clear()
+{
+    for( std::size_t i = 0; i < shard_count_; ++i )
+    {
+        shard& sh = shards_[ i ];
+
+        std::lock_guard<std::mutex> lock( sh.mx );
+
+        sh.index.clear();
+        sh.lru.clear();
+
+        sh.bytes = 0;
+    }
+}
@@ -0,0 +1,84 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/template_set.hpp>
+#include <boost/assert.hpp>
+#include <thread>
+#include <utility>
+
+boost::mustache::template_set::template_set():
+    template_set( std::make_shared<partial_registry>( json::object() ) )
+{
+}
+
+boost::mustache::template_set::template_set( std::shared_ptr<partial_registry const> templates ): current_( 0 )
+{
+    BOOST_ASSERT( templates != nullptr );
+    slots_[ 0 ].snapshot = std::move( templates );
+}
+
+boost::mustache::template_set::~template_set()
+{
+}
+
+// the counter of a slot is held for no longer than the copy of its
+// shared_ptr takes, so the publisher waits briefly, if at all; all the
+// operations on current_ and the counters are sequentially consistent,
+// so that a reader and a publisher can't both miss each other's update
+
+std::shared_ptr<boost::mustache::partial_registry const> boost::mustache::template_set::snapshot() const
+{
+    for( ;; )
+    {
+        unsigned i = current_.load();
+
+        slot& s = slots_[ i ];
+
+        ++s.readers;
+
+        if( current_.load() == i )
+        {
+            std::shared_ptr<partial_registry const> r = s.snapshot;
+
+            --s.readers;
+            return r;
+        }
+
+        // a publish has happened in the meantime; s may be written to
+
+        --s.readers;
+    }
+}
+
+void boost::mustache::template_set::publish( std::shared_ptr<partial_registry const> templates )
+{
+    BOOST_ASSERT( templates != nullptr );
+
+    std::lock_guard<std::mutex> lock( mx_ );
+
+    unsigned i = current_.load();
+    unsigned j = 1 - i;
+
+    // readers that have seen j current in a previous publish, and are yet
+    // to find out it no longer is
+
+    while( slots_[ j ].readers.load() != 0 )
+    {
+        std::this_thread::yield();
+    }
+
+    slots_[ j ].snapshot = std::move( templates );
+
+    current_.store( j );
+
+    // releases the reference held by the slot; the renders using the
+    // previous snapshot hold their own
+
+    while( slots_[ i ].readers.load() != 0 )
+    {
+        std::this_thread::yield();
+    }
+
+    slots_[ i ].snapshot.reset();
+}
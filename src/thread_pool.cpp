@@ -0,0 +1,95 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/thread_pool.hpp>
+#include <algorithm>
+
+boost::mustache::thread_pool::thread_pool( std::size_t threads )
+{
+    threads_.reserve( threads );
+
+    for( std::size_t i = 0; i < threads; ++i )
+    {
+        threads_.emplace_back( &thread_pool::run, this );
+    }
+}
+
+boost::mustache::thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock( mx_ );
+        stop_ = true;
+    }
+
+    cv_.notify_all();
+
+    for( auto& th: threads_ )
+    {
+        th.join();
+    }
+}
+
+// the workers join the oldest posted task; once a task returns, its work
+// has been handed out, so the worker removes it from the queue
+
+void boost::mustache::thread_pool::run()
+{
+    std::unique_lock<std::mutex> lock( mx_ );
+
+    for( ;; )
+    {
+        cv_.wait( lock, [&]{ return stop_ || !tasks_.empty(); } );
+
+        if( stop_ )
+        {
+            return;
+        }
+
+        task* t = tasks_.front();
+        ++t->running;
+
+        lock.unlock();
+
+        t->f( t->ctx );
+
+        lock.lock();
+
+        if( t->posted )
+        {
+            t->posted = false;
+            tasks_.erase( std::find( tasks_.begin(), tasks_.end(), t ) );
+        }
+
+        if( --t->running == 0 )
+        {
+            cv_.notify_all();
+        }
+    }
+}
+
+void boost::mustache::thread_pool::post( task& t )
+{
+    t.running = 0;
+    t.posted = true;
+
+    {
+        std::lock_guard<std::mutex> lock( mx_ );
+        tasks_.push_back( &t );
+    }
+
+    cv_.notify_all();
+}
+
+void boost::mustache::thread_pool::retract( task& t )
+{
+    std::unique_lock<std::mutex> lock( mx_ );
+
+    if( t.posted )
+    {
+        t.posted = false;
+        tasks_.erase( std::find( tasks_.begin(), tasks_.end(), &t ) );
+    }
+
+    cv_.wait( lock, [&]{ return t.running == 0; } );
+}
@@ -0,0 +1,107 @@
+#ifndef BOOST_MUSTACHE_SRC_UTILITY_HPP_INCLUDED
+#define BOOST_MUSTACHE_SRC_UTILITY_HPP_INCLUDED
+
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// utility functions shared by the renderer and the template compiler
+
+#include <boost/core/detail/string_view.hpp>
+#include <cstddef>
+
+namespace boost
+{
+namespace mustache
+{
+namespace detail
+{
+
+inline core::string_view trim_leading_whitespace( core::string_view sv )
+{
+    char const* p = sv.data();
+    char const* end = p + sv.size();
+
+    while( p != end && ( *p == ' ' || *p == '\t' ) )
+    {
+        ++p;
+    }
+
+    return { p, static_cast<std::size_t>( end - p ) };
+}
+
+inline core::string_view trim_trailing_whitespace( core::string_view sv )
+{
+    char const* p = sv.data();
+    char const* end = p + sv.size();
+
+    while( p != end && ( end[ -1 ] == ' ' || end[ -1 ] == '\t' ) )
+    {
+        --end;
+    }
+
+    return { p, static_cast<std::size_t>( end - p ) };
+}
+
+inline core::string_view trim_whitespace( core::string_view sv )
+{
+    sv = trim_leading_whitespace( sv );
+    sv = trim_trailing_whitespace( sv );
+
+    return sv;
+}
+
+// whether the tag can stand alone on a line
+
+inline bool is_tag_standalone( core::string_view tag )
+{
+    tag = trim_leading_whitespace( tag );
+
+    if( tag.empty() )
+    {
+        return false;
+    }
+
+    char ch = tag.front();
+
+    return ch == '!' || ch == '=' || ch == '>' || ch == '#' || ch == '^' || ch == '/';
+}
+
+inline core::string_view get_leading_token( core::string_view sv )
+{
+    char const* p = sv.data();
+    char const* end = p + sv.size();
+
+    while( p != end && ( *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' ) )
+    {
+        ++p;
+    }
+
+    return { sv.data(), static_cast<std::size_t>( p - sv.data() ) };
+}
+
+// parses the contents of a set delimiter tag, without the surrounding '='
+
+inline bool parse_delimiters( core::string_view tag, core::string_view& d1, core::string_view& d2 )
+{
+    tag = trim_leading_whitespace( tag );
+
+    d1 = get_leading_token( tag );
+    tag.remove_prefix( d1.size() );
+
+    tag = trim_leading_whitespace( tag );
+
+    d2 = get_leading_token( tag );
+    tag.remove_prefix( d2.size() );
+
+    tag = trim_leading_whitespace( tag );
+
+    // the tag contents must be exactly two non-whitespace sequences
+    return !d1.empty() && !d2.empty() && tag.empty();
+}
+
+} // namespace detail
+} // namespace mustache
+} // namespace boost
+
+#endif // #ifndef BOOST_MUSTACHE_SRC_UTILITY_HPP_INCLUDED
@@ -0,0 +1,321 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/config.hpp>
+#include <boost/config/pragma_message.hpp>
+
+#if defined(BOOST_NO_CXX20_HDR_COROUTINE)
+
+BOOST_PRAGMA_MESSAGE( "Skipping test because BOOST_NO_CXX20_HDR_COROUTINE is defined" )
+int main() {}
+
+#else
+
+#include <boost/mustache/async_render.hpp>
+#include <boost/mustache/render_stats.hpp>
+#include <boost/mustache/lazy_range.hpp>
+#include <boost/describe.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <algorithm>
+#include <coroutine>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+// an in-memory stand-in for a socket; writes suspend the writer
+// until the peer drains them by calling poll
+
+class test_socket
+{
+private:
+
+    boost::core::string_view pending_;
+    std::coroutine_handle<> writer_;
+
+public:
+
+    std::string received;
+
+    std::size_t writes = 0;
+    std::size_t max_write = 0;
+
+    // the number of writes after which poll fails the write
+    std::size_t fail_after = ~std::size_t( 0 );
+
+    struct write_op
+    {
+        test_socket* self;
+        boost::core::string_view sv;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend( std::coroutine_handle<> h ) noexcept
+        {
+            BOOST_TEST( !self->writer_ );
+
+            self->pending_ = sv;
+            self->writer_ = h;
+        }
+
+        void await_resume() const
+        {
+            if( self->writes > self->fail_after )
+            {
+                throw std::runtime_error( "connection reset" );
+            }
+        }
+    };
+
+    write_op write( boost::core::string_view sv )
+    {
+        return { this, sv };
+    }
+
+    // completes the pending write, and resumes the writer
+    bool poll()
+    {
+        if( !writer_ )
+        {
+            return false;
+        }
+
+        received.append( pending_.data(), pending_.size() );
+
+        ++writes;
+
+        if( pending_.size() > max_write )
+        {
+            max_write = pending_.size();
+        }
+
+        std::exchange( writer_, {} ).resume();
+        return true;
+    }
+};
+
+// described rows, produced on demand
+
+static std::size_t live_rows = 0;
+static std::size_t max_live_rows = 0;
+
+struct row
+{
+    int id;
+    std::string name;
+
+    row( int id, std::string name ): id( id ), name( std::move( name ) )
+    {
+        max_live_rows = std::max( max_live_rows, ++live_rows );
+    }
+
+    row( row const& r ): row( r.id, r.name )
+    {
+    }
+
+    row& operator=( row const& r ) = default;
+
+    ~row()
+    {
+        --live_rows;
+    }
+};
+
+BOOST_DESCRIBE_STRUCT(row, (), (id, name))
+
+static auto make_rows( int n )
+{
+    return boost::mustache::make_lazy_range( [i = 0, n]() mutable -> std::optional<row> {
+
+        if( i == n )
+        {
+            return std::nullopt;
+        }
+
+        int k = i++;
+        return row( k, "<row " + std::to_string( k ) + ">" );
+
+    });
+}
+
+using row_range = decltype( make_rows( 0 ) );
+
+struct page
+{
+    std::string title;
+    row_range rows;
+};
+
+BOOST_DESCRIBE_STRUCT(page, (), (title, rows))
+
+static boost::mustache::render_task render_page( boost::mustache::renderer& rd, boost::mustache::compiled_template const& header, boost::mustache::compiled_template const& body, test_socket& sock )
+{
+    co_await boost::mustache::async_render( rd, header, sock, 64 );
+
+    rd.reset();
+
+    co_await boost::mustache::async_render( rd, body, sock, 64 );
+}
+
+int main()
+{
+    boost::json::array rows;
+
+    for( int i = 0; i < 5000; ++i )
+    {
+        rows.push_back( { { "id", i }, { "name", "<row " + std::to_string( i ) + ">" } } );
+    }
+
+    boost::json::value data = { { "title", "Rows" }, { "rows", std::move( rows ) } };
+    boost::json::object partials = { { "row", "<tr id=\"{{id}}\"><td>{{name}}</td></tr>\n" } };
+
+    boost::mustache::compiled_template tmpl( "<h1>{{title}}</h1>\n<table>\n{{#rows}}\n  {{>row}}\n{{/rows}}\n</table>\n" );
+
+    std::string expected;
+
+    {
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+        rd.render( tmpl, expected );
+    }
+
+    BOOST_TEST_GT( expected.size(), 100000u );
+
+    {
+        // the writes interleave with rendering, a buffer at a time
+
+        boost::mustache::render_stats st;
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials, &st );
+
+        test_socket sock;
+
+        boost::mustache::render_task task = boost::mustache::async_render( rd, tmpl, sock, 1024 );
+
+        BOOST_TEST( !task.done() );
+        BOOST_TEST_EQ( sock.writes, 0u );
+
+        task.start();
+
+        while( sock.poll() )
+        {
+            // the renderer stays ahead of the socket by one buffer
+            BOOST_TEST_LE( sock.received.size(), expected.size() );
+        }
+
+        BOOST_TEST( task.done() );
+        task.get();
+
+        BOOST_TEST( sock.received == expected );
+
+        BOOST_TEST_EQ( sock.max_write, 1024u );
+        BOOST_TEST_EQ( sock.writes, ( expected.size() + 1023 ) / 1024 );
+
+        // the memory used by the renderer doesn't grow with the output
+        BOOST_TEST_LT( st.peak_bytes, 4096u );
+    }
+
+    {
+        // awaited from another coroutine
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+
+        boost::mustache::compiled_template header( "<title>{{title}}</title>\n" );
+
+        test_socket sock;
+
+        boost::mustache::render_task task = render_page( rd, header, tmpl, sock );
+
+        task.start();
+
+        while( sock.poll() )
+        {
+        }
+
+        BOOST_TEST( task.done() );
+        task.get();
+
+        BOOST_TEST( sock.received == "<title>Rows</title>\n" + expected );
+        BOOST_TEST_EQ( sock.max_write, 64u );
+    }
+
+    {
+        // a failed write ends the render with the exception
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+
+        test_socket sock;
+        sock.fail_after = 3;
+
+        boost::mustache::render_task task = boost::mustache::async_render( rd, tmpl, sock, 256 );
+
+        task.start();
+
+        while( sock.poll() )
+        {
+        }
+
+        BOOST_TEST( task.done() );
+        BOOST_TEST_THROWS( task.get(), std::runtime_error );
+
+        BOOST_TEST_EQ( sock.writes, 4u );
+    }
+
+    {
+        // a described page with a lazy list of rows, rendered a row
+        // at a time as the socket drains
+
+        page pg{ "Rows", make_rows( 5000 ) };
+
+        boost::mustache::render_stats st;
+
+        boost::mustache::renderer rd( boost::mustache::borrow, pg, partials, &st );
+
+        test_socket sock;
+
+        live_rows = max_live_rows = 0;
+
+        boost::mustache::render_task task = boost::mustache::async_render( rd, tmpl, sock, 1024 );
+
+        task.start();
+
+        while( sock.poll() )
+        {
+        }
+
+        BOOST_TEST( task.done() );
+        task.get();
+
+        BOOST_TEST( sock.received == expected );
+        BOOST_TEST_EQ( sock.writes, ( expected.size() + 1023 ) / 1024 );
+
+        BOOST_TEST_LT( st.peak_bytes, 4096u );
+
+        BOOST_TEST_EQ( live_rows, 0u );
+        BOOST_TEST_LE( max_live_rows, 2u );
+    }
+
+    {
+        // an empty template writes nothing
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+
+        test_socket sock;
+
+        boost::mustache::compiled_template empty( "{{#missing}}x{{/missing}}" );
+
+        boost::mustache::render_task task = boost::mustache::async_render( rd, empty, sock );
+
+        task.start();
+
+        BOOST_TEST( task.done() );
+        BOOST_TEST( !sock.poll() );
+        BOOST_TEST_EQ( sock.writes, 0u );
+    }
+
+    return boost::report_errors();
+}
+
+#endif
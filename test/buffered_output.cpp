@@ -0,0 +1,90 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/buffered_output.hpp>
+#include <boost/mustache/render.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <string>
+
+// a string that counts the calls to append
+
+struct counting_string
+{
+    using value_type = char;
+
+    std::string str;
+    std::size_t calls = 0;
+
+    void append( char const* first, char const* last )
+    {
+        str.append( first, last );
+        ++calls;
+    }
+};
+
+int main()
+{
+    {
+        counting_string st;
+
+        char buffer[ 8 ];
+        boost::mustache::buffered_output bo( st, buffer, sizeof( buffer ) );
+
+        bo.write( "abc" );
+        bo.write( "" );
+        bo.write( "def" );
+
+        BOOST_TEST_EQ( st.calls, 0u );
+
+        bo.write( "ghi" );
+
+        BOOST_TEST_EQ( st.str, std::string( "abcdef" ) );
+        BOOST_TEST_EQ( st.calls, 1u );
+
+        bo.write( "0123456789" );
+
+        BOOST_TEST_EQ( st.str, std::string( "abcdefghi0123456789" ) );
+        BOOST_TEST_EQ( st.calls, 3u );
+
+        boost::mustache::output_ref out( bo );
+        out.write( "jk" );
+
+        bo.flush();
+        bo.flush();
+
+        BOOST_TEST_EQ( st.str, std::string( "abcdefghi0123456789jk" ) );
+        BOOST_TEST_EQ( st.calls, 4u );
+    }
+
+    // the number of writes the renderer performs doesn't
+    // depend on the number of tags
+
+    {
+        boost::json::array items;
+
+        for( int i = 0; i < 100; ++i )
+        {
+            items.push_back( { { "x", i }, { "y", "<y>" } } );
+        }
+
+        boost::json::value data = { { "items", std::move( items ) } };
+
+        counting_string st;
+        boost::mustache::render( "{{#items}}({{x}}, {{y}})\n{{/items}}", st, data, {} );
+
+        std::string expected;
+        boost::mustache::render( "{{#items}}({{x}}, {{y}})\n{{/items}}", expected, data, {} );
+
+        BOOST_TEST_EQ( st.str, expected );
+        BOOST_TEST_LE( st.calls, st.str.size() / 512 + 4 );
+
+        counting_string st2;
+        boost::mustache::render( boost::mustache::compiled_template( "{{#items}}({{x}}, {{y}})\n{{/items}}" ), st2, data, {} );
+
+        BOOST_TEST_EQ( st2.str, expected );
+        BOOST_TEST_LE( st2.calls, st2.str.size() / 512 + 4 );
+    }
+
+    return boost::report_errors();
+}
@@ -0,0 +1,55 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/compiled_template.hpp>
+#include <boost/mustache/render.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <string>
+
+static std::string render( boost::mustache::compiled_template const& tmpl, boost::json::value const& data, boost::json::object const& partials = {} )
+{
+    std::string r;
+    boost::mustache::render( tmpl, r, data, partials );
+    return r;
+}
+
+int main()
+{
+    // the same compiled template, rendered with different data
+
+    {
+        boost::mustache::compiled_template tmpl( "{{#items}}<{{name}}>{{/items}}{{^items}}none{{/items}}" );
+
+        BOOST_TEST_EQ( render( tmpl, { { "items", { { { "name", "a" } }, { { "name", "b" } } } } } ), std::string( "<a><b>" ) );
+        BOOST_TEST_EQ( render( tmpl, { { "items", boost::json::array() } } ), std::string( "none" ) );
+        BOOST_TEST_EQ( render( tmpl, { { "items", { { "name", "c" } } } } ), std::string( "<c>" ) );
+    }
+
+    // dotted names
+
+    {
+        boost::mustache::compiled_template tmpl( "{{a.b.c}}|{{#a}}{{b.c}}{{/a}}|{{a.x.c}}" );
+
+        BOOST_TEST_EQ( render( tmpl, { { "a", { { "b", { { "c", 5 } } } } } } ), std::string( "5|5|" ) );
+    }
+
+    // custom initial delimiters
+
+    {
+        boost::mustache::compiled_template tmpl( "<% x %> {{x}} <%={{ }}=%>{{x}}", "<%", "%>" );
+
+        BOOST_TEST_EQ( render( tmpl, { { "x", "&" } } ), std::string( "&amp; {{x}} &amp;" ) );
+    }
+
+    // standalone partials are indented
+
+    {
+        boost::mustache::compiled_template tmpl( "<\n  {{>p}}\n>" );
+        boost::json::object partials{ { "p", "a\nb\n" } };
+
+        BOOST_TEST_EQ( render( tmpl, {}, partials ), std::string( "<\n  a\n  b\n>" ) );
+    }
+
+    return boost::report_errors();
+}
@@ -0,0 +1,206 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/partial_registry.hpp>
+#include <boost/mustache/render.hpp>
+#include <boost/mustache/thread_pool.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::string render( boost::core::string_view tmpl, boost::json::value const& data, boost::json::object const& partials )
+{
+    std::string r;
+    boost::mustache::render( tmpl, r, data, partials );
+    return r;
+}
+
+static std::string render( boost::core::string_view tmpl, boost::json::value const& data, boost::mustache::partial_registry const& partials )
+{
+    std::string r;
+    boost::mustache::render( tmpl, r, data, partials );
+    return r;
+}
+
+static std::string render( boost::mustache::compiled_template const& tmpl, boost::json::value const& data, boost::mustache::partial_registry const& partials )
+{
+    std::string r;
+    boost::mustache::render( tmpl, r, data, partials );
+    return r;
+}
+
+int main()
+{
+    boost::json::object partials =
+    {
+        { "row", "<tr>{{#cols}}{{>cell}}{{/cols}}</tr>\n" },
+        { "cell", "<td>{{.}}</td>" },
+        { "list", "<ul>\n{{#items}}\n  {{>item}}\n{{/items}}\n</ul>\n" },
+        { "item", "<li>\n  {{name}}\n</li>\n" },
+        { "node", "{{name}}\n{{#children}}\n  {{>node}}\n{{/children}}\n" },
+        { "number", 5 },
+    };
+
+    boost::mustache::partial_registry registry( partials );
+
+    BOOST_TEST_EQ( registry.size(), 5u );
+
+    BOOST_TEST( registry.find( "row" ) != nullptr );
+    BOOST_TEST( registry.find( "node" ) != nullptr );
+    BOOST_TEST( registry.find( "number" ) == nullptr );
+    BOOST_TEST( registry.find( "missing" ) == nullptr );
+    BOOST_TEST( registry.find( "" ) == nullptr );
+
+    boost::json::value data =
+    {
+        { "rows", { { { "cols", { 1, 2 } } }, { { "cols", { "<3>" } } } } },
+        { "items", { { { "name", "a" } }, { { "name", "b" } } } },
+        { "name", "root" },
+        { "children", { { { "name", "x" }, { "children", { { { "name", "y" }, { "children", boost::json::array() } } } } }, { { "name", "z" }, { "children", boost::json::array() } } } },
+    };
+
+    char const* templates[] =
+    {
+        "{{#rows}}{{>row}}{{/rows}}",
+        "  {{>list}}",
+        "{{>node}}",
+        "[{{>number}}][{{>missing}}]",
+        "{{#rows}}\n  {{>row}}\n{{/rows}}\n",
+        "<{{>cell}}> {{>item}}",
+    };
+
+    for( char const* tmpl: templates )
+    {
+        std::string expected = render( tmpl, data, partials );
+
+        BOOST_TEST_EQ( render( tmpl, data, registry ), expected );
+
+        boost::mustache::compiled_template ct( tmpl );
+        BOOST_TEST_EQ( render( ct, data, registry ), expected );
+
+        // resolved in advance
+
+        registry.link( ct );
+        BOOST_TEST_EQ( render( ct, data, registry ), expected );
+
+        // a template linked to another registry is still rendered correctly
+
+        boost::mustache::partial_registry registry2( partials );
+        BOOST_TEST_EQ( render( ct, data, registry2 ), expected );
+    }
+
+    {
+        // the partials of a template that isn't linked are resolved on
+        // first use in each render; another template at the same address
+        // refers to other partials
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, registry );
+
+        boost::mustache::compiled_template ct( templates[ 0 ] );
+
+        std::string r;
+        rd.render( ct, r );
+
+        BOOST_TEST_EQ( r, render( templates[ 0 ], data, partials ) );
+
+        ct = boost::mustache::compiled_template( "{{#items}}{{>item}}{{/items}}" );
+
+        r.clear();
+        rd.render( ct, r );
+
+        BOOST_TEST_EQ( r, render( "{{#items}}{{>item}}{{/items}}", data, partials ) );
+    }
+
+    {
+        // renderers sharing a registry across threads
+
+        std::string expected = render( templates[ 4 ], data, partials );
+
+        boost::mustache::compiled_template ct( templates[ 4 ] );
+        registry.link( ct );
+
+        std::vector<std::string> results( 8 );
+        std::vector<std::thread> threads;
+
+        for( std::size_t i = 0; i < results.size(); ++i )
+        {
+            threads.emplace_back( [&, i]{
+
+                for( int j = 0; j < 100; ++j )
+                {
+                    results[ i ] = i % 2? render( templates[ 4 ], data, registry ): render( ct, data, registry );
+                }
+            } );
+        }
+
+        for( auto& th: threads )
+        {
+            th.join();
+        }
+
+        for( auto const& r: results )
+        {
+            BOOST_TEST_EQ( r, expected );
+        }
+    }
+
+    {
+        // data converted by value_from, and a registry built by value_from
+
+        std::map<std::string, std::string> p2 = { { "greeting", "Hello, {{name}}!" } };
+        boost::mustache::partial_registry registry2( p2 );
+
+        std::map<std::string, std::string> d2 = { { "name", "<World>" } };
+
+        std::string r;
+        boost::mustache::render( "{{>greeting}}", r, d2, registry2 );
+
+        BOOST_TEST_EQ( r, "Hello, &lt;World&gt;!" );
+    }
+
+    {
+        // reset, pull mode, and list sections rendered in parallel
+
+        boost::json::array rows;
+
+        for( int i = 0; i < 1000; ++i )
+        {
+            rows.push_back( { { "cols", { i, i + 1 } } } );
+        }
+
+        boost::json::value d3 = { { "rows", rows } };
+
+        boost::mustache::compiled_template ct( templates[ 0 ] );
+        std::string expected = render( templates[ 0 ], d3, partials );
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+        rd.reset( boost::mustache::borrow, d3, registry );
+
+        std::string r;
+
+        rd.start( ct );
+
+        while( !rd.done() )
+        {
+            char buffer[ 7 ];
+            r += rd.read( buffer, sizeof( buffer ) );
+        }
+
+        BOOST_TEST_EQ( r, expected );
+
+        boost::mustache::thread_pool tp( 3 );
+
+        rd.reset();
+        rd.set_thread_pool( &tp, 16 );
+
+        r.clear();
+        rd.render( ct, r );
+
+        BOOST_TEST_EQ( r, expected );
+    }
+
+    return boost::report_errors();
+}
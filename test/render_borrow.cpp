@@ -0,0 +1,97 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/render.hpp>
+#include <boost/json/memory_resource.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <string>
+#include <new>
+
+class counting_resource: public boost::json::memory_resource
+{
+public:
+
+    std::size_t allocations = 0;
+
+private:
+
+    void* do_allocate( std::size_t n, std::size_t /*align*/ ) override
+    {
+        ++allocations;
+        return ::operator new( n );
+    }
+
+    void do_deallocate( void* p, std::size_t /*n*/, std::size_t /*align*/ ) override
+    {
+        ::operator delete( p );
+    }
+
+    bool do_is_equal( boost::json::memory_resource const& r ) const noexcept override
+    {
+        return this == &r;
+    }
+};
+
+static boost::json::value make_data( int n )
+{
+    boost::json::array items;
+
+    for( int i = 0; i < n; ++i )
+    {
+        items.push_back( { { "name", "item number " + std::to_string( i ) } } );
+    }
+
+    return { { "items", std::move( items ) } };
+}
+
+static std::size_t count_allocations( boost::core::string_view tmpl, boost::json::value const& data, boost::json::object const& partials, std::string& result )
+{
+    counting_resource mr;
+
+    boost::mustache::renderer rd( boost::mustache::borrow, data, partials, &mr );
+
+    rd.render_some( tmpl, result );
+    rd.finish( result );
+
+    return mr.allocations;
+}
+
+int main()
+{
+    {
+        boost::json::value data = { { "x", 1 }, { "y", { 2, 3 } } };
+        boost::json::object partials = { { "p", "({{.}})" } };
+
+        std::string result;
+        boost::mustache::render( "{{x}}{{#y}}{{>p}}{{/y}}", result, data, partials );
+
+        BOOST_TEST_EQ( result, std::string( "1(2)(3)" ) );
+
+        result.clear();
+        boost::mustache::render( boost::mustache::compiled_template( "{{x}}{{#y}}{{>p}}{{/y}}" ), result, data, partials );
+
+        BOOST_TEST_EQ( result, std::string( "1(2)(3)" ) );
+    }
+
+    // borrowed data isn't copied, so the number of allocations
+    // doesn't depend on its size
+
+    {
+        char const* tmpl = "{{#items}}{{name}};{{/items}}";
+        boost::json::object partials;
+
+        boost::json::value d1 = make_data( 10 );
+        boost::json::value d2 = make_data( 1000 );
+
+        std::string r1, r2;
+
+        std::size_t n1 = count_allocations( tmpl, d1, partials, r1 );
+        std::size_t n2 = count_allocations( tmpl, d2, partials, r2 );
+
+        BOOST_TEST_EQ( n1, n2 );
+        BOOST_TEST_GT( r2.size(), r1.size() );
+    }
+
+    return boost::report_errors();
+}
@@ -25,6 +25,19 @@ static void test( boost::core::string_view tmpl, boost::json::value const& data,
         }
     }
 
+    // compiled
+
+    {
+        std::string result;
+        boost::mustache::render( boost::mustache::compiled_template( tmpl ), result, data, partials );
+
+        if( result != expected )
+        {
+            std::cerr << "Test (compiled) failed: result '" << result << "', expected '" << expected << "'" << std::endl;
+            ++errors;
+        }
+    }
+
     // chunked
 
     for( std::size_t i = 1; i <= 8; ++i )
@@ -0,0 +1,246 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/render.hpp>
+#include <boost/mustache/render_stats.hpp>
+#include <boost/describe.hpp>
+#include <boost/optional.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <vector>
+#include <map>
+#include <string>
+
+struct point
+{
+    int x;
+    int y;
+};
+
+BOOST_DESCRIBE_STRUCT(point, (), (x, y))
+
+struct shape
+{
+    std::string name;
+    bool closed;
+    double area;
+    std::vector<point> points;
+    std::map<std::string, std::string> attributes;
+    std::vector<int> empty;
+};
+
+BOOST_DESCRIBE_STRUCT(shape, (), (name, closed, area, points, attributes, empty))
+
+struct record
+{
+    boost::optional<point> origin;
+    boost::optional<std::string> label;
+};
+
+BOOST_DESCRIBE_STRUCT(record, (), (origin, label))
+
+// converted to JSON by tag_invoke
+
+namespace app
+{
+
+struct pen
+{
+    int width;
+};
+
+static int pen_conversions = 0;
+
+void tag_invoke( boost::json::value_from_tag const&, boost::json::value& jv, pen const& p )
+{
+    ++pen_conversions;
+    jv = { { "width", p.width } };
+}
+
+// described, but with a conversion of its own that takes precedence
+
+struct size
+{
+    int w;
+    int h;
+};
+
+BOOST_DESCRIBE_STRUCT(size, (), (w, h))
+
+void tag_invoke( boost::json::value_from_tag const&, boost::json::value& jv, size const& s )
+{
+    jv = { { "area", s.w * s.h } };
+}
+
+} // namespace app
+
+struct drawing
+{
+    std::string name;
+    app::pen pen;
+    std::vector<app::pen> pens;
+    app::size size;
+};
+
+BOOST_DESCRIBE_STRUCT(drawing, (), (name, pen, pens, size))
+
+// renders data directly and after conversion to JSON
+
+static void test( char const* tmpl, shape const& data, boost::json::object const& partials = {} )
+{
+    std::string r1;
+    boost::mustache::render( tmpl, r1, data, partials );
+
+    std::string r2;
+    boost::mustache::render( tmpl, r2, boost::json::value_from( data ), partials );
+
+    BOOST_TEST_EQ( r1, r2 );
+
+    std::string r3;
+    boost::mustache::render( boost::mustache::compiled_template( tmpl ), r3, data, partials );
+
+    BOOST_TEST_EQ( r3, r2 );
+}
+
+static std::string render( char const* tmpl, record const& data )
+{
+    std::string r;
+    boost::mustache::render( tmpl, r, data, {} );
+    return r;
+}
+
+static std::string render( char const* tmpl, drawing const& data )
+{
+    std::string r;
+    boost::mustache::render( tmpl, r, data, {} );
+    return r;
+}
+
+static std::string render_compiled( char const* tmpl, drawing const& data )
+{
+    std::string r;
+    boost::mustache::render( boost::mustache::compiled_template( tmpl ), r, data, {} );
+    return r;
+}
+
+int main()
+{
+    shape s = { "<triangle>", true, 0.5, { { 0, 0 }, { 1, 0 }, { 0, 1 } }, { { "color", "red" }, { "note", "\"<a&b>\"\n\t\\" } }, {} };
+
+    test( "{{name}} {{&name}} {{closed}} {{area}} {{missing}}", s );
+    test( "{{#points}}({{x}}, {{y}}){{/points}}", s );
+    test( "{{#points}}{{name}}{{/points}}", s );
+    test( "{{attributes.color}} {{#attributes}}{{color}}{{/attributes}} {{attributes.size}}", s );
+    test( "{{#empty}}x{{/empty}}{{^empty}}none{{/empty}} {{^closed}}open{{/closed}}", s );
+    test( "{{points}} {{empty}}", s );
+    test( "{{attributes}} {{{attributes}}}", s );
+    test( "{{#points}}{{>p}}{{/points}}", s, { { "p", "[{{x}}]" } } );
+
+    {
+        record r1 = { point{ 1, 2 }, std::string( "a" ) };
+        record r2 = {};
+
+        char const* tmpl = "{{#origin}}{{x}},{{y}}{{/origin}}{{^origin}}-{{/origin}} {{origin.x}} {{label}}";
+
+        BOOST_TEST_EQ( render( tmpl, r1 ), std::string( "1,2 1 a" ) );
+        BOOST_TEST_EQ( render( tmpl, r2 ), std::string( "-  " ) );
+    }
+
+    {
+        drawing d = { "d", { 250 }, { { 1 }, { 2 } }, { 3, 4 } };
+
+        char const* tmpl = "pen: {{pen.width}} / {{#pen}}{{width}}{{/pen}}";
+
+        BOOST_TEST_EQ( render( tmpl, d ), std::string( "pen: 250 / 250" ) );
+        BOOST_TEST_EQ( render_compiled( tmpl, d ), std::string( "pen: 250 / 250" ) );
+
+        tmpl = "{{#pens}}[{{width}} {{name}} {{pen.width}}]{{/pens}} {{size.area}} {{size.w}}{{#size}}{{area}}{{/size}} {{size}}";
+
+        BOOST_TEST_EQ( render( tmpl, d ), std::string( "[1 d 250][2 d 250] 12 12 {&quot;area&quot;:12}" ) );
+        BOOST_TEST_EQ( render_compiled( tmpl, d ), std::string( "[1 d 250][2 d 250] 12 12 {&quot;area&quot;:12}" ) );
+
+        std::string r;
+        boost::mustache::render( tmpl, r, boost::json::value_from( d ), {} );
+
+        BOOST_TEST_EQ( r, render( tmpl, d ) );
+    }
+
+    {
+        // a converted value is converted once per lookup, and the
+        // conversions made for an element are released with it
+
+        int const n = 10000;
+
+        drawing d = { "d", { 250 }, {}, { 3, 4 } };
+
+        for( int i = 0; i < n; ++i )
+        {
+            d.pens.push_back( { i } );
+        }
+
+        boost::mustache::compiled_template tmpl( "{{#pens}}{{#.}}{{width}}{{/.}}{{^.}}-{{/.}}{{pen.width}}{{#pen}}{{width}}{{/pen}},{{/pens}}" );
+
+        std::string expected;
+        boost::mustache::render( tmpl, expected, boost::json::value_from( d ), {} );
+
+        boost::json::object partials;
+
+        for( int k = 0; k < 2; ++k )
+        {
+            boost::mustache::render_stats st;
+            boost::mustache::renderer rd( boost::mustache::borrow, d, partials, &st );
+
+            app::pen_conversions = 0;
+
+            std::string r;
+
+            if( k == 0 )
+            {
+                rd.render( tmpl, r );
+            }
+            else
+            {
+                char buffer[ 256 ];
+
+                rd.start( tmpl );
+
+                while( !rd.done() )
+                {
+                    boost::core::string_view sv = rd.read( buffer, sizeof( buffer ) );
+                    r.append( sv.data(), sv.size() );
+                }
+            }
+
+            BOOST_TEST( r == expected );
+
+            // each element, pen for the section on it, and pen.width,
+            // whose lookup is kept for all elements
+            BOOST_TEST_EQ( app::pen_conversions, 2 * n + 1 );
+
+            BOOST_TEST_LT( st.peak_bytes, 16384u );
+        }
+    }
+
+    {
+        // a converted root is converted once, until replaced
+
+        app::pen p{ 7 };
+        boost::json::object partials;
+
+        app::pen_conversions = 0;
+
+        boost::mustache::renderer rd( boost::mustache::borrow, p, partials );
+
+        std::string r;
+        rd.render( boost::mustache::compiled_template( "{{width}}{{#.}}{{width}}{{/.}}" ), r );
+
+        rd.reset();
+        rd.render_some( "|{{width}}", r );
+        rd.finish( r );
+
+        BOOST_TEST_EQ( r, std::string( "77|7" ) );
+        BOOST_TEST_EQ( app::pen_conversions, 1 );
+    }
+
+    return boost::report_errors();
+}
@@ -0,0 +1,271 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// Renders random well-formed templates from source, in chunks, and
+// compiled, and checks that the output is the same
+
+#include <boost/mustache/render.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace
+{
+
+struct delimiters
+{
+    char const* start;
+    char const* end;
+};
+
+delimiters const delims[] =
+{
+    { "{{", "}}" },
+    { "<%", "%>" },
+    { "[", "]" },
+    { "|", "|" },
+};
+
+char const* const names[] = { "a", "b", "c", ".", "o.b", "list", "e", "n", "missing" };
+char const* const section_names[] = { "a", "c", "o", "list", "e", "n", "missing", "." };
+
+class generator
+{
+private:
+
+    std::mt19937& rng_;
+    int first_partial_;
+
+    delimiters d_;
+
+public:
+
+    // a template may refer to the partials p<first> to p3
+
+    generator( std::mt19937& rng, int first ): rng_( rng ), first_partial_( first ), d_( delims[ 0 ] )
+    {
+    }
+
+    std::string generate()
+    {
+        std::string r;
+        append( r, 0 );
+        return r;
+    }
+
+private:
+
+    int random( int n )
+    {
+        return std::uniform_int_distribution<int>( 0, n - 1 )( rng_ );
+    }
+
+    std::string space()
+    {
+        return random( 3 ) == 0? ( random( 2 )? " ": "\t" ): "";
+    }
+
+    std::string tag( std::string const& contents )
+    {
+        return d_.start + space() + contents + space() + d_.end;
+    }
+
+    void append( std::string& r, int depth )
+    {
+        int n = random( 8 );
+
+        for( int i = 0; i < n; ++i )
+        {
+            append_one( r, depth );
+        }
+    }
+
+    void append_one( std::string& r, int depth )
+    {
+        switch( random( 13 ) )
+        {
+        case 0: r += "x"; break;
+        case 1: r += " "; break;
+        case 2: r += "\n"; break;
+        case 3: r += "\r\n"; break;
+        case 4: r += "  "; break;
+
+        case 5:
+
+            r += tag( names[ random( 9 ) ] );
+            break;
+
+        case 6:
+
+            if( d_.start == std::string( "{{" ) && random( 2 ) )
+            {
+                r += "{{{" + space() + names[ random( 9 ) ] + space() + "}}}";
+            }
+            else
+            {
+                r += tag( std::string( "&" ) + names[ random( 9 ) ] );
+            }
+
+            break;
+
+        case 7:
+
+            r += tag( "! comment " );
+            break;
+
+        case 8:
+        case 9:
+
+            if( depth < 3 )
+            {
+                std::string name = section_names[ random( 8 ) ];
+
+                r += tag( ( random( 3 ) == 0? "^": "#" ) + name );
+                append( r, depth + 1 );
+                r += tag( "/" + name );
+            }
+
+            break;
+
+        case 10:
+
+            if( first_partial_ <= 3 )
+            {
+                r += tag( ">p" + std::to_string( first_partial_ + random( 4 - first_partial_ ) ) );
+            }
+
+            break;
+
+        case 11:
+        {
+            delimiters d = delims[ random( 4 ) ];
+
+            r += tag( std::string( "=" ) + d.start + " " + d.end + "=" );
+            d_ = d;
+
+            break;
+        }
+
+        case 12:
+
+            // a tag alone on its line
+            r += "\n" + space() + space();
+            append_one( r, depth );
+            r += random( 2 )? "\n": "\r\n";
+
+            break;
+        }
+    }
+};
+
+} // unnamed namespace
+
+static void test( char const* tmpl, boost::json::value const& data, boost::json::object const& partials, char const* expected )
+{
+    std::string r1;
+    boost::mustache::render( tmpl, r1, data, partials );
+
+    BOOST_TEST_EQ( r1, std::string( expected ) );
+
+    std::string r2;
+    boost::mustache::render( boost::mustache::compiled_template( tmpl ), r2, data, partials );
+
+    BOOST_TEST_EQ( r2, std::string( expected ) );
+}
+
+int main()
+{
+    // a line ending at the end of a partial doesn't make the tag
+    // that follows standalone
+
+    {
+        boost::json::object partials = { { "p", "x\n" } };
+
+        test( "{{>p}}{{>p}}\n", {}, partials, "x\nx\n\n" );
+        test( "{{>p}}  {{!c}}\nY", {}, partials, "x\n  \nY" );
+        test( "{{>p}}\n{{>p}}\n", {}, partials, "x\nx\n" );
+    }
+
+    // delimiters changed in the contents of a section
+
+    {
+        boost::json::value data = { { "a", true }, { "b", 1 } };
+
+        test( "{{#a}}{{=<% %>=}}<%b%><%/a%>", data, {}, "1" );
+        test( "{{#a}}{{=<% %>=}}<%b%><%/a%>|<%b%>{{b}}", data, {}, "1|1{{b}}" );
+        test( "{{^a}}{{=<% %>=}}<%/a%><%b%>", data, {}, "1" );
+    }
+
+    boost::json::value data =
+    {
+        { "a", "A&" },
+        { "b", 1 },
+        { "c", true },
+        { "o", { { "b", "<ob>" } } },
+        { "list", { { { "a", "x" } }, { { "a", "y" }, { "c", false } }, 3 } },
+        { "e", boost::json::array() },
+        { "n", nullptr },
+    };
+
+    std::mt19937 rng( 5489 );
+
+    int differences = 0;
+
+    for( int i = 0; i < 30000; ++i )
+    {
+        // p3 refers to no partials, p2 to p3, p1 to both
+
+        boost::json::object partials;
+
+        for( int j = 1; j <= 3; ++j )
+        {
+            partials[ "p" + std::to_string( j ) ] = generator( rng, j + 1 ).generate();
+        }
+
+        std::string tmpl = generator( rng, 1 ).generate();
+
+        std::string expected;
+        boost::mustache::render( boost::mustache::compiled_template( tmpl ), expected, data, partials );
+
+        // from source, in random chunks
+
+        std::string r1;
+
+        {
+            boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+
+            for( std::size_t k = 0; k < tmpl.size(); )
+            {
+                std::size_t m = std::uniform_int_distribution<std::size_t>( 1, 8 )( rng );
+                rd.render_some( boost::core::string_view( tmpl ).substr( k, m ), r1 );
+
+                k += m;
+            }
+
+            rd.finish( r1 );
+        }
+
+        std::string r2;
+        boost::mustache::render( tmpl, r2, data, partials );
+
+        // from source, with the partials in a registry
+
+        std::string r3;
+        boost::mustache::render( tmpl, r3, data, boost::mustache::partial_registry( partials ) );
+
+        if( r1 != expected || r2 != expected || r3 != expected )
+        {
+            if( ++differences <= 10 )
+            {
+                boost::json::value v = { { "template", tmpl }, { "partials", partials }, { "compiled", expected }, { "source", r2 }, { "chunks", r1 }, { "registry", r3 } };
+                std::cerr << v << std::endl;
+            }
+        }
+    }
+
+    BOOST_TEST_EQ( differences, 0 );
+
+    return boost::report_errors();
+}
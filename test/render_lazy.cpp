@@ -0,0 +1,266 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/render.hpp>
+#include <boost/mustache/renderer.hpp>
+#include <boost/mustache/render_stats.hpp>
+#include <boost/mustache/lazy_range.hpp>
+#include <boost/describe.hpp>
+#include <boost/optional.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <iterator>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <string>
+
+// counts the rows in existence
+
+static std::size_t live_rows = 0;
+static std::size_t max_live_rows = 0;
+
+struct row
+{
+    int id;
+    std::string name;
+
+    row( int id, std::string name ): id( id ), name( std::move( name ) )
+    {
+        if( ++live_rows > max_live_rows )
+        {
+            max_live_rows = live_rows;
+        }
+    }
+
+    row( row const& r ): row( r.id, r.name )
+    {
+    }
+
+    row& operator=( row const& r ) = default;
+
+    ~row()
+    {
+        --live_rows;
+    }
+};
+
+BOOST_DESCRIBE_STRUCT(row, (), (id, name))
+
+// a synthetic cursor, producing n rows
+
+struct row_source
+{
+    int i;
+    int n;
+
+    boost::optional<row> operator()()
+    {
+        if( i == n )
+        {
+            return boost::none;
+        }
+
+        int k = i++;
+        return row( k, "<row " + std::to_string( k ) + ">" );
+    }
+};
+
+using row_range = decltype( boost::mustache::make_lazy_range( row_source() ) );
+
+struct page
+{
+    std::string title;
+    row_range rows;
+};
+
+BOOST_DESCRIBE_STRUCT(page, (), (title, rows))
+
+struct materialized_page
+{
+    std::string title;
+    std::vector<row> rows;
+};
+
+BOOST_DESCRIBE_STRUCT(materialized_page, (), (title, rows))
+
+// counts the output, without keeping it
+
+struct counting_output
+{
+    using value_type = char;
+
+    std::size_t size = 0;
+    std::size_t lines = 0;
+
+    void append( char const* first, char const* last )
+    {
+        size += last - first;
+
+        for( ; first != last; ++first )
+        {
+            lines += *first == '\n';
+        }
+    }
+};
+
+static page make_page( int n )
+{
+    return { "Rows", boost::mustache::make_lazy_range( row_source{ 0, n } ) };
+}
+
+static materialized_page make_materialized_page( int n )
+{
+    materialized_page r{ "Rows", {} };
+
+    row_source src{ 0, n };
+
+    while( boost::optional<row> x = src() )
+    {
+        r.rows.push_back( *x );
+    }
+
+    return r;
+}
+
+int main()
+{
+    char const* tmpl =
+
+        "<h1>{{title}}</h1>\n"
+        "{{#rows}}\n"
+        "<tr id=\"{{id}}\"><td>{{name}}</td><td>{{title}}</td></tr>\n"
+        "{{/rows}}\n"
+        "{{^rows}}\n"
+        "none\n"
+        "{{/rows}}\n";
+
+    boost::json::object partials;
+
+    for( int n: { 0, 1, 1000 } )
+    {
+        // the same output as a materialized list
+
+        std::string expected;
+        boost::mustache::render( tmpl, expected, make_materialized_page( n ), partials );
+
+        BOOST_TEST_EQ( expected.find( "none" ) == std::string::npos, n != 0 );
+
+        {
+            std::string r;
+            boost::mustache::render( tmpl, r, make_page( n ), partials );
+
+            BOOST_TEST_EQ( r, expected );
+        }
+
+        {
+            std::string r;
+            boost::mustache::render( boost::mustache::compiled_template( tmpl ), r, make_page( n ), partials );
+
+            BOOST_TEST_EQ( r, expected );
+        }
+    }
+
+    {
+        // a million rows, with one row in existence at a time
+
+        int const n = 1000000;
+
+        live_rows = max_live_rows = 0;
+
+        counting_output out;
+        boost::mustache::render( boost::mustache::compiled_template( tmpl ), out, make_page( n ), partials );
+
+        BOOST_TEST_EQ( out.lines, n + 1u );
+        BOOST_TEST_EQ( live_rows, 0u );
+        BOOST_TEST_LE( max_live_rows, 2u );
+    }
+
+    {
+        // read returns to the caller between the elements, keeping
+        // only what doesn't fit in the buffer
+
+        int const n = 100000;
+
+        boost::mustache::compiled_template ct( tmpl );
+
+        materialized_page mp = make_materialized_page( n );
+
+        std::string expected;
+        boost::mustache::render( ct, expected, mp, partials );
+
+        BOOST_TEST_GT( expected.size(), 4000000u );
+
+        std::vector<char> buf( 16384 );
+
+        for( int k = 0; k < 2; ++k )
+        {
+            page pg = make_page( n );
+
+            boost::mustache::render_stats st;
+            boost::mustache::renderer rd( boost::mustache::borrow, k == 0? boost::mustache::data_ref( mp ): boost::mustache::data_ref( pg ), partials, &st );
+
+            live_rows = max_live_rows = 0;
+
+            std::string r;
+
+            rd.start( ct );
+
+            while( !rd.done() )
+            {
+                boost::core::string_view sv = rd.read( buf.data(), buf.size() );
+                r.append( sv.data(), sv.size() );
+            }
+
+            BOOST_TEST( r == expected );
+            BOOST_TEST_LT( st.peak_bytes, 4096u );
+
+            if( k == 1 )
+            {
+                BOOST_TEST_LE( max_live_rows, 2u );
+            }
+        }
+    }
+
+    {
+        // a single-pass input range
+
+        std::istringstream is( "1 2 3 5 8" );
+
+        auto nums = boost::mustache::make_lazy_range( std::istream_iterator<int>( is ), std::istream_iterator<int>() );
+
+        std::map<std::string, decltype( nums )> data = { { "nums", nums } };
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+
+        std::string r;
+
+        rd.render_some( "{{#nums}}{{.}},{{/nums}}{{^nums}}none{{/nums}}", r );
+        rd.finish( r );
+
+        BOOST_TEST_EQ( r, std::string( "1,2,3,5,8," ) );
+    }
+
+    {
+        // testing a range doesn't consume it
+
+        auto r = boost::mustache::make_lazy_range( row_source{ 0, 2 } );
+
+        BOOST_TEST( !r.empty() );
+        BOOST_TEST( !r.empty() );
+
+        int k = 0;
+
+        for( row const& x: r )
+        {
+            BOOST_TEST_EQ( x.id, k );
+            ++k;
+        }
+
+        BOOST_TEST_EQ( k, 2 );
+        BOOST_TEST( !r.empty() );
+        BOOST_TEST( r.begin() == r.end() );
+    }
+
+    return boost::report_errors();
+}
@@ -25,6 +25,19 @@ static void test( boost::core::string_view tmpl, boost::json::value const& data,
         }
     }
 
+    // compiled
+
+    {
+        std::string result;
+        boost::mustache::render( boost::mustache::compiled_template( tmpl ), result, data, partials );
+
+        if( result != expected )
+        {
+            std::cerr << "Test (compiled) failed: result '" << result << "', expected '" << expected << "'" << std::endl;
+            ++errors;
+        }
+    }
+
     // chunked
 
     for( std::size_t i = 1; i <= 8; ++i )
@@ -58,5 +71,18 @@ int main()
 
     test( "This is a text without tags.\n  Indented line.\n\n", {}, {}, "This is a text without tags.\n  Indented line.\n\n" );
 
+    // literals and indentation of varying length, crossing the block
+    // boundaries of the vectorized scanning functions
+
+    for( std::size_t n = 0; n <= 70; ++n )
+    {
+        std::string a( n, 'a' ), s( n, ' ' ), t( n, '\t' );
+
+        std::string tmpl = a + "{{x}}" + a + "\n" + s + "{{x}}\n" + t + "{{! c }}\n" + s + "\t" + a + "\n";
+        std::string expected = a + "1" + a + "\n" + s + "1\n" + s + "\t" + a + "\n";
+
+        test( tmpl, { { "x", 1 } }, {}, expected );
+    }
+
     return errors;
 }
@@ -0,0 +1,172 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/render.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+
+static std::string render( boost::json::value const& v )
+{
+    std::string r;
+    boost::mustache::render( "{{v}}", r, { { "v", v } }, {} );
+    return r;
+}
+
+static std::string sprintf_g( double v, int precision )
+{
+    char buffer[ 64 ];
+    std::snprintf( buffer, sizeof( buffer ), "%.*g", precision, v );
+    return buffer;
+}
+
+static bool round_trips( std::string const& s, double v )
+{
+    double w = std::strtod( s.c_str(), nullptr );
+    return std::memcmp( &v, &w, sizeof( v ) ) == 0;
+}
+
+static int significant_digits( std::string const& s )
+{
+    std::size_t i = s.find_first_of( "123456789" );
+    std::size_t j = s.find( 'e' );
+
+    if( i == std::string::npos || ( j != std::string::npos && i > j ) )
+    {
+        return 0;
+    }
+
+    std::string m = s.substr( i, j == std::string::npos? std::string::npos: j - i );
+
+    m.erase( std::remove( m.begin(), m.end(), '.' ), m.end() );
+
+    while( !m.empty() && m.back() == '0' )
+    {
+        m.pop_back();
+    }
+
+    return static_cast<int>( m.size() );
+}
+
+static void test_double( double v )
+{
+    std::string s = render( v );
+
+    // converts back to the same value
+
+    BOOST_TEST( round_trips( s, v ) );
+
+    if( v == 0 )
+    {
+        return;
+    }
+
+    // with the least number of digits
+
+    int n = 1;
+
+    while( n < 17 && !round_trips( sprintf_g( v, n ), v ) )
+    {
+        ++n;
+    }
+
+    BOOST_TEST_EQ( significant_digits( s ), n );
+
+    // and in the same format as "%.16g" when it's the shortest
+
+    std::string s2 = sprintf_g( v, 16 );
+
+    if( round_trips( s2, v ) && significant_digits( s2 ) == n )
+    {
+        BOOST_TEST_EQ( s, s2 );
+    }
+}
+
+int main()
+{
+    // integers
+
+    BOOST_TEST_EQ( render( 0 ), std::string( "0" ) );
+    BOOST_TEST_EQ( render( -1 ), std::string( "-1" ) );
+    BOOST_TEST_EQ( render( std::numeric_limits<std::int64_t>::min() ), std::string( "-9223372036854775808" ) );
+    BOOST_TEST_EQ( render( std::numeric_limits<std::int64_t>::max() ), std::string( "9223372036854775807" ) );
+    BOOST_TEST_EQ( render( std::numeric_limits<std::uint64_t>::max() ), std::string( "18446744073709551615" ) );
+
+    {
+        std::mt19937_64 rng( 1 );
+
+        for( int i = 0; i < 100000; ++i )
+        {
+            std::uint64_t v = rng() >> ( i % 64 );
+
+            BOOST_TEST_EQ( render( v ), std::to_string( v ) );
+            BOOST_TEST_EQ( render( static_cast<std::int64_t>( v ) ), std::to_string( static_cast<std::int64_t>( v ) ) );
+            BOOST_TEST_EQ( render( -static_cast<std::int64_t>( v >> 1 ) ), std::to_string( -static_cast<std::int64_t>( v >> 1 ) ) );
+        }
+    }
+
+    // doubles
+
+    BOOST_TEST_EQ( render( 0.0 ), std::string( "0" ) );
+    BOOST_TEST_EQ( render( -0.0 ), std::string( "-0" ) );
+    BOOST_TEST_EQ( render( 1.0 ), std::string( "1" ) );
+    BOOST_TEST_EQ( render( 0.1 ), std::string( "0.1" ) );
+    BOOST_TEST_EQ( render( 0.1 + 0.2 ), std::string( "0.30000000000000004" ) );
+    BOOST_TEST_EQ( render( 1e15 ), std::string( "1000000000000000" ) );
+    BOOST_TEST_EQ( render( 1e16 ), std::string( "1e+16" ) );
+    BOOST_TEST_EQ( render( 1e-4 ), std::string( "0.0001" ) );
+    BOOST_TEST_EQ( render( 1e-5 ), std::string( "1e-05" ) );
+    BOOST_TEST_EQ( render( 1.7e+308 ), std::string( "1.7e+308" ) );
+    BOOST_TEST_EQ( render( 5e-324 ), std::string( "5e-324" ) );
+    BOOST_TEST_EQ( render( std::numeric_limits<double>::max() ), std::string( "1.7976931348623157e+308" ) );
+    BOOST_TEST_EQ( render( std::numeric_limits<double>::min() ), std::string( "2.2250738585072014e-308" ) );
+
+    {
+        // random bit patterns, covering all exponents
+
+        std::mt19937_64 rng( 2 );
+
+        for( int i = 0; i < 200000; ++i )
+        {
+            std::uint64_t bits = rng();
+
+            double v;
+            std::memcpy( &v, &bits, sizeof( v ) );
+
+            if( v - v == 0 ) // finite
+            {
+                test_double( v );
+            }
+        }
+    }
+
+    {
+        // values with few digits, where the output format matters
+
+        std::mt19937_64 rng( 3 );
+
+        for( int i = 0; i < 100000; ++i )
+        {
+            int digits = static_cast<int>( rng() % 17 ) + 1;
+            int exponent = static_cast<int>( rng() % 50 ) - 25;
+
+            std::string s = std::to_string( rng() % 100000000000000000ull ).substr( 0, digits ) + "e" + std::to_string( exponent );
+
+            test_double( std::strtod( s.c_str(), nullptr ) );
+        }
+
+        for( int i = 0; i < 100000; ++i )
+        {
+            test_double( static_cast<double>( static_cast<std::int64_t>( rng() ) >> ( i % 64 ) ) );
+        }
+    }
+
+    return boost::report_errors();
+}
@@ -0,0 +1,254 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/renderer.hpp>
+#include <boost/mustache/thread_pool.hpp>
+#include <boost/mustache/render_stats.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <new>
+
+// fails the allocations of the threads other than main_thread while set
+
+static std::atomic<bool> fail_other_threads( false );
+static std::thread::id main_thread;
+
+void* operator new( std::size_t n )
+{
+    if( fail_other_threads.load() && std::this_thread::get_id() != main_thread )
+    {
+        throw std::bad_alloc();
+    }
+
+    if( void* p = std::malloc( n? n: 1 ) )
+    {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete( void* p ) noexcept
+{
+    std::free( p );
+}
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+    std::free( p );
+}
+
+static std::string render( boost::core::string_view tmpl, boost::json::value const& data, boost::json::object const& partials, boost::mustache::thread_pool* tp, std::size_t chunk, boost::mustache::render_stats* st = nullptr )
+{
+    std::string r;
+
+    boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+
+    rd.set_thread_pool( tp, chunk );
+    rd.set_stats( st );
+
+    rd.render( boost::mustache::compiled_template( tmpl ), r );
+
+    return r;
+}
+
+static std::string render_source( boost::core::string_view tmpl, boost::json::value const& data, boost::json::object const& partials, boost::mustache::thread_pool* tp, std::size_t chunk )
+{
+    std::string r;
+
+    boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+
+    rd.set_thread_pool( tp, chunk );
+
+    rd.render_some( tmpl, r );
+    rd.finish( r );
+
+    return r;
+}
+
+// throws after a number of writes
+
+struct throwing_output
+{
+    using value_type = char;
+
+    std::size_t n;
+
+    void append( char const* /*first*/, char const* /*last*/ )
+    {
+        if( n-- == 0 )
+        {
+            throw std::runtime_error( "output" );
+        }
+    }
+};
+
+int main()
+{
+    // rows of uneven size, referring to names in the enclosing contexts
+
+    boost::json::array rows;
+
+    for( int i = 0; i < 1000; ++i )
+    {
+        boost::json::array cols;
+
+        for( int j = 0; j < i % 17; ++j )
+        {
+            cols.push_back( i * j );
+        }
+
+        boost::json::object row = { { "id", i }, { "cols", std::move( cols ) } };
+
+        if( i % 5 == 0 )
+        {
+            row[ "title" ] = "row " + std::to_string( i );
+        }
+
+        rows.push_back( std::move( row ) );
+    }
+
+    boost::json::value data = { { "title", "<t>" }, { "rows", std::move( rows ) } };
+    boost::json::object partials = { { "cell", "<td>{{.}}</td>\n" } };
+
+    char const* tmpl =
+
+        "<table>\n"
+        "{{#rows}}\n"
+        "  <tr id=\"{{id}}\" title=\"{{title}}\">\n"
+        "    {{#cols}}\n"
+        "    {{>cell}}\n"
+        "    {{/cols}}\n"
+        "    {{^cols}}<td>none</td>{{/cols}}\n"
+        "  </tr>\n"
+        "{{/rows}}\n"
+        "</table>\n";
+
+    std::string expected = render( tmpl, data, partials, nullptr, 0 );
+
+    BOOST_TEST_GT( expected.size(), 1000u );
+
+    for( std::size_t threads: { 0, 1, 4 } )
+    {
+        boost::mustache::thread_pool tp( threads );
+
+        BOOST_TEST_EQ( tp.size(), threads );
+
+        for( std::size_t chunk: { 0, 1, 3, 64, 500, 1000 } )
+        {
+            BOOST_TEST( render( tmpl, data, partials, &tp, chunk ) == expected );
+            BOOST_TEST( render_source( tmpl, data, partials, &tp, chunk ) == expected );
+        }
+    }
+
+    {
+        // statistics
+
+        boost::mustache::render_stats st1;
+        render( tmpl, data, partials, nullptr, 0, &st1 );
+
+        boost::mustache::thread_pool tp( 3 );
+
+        boost::mustache::render_stats st2;
+        render( tmpl, data, partials, &tp, 7, &st2 );
+
+        BOOST_TEST_EQ( st2.bytes_emitted, st1.bytes_emitted );
+        BOOST_TEST_EQ( st2.escaped_bytes, st1.escaped_bytes );
+        BOOST_TEST_EQ( st2.interpolation_tags, st1.interpolation_tags );
+        BOOST_TEST_EQ( st2.section_tags, st1.section_tags );
+        BOOST_TEST_EQ( st2.partial_tags, st1.partial_tags );
+        BOOST_TEST_EQ( st2.lookup_misses, st1.lookup_misses );
+    }
+
+    {
+        // renderers sharing a pool
+
+        boost::mustache::thread_pool tp( 4 );
+
+        std::vector<std::string> results( 8 );
+        std::vector<std::thread> threads;
+
+        for( std::size_t i = 0; i < results.size(); ++i )
+        {
+            threads.emplace_back( [&, i]{ results[ i ] = render( tmpl, data, partials, &tp, 16 ); } );
+        }
+
+        for( auto& th: threads )
+        {
+            th.join();
+        }
+
+        for( auto const& r: results )
+        {
+            BOOST_TEST( r == expected );
+        }
+    }
+
+    {
+        // an exception from the output leaves the pool usable
+
+        boost::mustache::thread_pool tp( 4 );
+
+        for( std::size_t n: { 0, 1, 10, 100 } )
+        {
+            boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+            rd.set_thread_pool( &tp, 8 );
+
+            throwing_output out = { n };
+
+            BOOST_TEST_THROWS( rd.render( boost::mustache::compiled_template( tmpl ), out ), std::runtime_error );
+        }
+
+        BOOST_TEST( render( tmpl, data, partials, &tp, 8 ) == expected );
+    }
+
+    {
+        // a worker failing to set up its renderer fails the render; the
+        // calling thread may complete the section before any worker has
+        // started, so it's attempted a few times
+
+        boost::mustache::thread_pool tp( 4 );
+        boost::mustache::compiled_template ct( tmpl );
+
+        int failures = 0;
+
+        for( int i = 0; i < 20 && failures == 0; ++i )
+        {
+            boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+            rd.set_thread_pool( &tp, 8 );
+
+            std::string r;
+
+            main_thread = std::this_thread::get_id();
+            fail_other_threads.store( true );
+
+            try
+            {
+                rd.render( ct, r );
+            }
+            catch( std::bad_alloc const& )
+            {
+                ++failures;
+            }
+
+            fail_other_threads.store( false );
+
+            if( failures == 0 )
+            {
+                BOOST_TEST( r == expected );
+            }
+        }
+
+        BOOST_TEST_GT( failures, 0 );
+
+        BOOST_TEST( render( tmpl, data, partials, &tp, 8 ) == expected );
+    }
+
+    return boost::report_errors();
+}
@@ -0,0 +1,169 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/renderer.hpp>
+#include <boost/mustache/render_stats.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+static std::string render( boost::mustache::compiled_template const& ct, boost::mustache::data_ref data, boost::json::object const& partials )
+{
+    std::string r;
+
+    boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+    rd.render( ct, r );
+
+    return r;
+}
+
+static std::string read( boost::mustache::renderer& rd, boost::mustache::compiled_template const& ct, std::size_t n )
+{
+    std::string r;
+    std::vector<char> buf( n );
+
+    rd.start( ct );
+
+    while( !rd.done() )
+    {
+        boost::core::string_view sv = rd.read( buf.data(), n );
+
+        BOOST_TEST_LE( sv.size(), n );
+        BOOST_TEST( sv.data() == buf.data() );
+
+        r.append( sv.data(), sv.size() );
+    }
+
+    return r;
+}
+
+static void test( boost::core::string_view tmpl, boost::mustache::data_ref data, boost::json::object const& partials )
+{
+    boost::mustache::compiled_template ct( tmpl );
+
+    std::string expected = render( ct, data, partials );
+
+    boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+
+    for( std::size_t n: { 1, 2, 7, 64, 16384 } )
+    {
+        BOOST_TEST_EQ( read( rd, ct, n ), expected );
+
+        rd.reset( boost::mustache::borrow, data, partials );
+    }
+}
+
+int main()
+{
+    boost::json::value data =
+    {
+        { "title", "<t>" },
+        { "rows", { { { "id", 1 }, { "c", { "p", "q" } } }, { { "id", 2 }, { "c", boost::json::array() } }, { { "id", 3 }, { "c", { "r" } } } } },
+        { "person", { { "name", "Joe" } } },
+        { "flag", true },
+    };
+
+    boost::json::object partials =
+    {
+        { "cell", "[{{.}}]\n" },
+        { "row", "<{{id}}>\n{{#c}}\n  {{>cell}}\n{{/c}}\n" },
+        { "inline", "({{title}}|{{missing}})" },
+    };
+
+    char const* tmpl =
+
+        "<h1>{{title}}</h1>\n"
+        "{{#rows}}\n"
+        "  {{>row}}\n"
+        "  {{^c}}none{{/c}}\n"
+        "{{/rows}}\n"
+        "{{#person}}{{name}} {{title}}{{/person}}\n"
+        "{{#flag}}{{>inline}}{{/flag}}{{^flag}}no{{/flag}}\n"
+        "  {{#rows}}{{#c}}{{.}}{{/c}}{{/rows}}\n";
+
+    test( tmpl, data, partials );
+    test( "", data, partials );
+    test( "{{missing}}{{#missing}}x{{/missing}}{{>missing}}", data, partials );
+
+    {
+        // lists that aren't JSON
+
+        std::map<std::string, std::vector<std::string>> native = { { "rows", { "a", "<b>", "c" } } };
+
+        test( "{{#rows}}\n  {{>cell}}\n{{/rows}}\n{{^rows}}none{{/rows}}\n", native, partials );
+        test( "{{#rows}}{{#rows}}{{.}}{{/rows}}|{{/rows}}", native, partials );
+    }
+
+    {
+        // a list whose iterator returns its elements by value
+
+        std::map<std::string, std::vector<bool>> flags = { { "f", { true, false, true } }, { "e", {} } };
+
+        test( "{{#f}}{{.}},{{#.}}y{{/.}}{{/f}}{{#e}}x{{/e}}{{^e}}none{{/e}}", flags, partials );
+    }
+
+    {
+        // the memory used doesn't grow with the output
+
+        boost::json::array rows;
+
+        for( int i = 0; i < 20000; ++i )
+        {
+            rows.push_back( { { "id", i }, { "c", { i, i + 1 } } } );
+        }
+
+        boost::json::value big = { { "title", "<t>" }, { "rows", std::move( rows ) } };
+
+        boost::mustache::compiled_template ct( tmpl );
+
+        std::string expected = render( ct, big, partials );
+
+        BOOST_TEST_GT( expected.size(), 300000u );
+
+        boost::mustache::render_stats st;
+
+        boost::mustache::renderer rd( boost::mustache::borrow, big, partials, &st );
+        rd.set_stats( &st );
+
+        BOOST_TEST_EQ( read( rd, ct, 4096 ), expected );
+
+        BOOST_TEST_EQ( st.bytes_emitted, expected.size() );
+        BOOST_TEST_LT( st.peak_bytes, 4096u );
+    }
+
+    {
+        // a read abandoned in the middle of a section, or of a partial
+
+        boost::json::value data2 = { { "name", "root" }, { "items", { { { "name", "a" } }, { { "name", "b" } } } } };
+        boost::json::object partials2 = { { "p", "{{#items}}\n  [{{name}}]\n{{/items}}\n" } };
+
+        boost::mustache::compiled_template t1( "{{#items}}{{name}}{{#items}}x{{/items}}{{/items}}" );
+        boost::mustache::compiled_template t2( "{{name}}|{{#items}}{{name}}{{/items}}" );
+        boost::mustache::compiled_template t3( "  {{>p}}" );
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data2, partials2 );
+
+        for( boost::mustache::compiled_template const* t: { &t1, &t3 } )
+        {
+            for( std::size_t n: { 1, 2, 3, 5 } )
+            {
+                char buffer[ 8 ];
+
+                rd.start( *t );
+                rd.read( buffer, n );
+
+                BOOST_TEST_EQ( read( rd, t2, 4 ), std::string( "root|ab" ) );
+                BOOST_TEST_EQ( render( t2, data2, partials2 ), std::string( "root|ab" ) );
+
+                rd.start( *t );
+                rd.read( buffer, n );
+
+                BOOST_TEST_EQ( read( rd, t3, 3 ), std::string( "    [a]\n    [b]\n" ) );
+            }
+        }
+    }
+
+    return boost::report_errors();
+}
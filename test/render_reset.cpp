@@ -0,0 +1,233 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/renderer.hpp>
+#include <boost/json/memory_resource.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <string>
+#include <cstdlib>
+#include <new>
+
+// counts the allocations of the standard containers
+
+static std::size_t heap_allocations = 0;
+
+void* operator new( std::size_t n )
+{
+    ++heap_allocations;
+
+    if( void* p = std::malloc( n? n: 1 ) )
+    {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete( void* p ) noexcept
+{
+    std::free( p );
+}
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+    std::free( p );
+}
+
+// counts the allocations of the renderer storage
+
+class counting_resource: public boost::json::memory_resource
+{
+public:
+
+    std::size_t allocations = 0;
+
+private:
+
+    void* do_allocate( std::size_t n, std::size_t /*align*/ ) override
+    {
+        ++allocations;
+        return ::operator new( n );
+    }
+
+    void do_deallocate( void* p, std::size_t /*n*/, std::size_t /*align*/ ) override
+    {
+        ::operator delete( p );
+    }
+
+    bool do_is_equal( boost::json::memory_resource const& r ) const noexcept override
+    {
+        return this == &r;
+    }
+};
+
+static std::string render( boost::mustache::renderer& rd, boost::core::string_view tmpl )
+{
+    std::string r;
+
+    rd.render_some( tmpl, r );
+    rd.finish( r );
+
+    return r;
+}
+
+int main()
+{
+    boost::json::value data = { { "x", "<a>" }, { "list", { 1, 2 } }, { "rows", { { { "c", { "p", "q" } } }, { { "c", { "r" } } } } } };
+    boost::json::object partials = { { "p", "[{{.}}]\n" }, { "q", "({{x}})" } };
+
+    {
+        // the delimiters are restored
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+
+        BOOST_TEST_EQ( render( rd, "{{=<% %>=}}<%x%>" ), std::string( "&lt;a&gt;" ) );
+
+        rd.reset();
+
+        BOOST_TEST_EQ( render( rd, "{{x}}" ), std::string( "&lt;a&gt;" ) );
+    }
+
+    {
+        // an unfinished template is discarded
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+
+        std::string r;
+        rd.render_some( "{{#list}}{{.}}{{/li", r );
+
+        rd.reset();
+
+        BOOST_TEST_EQ( render( rd, "{{#list}}{{.}}{{/list}}" ), std::string( "12" ) );
+    }
+
+    {
+        // new data and partials
+
+        boost::mustache::renderer rd( data, partials );
+
+        BOOST_TEST_EQ( render( rd, "{{x}}{{>q}}" ), std::string( "&lt;a&gt;(&lt;a&gt;)" ) );
+
+        boost::json::value data2 = { { "x", 1 } };
+        boost::json::object partials2 = { { "q", "<{{x}}>" } };
+
+        rd.reset( boost::mustache::borrow, data2, partials2 );
+
+        BOOST_TEST_EQ( render( rd, "{{x}}{{>q}}" ), std::string( "1<1>" ) );
+
+        rd.reset( boost::json::value{ { "x", 2 } }, partials );
+
+        BOOST_TEST_EQ( render( rd, "{{x}}{{>q}}" ), std::string( "2(2)" ) );
+
+        rd.reset( boost::json::value{ { "x", 3 } }, partials2 );
+
+        boost::mustache::compiled_template ct( "{{x}}{{>q}}" );
+
+        std::string r;
+        rd.render( ct, r );
+
+        BOOST_TEST_EQ( r, std::string( "3<3>" ) );
+    }
+
+    {
+        // the same partials, modified in between
+
+        boost::json::object partials2 = { { "q", "<{{x}}>" }, { "r", "[{{x}}]" } };
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials2 );
+
+        boost::mustache::compiled_template ct( "{{>q}}{{>r}}" );
+
+        std::string r;
+        rd.render( ct, r );
+
+        BOOST_TEST_EQ( r, std::string( "<&lt;a&gt;>[&lt;a&gt;]" ) );
+
+        partials2[ "q" ] = "({{x}})";
+        partials2[ "r" ].as_string().assign( "{{x}}!" );
+
+        rd.reset( boost::mustache::borrow, data, partials2 );
+
+        r.clear();
+        rd.render( ct, r );
+
+        BOOST_TEST_EQ( r, std::string( "(&lt;a&gt;)&lt;a&gt;!" ) );
+
+        rd.reset( boost::mustache::borrow, data, partials2 );
+
+        BOOST_TEST_EQ( render( rd, "{{>q}}{{>r}}" ), std::string( "(&lt;a&gt;)&lt;a&gt;!" ) );
+    }
+
+    {
+        // steady-state renders don't allocate
+
+        char const* tmpl =
+
+            "{{#rows}}\n"
+            "  {{#c}}\n"
+            "  {{>p}}\n"
+            "  {{/c}}\n"
+            "{{/rows}}\n"
+            "{{^missing}}{{x}}{{/missing}}\n"
+            "                    {{>q}}\n"
+            "{{=<% %>=}}<%#list%><%.%><%/list%>\n";
+
+        char const* expected = "  [p]\n  [q]\n  [r]\n&lt;a&gt;\n                    (&lt;a&gt;)12\n";
+
+        boost::mustache::compiled_template ct( tmpl );
+
+        counting_resource mr;
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, partials, &mr );
+
+        std::string r;
+        r.reserve( 1024 );
+
+        for( int i = 0; i < 3; ++i )
+        {
+            std::size_t n1 = mr.allocations;
+            std::size_t n2 = heap_allocations;
+
+            for( std::size_t j = 1; j <= 8; ++j )
+            {
+                // from source, in chunks
+
+                r.clear();
+
+                boost::core::string_view in = tmpl;
+
+                while( !in.empty() )
+                {
+                    std::size_t m = j < in.size()? j: in.size();
+
+                    rd.render_some( { in.data(), m }, r );
+                    in.remove_prefix( m );
+                }
+
+                rd.finish( r );
+
+                BOOST_TEST( r == expected );
+
+                rd.reset();
+
+                // compiled
+
+                r.clear();
+                rd.render( ct, r );
+
+                BOOST_TEST( r == expected );
+
+                rd.reset( boost::mustache::borrow, data, partials );
+            }
+
+            if( i > 0 )
+            {
+                BOOST_TEST_EQ( mr.allocations, n1 );
+                BOOST_TEST_EQ( heap_allocations, n2 );
+            }
+        }
+    }
+
+    return boost::report_errors();
+}
@@ -0,0 +1,122 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/render.hpp>
+#include <boost/core/detail/lwt_unattended.hpp>
+#include <string>
+#include <iostream>
+#include <algorithm>
+
+int errors = 0;
+
+static void test( boost::core::string_view tmpl, boost::json::value const& data, boost::json::object const& partials, boost::core::string_view expected )
+{
+    // entire buffer
+
+    {
+        std::string result;
+        boost::mustache::render( tmpl, result, data, partials );
+
+        if( result != expected )
+        {
+            std::cerr << "Test failed: result '" << result << "', expected '" << expected << "'" << std::endl;
+            ++errors;
+        }
+    }
+
+    // compiled
+
+    {
+        std::string result;
+        boost::mustache::render( boost::mustache::compiled_template( tmpl ), result, data, partials );
+
+        if( result != expected )
+        {
+            std::cerr << "Test (compiled) failed: result '" << result << "', expected '" << expected << "'" << std::endl;
+            ++errors;
+        }
+    }
+
+    // chunked
+
+    for( std::size_t i = 1; i <= 8; ++i )
+    {
+        boost::mustache::renderer rd( data, partials );
+
+        boost::core::string_view in = tmpl;
+        std::string result;
+
+        while( !in.empty() )
+        {
+            std::size_t m = std::min( i, in.size() );
+
+            rd.render_some( { in.data(), m }, result );
+            in.remove_prefix( m );
+        }
+
+        rd.finish( result );
+
+        if( result != expected )
+        {
+            std::cerr << "Test (i=" << i << ") failed: result '" << result << "', expected '" << expected << "'" << std::endl;
+            ++errors;
+        }
+    }
+}
+
+int main()
+{
+    boost::core::detail::lwt_unattended();
+
+    // loops and nested loops
+
+    test(
+
+        "{{#rows}}<{{#cols}}{{.}}{{/cols}}>{{/rows}}",
+        { { "rows", { { { "cols", { 1, 2 } } }, { { "cols", { 3 } } }, { { "cols", boost::json::array() } } } } },
+        {},
+        "<12><3><>"
+    );
+
+    test(
+
+        "{{#rows}}\n  {{#cols}}\n  {{.}}\n  {{/cols}}\n{{/rows}}\n",
+        { { "rows", { { { "cols", { 1, 2 } } }, { { "cols", { 3 } } } } } },
+        {},
+        "  1\n  2\n  3\n"
+    );
+
+    // a potentially standalone tag followed by text
+
+    test(
+
+        "{{#a}}\n  {{#b}}x{{/b}}\n{{/a}}",
+        { { "a", true }, { "b", true } },
+        {},
+        "  x\n"
+    );
+
+    // a standalone partial in a section
+
+    test(
+
+        "{{#a}}\n  {{>p}}\n{{/a}}",
+        { { "a", { 1, 2 } } },
+        { { "p", "{{.}}\n" } },
+        "  1\n  2\n"
+    );
+
+    // names found in some elements and in the enclosing
+    // contexts for others
+
+    test(
+
+        "{{#a}}{{x}}{{y.z}}{{^x}}-{{x}}{{/x}}{{#b}}{{x}}{{/b}};{{/a}}",
+        { { "x", 0 }, { "y", { { "z", "Y" } } }, { "a", { { { "x", 1 } }, 2, { { "y", { { "z", "Z" } } } }, { { "x", false }, { "b", { 3, { { "x", 4 } } } } } } } },
+        {},
+        "1Y;0Y-0;0Z-0;falseY-falsefalse4;"
+    );
+
+    return errors;
+}
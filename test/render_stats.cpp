@@ -0,0 +1,175 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/render_stats.hpp>
+#include <boost/mustache/renderer.hpp>
+#include <boost/json/monotonic_resource.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <string>
+#include <cstdlib>
+#include <new>
+
+// counts the allocations that don't go through the storage
+
+static std::size_t heap_allocations = 0;
+
+void* operator new( std::size_t n )
+{
+    ++heap_allocations;
+
+    if( void* p = std::malloc( n? n: 1 ) )
+    {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete( void* p ) noexcept
+{
+    std::free( p );
+}
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+    std::free( p );
+}
+
+static std::string render( boost::core::string_view tmpl, boost::json::value const& data, boost::json::object const& partials, boost::mustache::render_stats& st )
+{
+    std::string r;
+
+    boost::mustache::renderer rd( boost::mustache::borrow, data, partials, &st );
+    rd.set_stats( &st );
+
+    rd.render_some( tmpl, r );
+    rd.finish( r );
+
+    return r;
+}
+
+static std::string render_compiled( boost::core::string_view tmpl, boost::json::value const& data, boost::json::object const& partials, boost::mustache::render_stats& st )
+{
+    std::string r;
+
+    boost::mustache::renderer rd( boost::mustache::borrow, data, partials, &st );
+    rd.set_stats( &st );
+
+    rd.render( boost::mustache::compiled_template( tmpl ), r );
+
+    return r;
+}
+
+int main()
+{
+    boost::json::value data = { { "x", "<a>" }, { "n", 5 }, { "list", { 1, 2, 3 } } };
+    boost::json::object partials = { { "p", "({{.}})" } };
+
+    {
+        boost::mustache::render_stats st;
+
+        std::string r = render( "{{! comment }}{{x}}{{{x}}}{{missing}}{{=<% %>=}}<%n%><%={{ }}=%>", data, partials, st );
+
+        BOOST_TEST_EQ( r, std::string( "&lt;a&gt;<a>5" ) );
+
+        BOOST_TEST_EQ( st.interpolation_tags, 4u );
+        BOOST_TEST_EQ( st.section_tags, 0u );
+        BOOST_TEST_EQ( st.partial_tags, 0u );
+        BOOST_TEST_EQ( st.comment_tags, 1u );
+        BOOST_TEST_EQ( st.delimiter_tags, 2u );
+        BOOST_TEST_EQ( st.lookup_misses, 1u );
+
+        BOOST_TEST_EQ( st.bytes_emitted, r.size() );
+        BOOST_TEST_EQ( st.escaped_bytes, 10u ); // "&lt;a&gt;", "", and "5"
+    }
+
+    {
+        // sections are counted once per evaluation; the tags
+        // in their contents once per element
+
+        char const* tmpl = "{{#list}}{{>p}}{{/list}}{{^missing}}{{n}}{{/missing}}";
+
+        boost::mustache::render_stats st1;
+        std::string r1 = render( tmpl, data, partials, st1 );
+
+        boost::mustache::render_stats st2;
+        std::string r2 = render_compiled( tmpl, data, partials, st2 );
+
+        BOOST_TEST_EQ( r1, std::string( "(1)(2)(3)5" ) );
+        BOOST_TEST_EQ( r2, r1 );
+
+        for( auto* st: { &st1, &st2 } )
+        {
+            BOOST_TEST_EQ( st->section_tags, 2u );
+            BOOST_TEST_EQ( st->partial_tags, 3u );
+            BOOST_TEST_EQ( st->interpolation_tags, 4u );
+            BOOST_TEST_EQ( st->lookup_misses, 1u );
+            BOOST_TEST_EQ( st->bytes_emitted, r1.size() );
+        }
+    }
+
+    {
+        // allocations through the storage
+
+        boost::mustache::render_stats st;
+
+        render( "{{#list}}{{.}}{{/list}}", data, partials, st );
+
+        BOOST_TEST_GT( st.allocations, 0u );
+        BOOST_TEST_GE( st.bytes_allocated, st.peak_bytes );
+        BOOST_TEST_GT( st.peak_bytes, 0u );
+
+        // everything has been freed
+
+        st.clear();
+
+        BOOST_TEST_EQ( st.allocations, 0u );
+        BOOST_TEST_EQ( st.peak_bytes, 0u );
+    }
+
+    {
+        // the contexts, the lookup cache, and the pull mode state are
+        // allocated through the storage as well, so that with an upstream
+        // that doesn't use the heap, rendering a compiled template doesn't
+
+        boost::json::value data2 = { { "x", 1 }, { "rows", { { { "c", { 1, 2 } } }, { { "c", { 3 } } } } } };
+        boost::mustache::compiled_template ct( "{{#rows}}{{#c}}{{#rows}}[{{.}}{{x}}]{{/rows}}{{/c}}{{/rows}}" );
+
+        unsigned char buffer[ 65536 ];
+        boost::json::monotonic_resource mr( buffer );
+
+        boost::mustache::render_stats st( &mr );
+
+        std::string r1, r2;
+
+        r1.reserve( 1024 );
+        r2.reserve( 1024 );
+
+        std::size_t n = heap_allocations;
+
+        {
+            boost::mustache::renderer rd( boost::mustache::borrow, data2, partials, &st );
+            rd.set_stats( &st );
+
+            rd.render( ct, r1 );
+
+            rd.start( ct );
+
+            while( !rd.done() )
+            {
+                char tmp[ 7 ];
+                boost::core::string_view sv = rd.read( tmp, sizeof( tmp ) );
+
+                r2.append( sv.data(), sv.size() );
+            }
+        }
+
+        BOOST_TEST_EQ( heap_allocations, n );
+
+        BOOST_TEST_GT( st.allocations, 0u );
+        BOOST_TEST_EQ( r1, r2 );
+    }
+
+    return boost::report_errors();
+}
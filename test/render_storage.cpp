@@ -0,0 +1,113 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/render.hpp>
+#include <boost/mustache/template_cache.hpp>
+#include <boost/json/monotonic_resource.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <string>
+#include <vector>
+#include <map>
+
+template<class T1, class T2> static void test( boost::core::string_view tmpl, T1 const& data, T2 const& partials, boost::core::string_view expected )
+{
+    boost::mustache::compiled_template ct( tmpl );
+
+    // the heap
+
+    {
+        std::string r1, r2;
+
+        boost::mustache::render( tmpl, r1, data, partials, boost::json::storage_ptr() );
+        boost::mustache::render( ct, r2, data, partials, boost::json::storage_ptr() );
+
+        BOOST_TEST_EQ( r1, expected );
+        BOOST_TEST_EQ( r2, expected );
+    }
+
+    // {} as the storage, the default storage_ptr
+
+    {
+        std::string r1, r2, r3, r4;
+
+        boost::mustache::render( tmpl, r1, data, partials, {} );
+        boost::mustache::render( ct, r2, data, partials, {} );
+
+        boost::mustache::template_cache cache;
+
+        boost::mustache::render( tmpl, r3, data, partials, cache, {} );
+        boost::mustache::render( tmpl, r4, data, partials, cache );
+
+        BOOST_TEST_EQ( r1, expected );
+        BOOST_TEST_EQ( r2, expected );
+        BOOST_TEST_EQ( r3, expected );
+        BOOST_TEST_EQ( r4, expected );
+    }
+
+    // the default monotonic storage
+
+    {
+        std::string r1, r2;
+
+        boost::mustache::render( tmpl, r1, data, partials );
+        boost::mustache::render( ct, r2, data, partials );
+
+        BOOST_TEST_EQ( r1, expected );
+        BOOST_TEST_EQ( r2, expected );
+    }
+
+    // a buffer too small for the render
+
+    {
+        std::string r1, r2;
+
+        boost::mustache::render( tmpl, r1, data, partials, boost::mustache::monotonic_storage<16>() );
+        boost::mustache::render( ct, r2, data, partials, boost::mustache::monotonic_storage<16>() );
+
+        BOOST_TEST_EQ( r1, expected );
+        BOOST_TEST_EQ( r2, expected );
+    }
+
+    // a user-supplied resource
+
+    {
+        boost::json::monotonic_resource mr;
+
+        std::string r1, r2;
+
+        boost::mustache::render( tmpl, r1, data, partials, &mr );
+        boost::mustache::render( ct, r2, data, partials, &mr );
+
+        BOOST_TEST_EQ( r1, expected );
+        BOOST_TEST_EQ( r2, expected );
+    }
+}
+
+int main()
+{
+    char const* tmpl = "{{#rows}}\n  {{>row}}\n{{/rows}}\n{{^rows}}none{{/rows}}";
+
+    // JSON, used in place
+
+    {
+        boost::json::value data = { { "rows", { { { "a", "1" }, { "b", "<2>" } }, { { "a", "3" }, { "b", "4" } } } } };
+        boost::json::object partials = { { "row", "{{a}}: {{b}}\n" } };
+
+        test( tmpl, data, partials, "  1: &lt;2&gt;\n  3: 4\n" );
+        test( tmpl, boost::json::value(), partials, "none" );
+    }
+
+    // standard containers, converted by value_from
+
+    {
+        using record = std::map<std::string, std::string>;
+
+        std::map<std::string, std::vector<record>> data = { { "rows", { { { "a", "1" }, { "b", "<2>" } }, { { "a", "3" }, { "b", "4" } } } } };
+        std::map<std::string, std::string> partials = { { "row", "{{a}}: {{b}}\n" } };
+
+        test( tmpl, data, partials, "  1: &lt;2&gt;\n  3: 4\n" );
+    }
+
+    return boost::report_errors();
+}
@@ -25,6 +25,19 @@ static void test( boost::core::string_view tmpl, boost::json::value const& data,
         }
     }
 
+    // compiled
+
+    {
+        std::string result;
+        boost::mustache::render( boost::mustache::compiled_template( tmpl ), result, data, partials );
+
+        if( result != expected )
+        {
+            std::cerr << "Test (compiled) failed: result '" << result << "', expected '" << expected << "'" << std::endl;
+            ++errors;
+        }
+    }
+
     // chunked
 
     for( std::size_t i = 1; i <= 8; ++i )
@@ -64,5 +77,28 @@ int main()
         "null: ''; false: 'false'; true: 'true'; int64: '-1048576'; uint64: '1048576'; double: '-1023.14159'; double2: '1.7e+38'; string: 'string'; array: '[1,2,3]'; object: '{\"x\":1,\"y\":2}'"
     );
 
+    // escaping, with a special character at every position of
+    // strings longer than the blocks of the vectorized scan
+
+    {
+        char const chars[] = "<>\"&";
+        char const* entities[] = { "&lt;", "&gt;", "&quot;", "&amp;" };
+
+        for( std::size_t n = 1; n <= 70; ++n )
+        {
+            for( std::size_t k = 0; k < n; ++k )
+            {
+                std::size_t i = ( n + k ) % 4;
+
+                std::string s( n, 'x' );
+                s[ k ] = chars[ i ];
+
+                std::string expected = std::string( k, 'x' ) + entities[ i ] + std::string( n - k - 1, 'x' );
+
+                test( "{{s}}|{{{s}}}", { { "s", s } }, {}, expected + "|" + s );
+            }
+        }
+    }
+
     return errors;
 }
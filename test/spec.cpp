@@ -50,6 +50,61 @@ int main( int ac, char const* av[] )
                 std::cerr << "Test '" << name.subview() << "' failed: result '" << result << "', expected '" << expected.subview() << "'" << std::endl;
                 ++errors;
             }
+
+            result.clear();
+            boost::mustache::render( boost::mustache::compiled_template( template_ ), result, data, partials );
+
+            if( result != expected )
+            {
+                std::cerr << "Test '" << name.subview() << "' (compiled) failed: result '" << result << "', expected '" << expected.subview() << "'" << std::endl;
+                ++errors;
+            }
+
+            {
+                boost::mustache::partial_registry registry( partials );
+
+                result.clear();
+                boost::mustache::render( template_, result, data, registry );
+
+                if( result != expected )
+                {
+                    std::cerr << "Test '" << name.subview() << "' (registry) failed: result '" << result << "', expected '" << expected.subview() << "'" << std::endl;
+                    ++errors;
+                }
+
+                boost::mustache::compiled_template ct( template_ );
+                registry.link( ct );
+
+                result.clear();
+                boost::mustache::render( ct, result, data, registry );
+
+                if( result != expected )
+                {
+                    std::cerr << "Test '" << name.subview() << "' (compiled, registry) failed: result '" << result << "', expected '" << expected.subview() << "'" << std::endl;
+                    ++errors;
+                }
+            }
+
+            result.clear();
+
+            {
+                boost::mustache::compiled_template ct( template_ );
+                boost::mustache::renderer rd( boost::mustache::borrow, data, partials );
+
+                rd.start( ct );
+
+                while( !rd.done() )
+                {
+                    char buffer[ 3 ];
+                    result += rd.read( buffer, sizeof( buffer ) );
+                }
+            }
+
+            if( result != expected )
+            {
+                std::cerr << "Test '" << name.subview() << "' (read) failed: result '" << result << "', expected '" << expected.subview() << "'" << std::endl;
+                ++errors;
+            }
         }
 
         return errors;
@@ -0,0 +1,90 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// compares the templates of a spec file, translated to C++ by
+// boost_mustache_codegen --spec, against the runtime renderer
+
+#include <boost/mustache/render.hpp>
+#include <boost/json.hpp>
+#include <boost/core/detail/lwt_unattended.hpp>
+#include <iostream>
+#include <fstream>
+
+namespace spec_generated
+{
+
+std::size_t test_count();
+void render_test( std::size_t i, boost::mustache::output_ref out, boost::mustache::data_ref data );
+
+} // namespace spec_generated
+
+int main( int ac, char const* av[] )
+{
+    boost::core::detail::lwt_unattended();
+
+    if( ac < 2 )
+    {
+        std::cerr << "Usage: spec_codegen <spec.json>" << std::endl;
+        return -1;
+    }
+
+    int errors = 0;
+
+    try
+    {
+        std::ifstream is( av[1] );
+
+        boost::json::value spec = boost::json::parse( is );
+
+        auto tests = spec.at( "tests" ).as_array();
+
+        if( tests.size() != spec_generated::test_count() )
+        {
+            std::cerr << "The generated code has " << spec_generated::test_count() << " tests, the spec file " << tests.size() << std::endl;
+            return -1;
+        }
+
+        for( std::size_t i = 0; i < tests.size(); ++i )
+        {
+            auto const& test = tests[ i ];
+
+            auto name = test.at( "name" ).as_string();
+            auto data = test.at( "data" );
+            auto template_ = test.at( "template" ).as_string();
+            auto expected = test.at( "expected" ).as_string();
+
+            boost::json::object partials;
+
+            if( test.as_object().contains( "partials" ) )
+            {
+                partials = test.at( "partials" ).as_object();
+            }
+
+            std::string r1;
+            boost::mustache::render( template_, r1, data, partials );
+
+            std::string r2;
+            spec_generated::render_test( i, r2, data );
+
+            if( r2 != r1 )
+            {
+                std::cerr << "Test '" << name.subview() << "' failed: generated '" << r2 << "', runtime '" << r1 << "'" << std::endl;
+                ++errors;
+            }
+
+            if( r2 != expected )
+            {
+                std::cerr << "Test '" << name.subview() << "' failed: generated '" << r2 << "', expected '" << expected.subview() << "'" << std::endl;
+                ++errors;
+            }
+        }
+
+        return errors;
+    }
+    catch( std::exception const& x )
+    {
+        std::cerr << "Exception: " << x.what() << std::endl;
+        return -1;
+    }
+}
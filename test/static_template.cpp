@@ -0,0 +1,185 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/static_template.hpp>
+#include <boost/mustache/render.hpp>
+#include <boost/describe.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <vector>
+#include <string>
+
+// the templates of example/html.cpp
+
+struct item
+{
+    std::string title;
+    std::string author;
+    std::string link;
+};
+
+BOOST_DESCRIBE_STRUCT(item, (), (title, author, link))
+
+struct reference
+{
+    std::string heading;
+    std::vector<item> items;
+};
+
+BOOST_DESCRIBE_STRUCT(reference, (), (heading, items))
+
+constexpr char header[] =
+
+R"(<html>
+<head>
+  <title>{{heading}}</title>
+</head>
+<body>
+)";
+
+constexpr char footer[] =
+
+R"(</body>
+</html>
+)";
+
+constexpr char item_[] =
+
+R"(<li>
+  <strong>{{title}}</strong><br>
+  <em>{{author}}</em><br>
+  <a href="{{link}}">{{link}}</a>
+</li>
+)";
+
+constexpr char body[] =
+
+R"(<h1>{{heading}}</h1>
+<ul>
+{{#items}}
+  {{>item}}
+{{/items}}
+</ul>
+)";
+
+constexpr char html[] =
+
+R"({{>header}}
+  {{>body}}
+{{>footer}}
+)";
+
+constexpr boost::mustache::static_partial html_partials[] =
+{
+    { "header", header },
+    { "footer", footer },
+    { "item", item_ },
+    { "body", body },
+};
+
+// other constructs
+
+constexpr char t1[] = "";
+constexpr char t2[] = "Hello, {{name}}!";
+constexpr char t3[] = "{{a.b.c}} {{&html}} {{{html}}} {{ html }} {{! comment }}|{{missing}}|";
+constexpr char t4[] = "{{#list}}({{.}}){{/list}}{{^list}}none{{/list}}\n";
+constexpr char t5[] = "{{#obj}}{{x}},{{name}}{{#inner}}[{{x}}]{{/inner}}{{/obj}}";
+constexpr char t6[] = "begin\n  {{#list}}\n  <{{.}}>\n  {{/list}}\n  {{! standalone }}\r\nend";
+constexpr char t7[] = "x {{>line}} y\n\t{{>lines}}\n  {{>nested}}\n  {{>missing}}\nz";
+constexpr char t8[] = "{{#a}}{{#b}}{{#c}}{{name}}{{/c}}{{/b}}{{/a}}{{^a.b.c}}!{{/a.b.c}}";
+constexpr char t9[] = "a { b }} {{name}}{ {{^empty}}}{{/empty}}";
+
+constexpr boost::mustache::static_partial partials[] =
+{
+    { "line", "<{{name}}>" },
+    { "lines", "1\n2 {{name}}\n3\n" },
+    { "nested", "[\n  {{>lines}}\n]\n" },
+};
+
+template<char const* Text, auto const& Partials> static void test( boost::json::value const& data )
+{
+    boost::json::object jp;
+
+    for( auto const& p: Partials )
+    {
+        jp[ p.name ] = p.text;
+    }
+
+    std::string r1;
+    boost::mustache::render( Text, r1, data, jp );
+
+    std::string r2;
+    boost::mustache::static_template<Text, Partials> tmpl;
+    render( tmpl, r2, data );
+
+    BOOST_TEST_EQ( r1, r2 );
+}
+
+template<char const* Text> static void test( boost::json::value const& data )
+{
+    test<Text, partials>( data );
+}
+
+int main()
+{
+    boost::json::value data =
+    {
+        { "name", "<World>" },
+        { "html", "<b>&\"'" },
+        { "a", { { "b", { { "c", 3.5 } } } } },
+        { "list", { 1, "two", nullptr, false } },
+        { "empty", boost::json::array() },
+        { "obj", { { "x", 1 }, { "inner", { { "x", 2 } } } } },
+    };
+
+    test<t1>( data );
+    test<t2>( data );
+    test<t3>( data );
+    test<t4>( data );
+    test<t5>( data );
+    test<t6>( data );
+    test<t7>( data );
+    test<t8>( data );
+    test<t9>( data );
+
+    boost::json::value data2 = { { "list", boost::json::array() }, { "a", false } };
+
+    test<t4>( data2 );
+    test<t6>( data2 );
+    test<t8>( data2 );
+
+    {
+        reference ref =
+        {
+            "Reference <&>",
+            {
+                { "Title 1", "Author 1", "https://example.com/1?a=1&b=2" },
+                { "Title 2", "Author 2", "https://example.com/2" },
+                { "Title 3", "Author 3", "https://example.com/3" },
+            }
+        };
+
+        test<html, html_partials>( boost::json::value_from( ref ) );
+
+        // described data, accessed in place
+
+        std::string r1;
+        boost::mustache::render( html, r1, boost::json::value_from( ref ), { { "header", header }, { "footer", footer }, { "item", item_ }, { "body", body } } );
+
+        std::string r2;
+        boost::mustache::static_template<html, html_partials>().render( r2, ref );
+
+        BOOST_TEST_EQ( r1, r2 );
+    }
+
+    {
+        // no partials
+
+        std::string r;
+        boost::mustache::static_template<t2>().render( r, data );
+
+        BOOST_TEST_EQ( r, "Hello, &lt;World&gt;!" );
+    }
+
+    return boost::report_errors();
+}
@@ -0,0 +1,16 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/static_template.hpp>
+#include <string>
+
+// a closing tag that doesn't match the open section is a compile error
+
+constexpr char tmpl[] = "{{#items}}<li>{{.}}</li>{{/item}}";
+
+int main()
+{
+    std::string r;
+    boost::mustache::static_template<tmpl>().render( r, 1 );
+}
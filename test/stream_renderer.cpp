@@ -0,0 +1,167 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/stream_renderer.hpp>
+#include <boost/mustache/render_stats.hpp>
+#include <boost/mustache/render.hpp>
+#include <boost/json/parse.hpp>
+#include <boost/json/serialize.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <stdexcept>
+#include <string>
+
+static std::string stream_render( boost::mustache::compiled_template const& ct, boost::core::string_view doc, boost::json::object const& partials, std::size_t n )
+{
+    std::string r;
+
+    boost::mustache::stream_renderer sr( ct, partials );
+
+    while( !doc.empty() )
+    {
+        std::size_t m = n < doc.size()? n: doc.size();
+
+        sr.write( doc.substr( 0, m ), r );
+        doc.remove_prefix( m );
+    }
+
+    sr.finish( r );
+
+    return r;
+}
+
+static void test( boost::core::string_view tmpl, boost::core::string_view doc, boost::json::object const& partials = {} )
+{
+    boost::mustache::compiled_template ct( tmpl );
+
+    std::string expected;
+    boost::mustache::render( ct, expected, boost::json::parse( doc ), partials );
+
+    for( std::size_t n: { 1, 2, 3, 7, 64, 100000 } )
+    {
+        BOOST_TEST_EQ( stream_render( ct, doc, partials, n ), expected );
+    }
+}
+
+int main()
+{
+    boost::json::object partials = { { "row", "<{{id}}|{{title}}>\n" } };
+
+    char const* tmpl =
+
+        "<h1>{{title}}</h1>\n"
+        "{{#rows}}\n"
+        "  {{>row}}\n"
+        "{{/rows}}\n"
+        "{{#footer}}{{text}}{{/footer}}\n";
+
+    // in document order
+
+    test( tmpl, R"({ "title": "T", "rows": [ { "id": 1 }, { "id": 2, "title": "<2>" }, { "id": 3 } ], "footer": { "text": "end" } })", partials );
+
+    // out of order
+
+    test( tmpl, R"({ "rows": [ { "id": 1 }, { "id": 2 } ], "title": "T", "footer": { "text": "end" } })", partials );
+    test( tmpl, R"({ "footer": { "text": "end" }, "rows": [ { "id": 1 }, { "id": 2 } ], "title": "T" })", partials );
+
+    // a name in the section found in the document only after it
+
+    test( tmpl, R"({ "title": "T", "rows": [ { "id": 1, "title": "1" }, { "id": 2 }, { "id": 3 } ], "footer": { "text": "end" }, "x": 1 })", partials );
+
+    // missing members
+
+    test( tmpl, R"({ "rows": [] })", partials );
+    test( tmpl, R"({})", partials );
+    test( tmpl, R"({ "rows": [ 1, [ 2 ], { "id": [ 3 ] } ] })", partials );
+
+    // lists referred to twice are kept
+
+    test( "{{#rows}}{{.}},{{/rows}}{{^rows}}none{{/rows}}", R"({ "rows": [ 1, 2, 3 ] })" );
+    test( "{{#rows}}{{.}},{{/rows}}{{^rows}}none{{/rows}}", R"({ "rows": [] })" );
+    test( "{{#rows}}{{.}},{{/rows}}{{rows.length}}{{#x}}{{rows}}{{/x}}", R"({ "rows": [ 1, 2, 3 ], "x": true })" );
+
+    // the root object itself, as "." outside of sections
+
+    test( "{{.}}", R"({ "a": 1, "b": 2 })" );
+    test( "{{a}}{{#.}}[{{b}}]{{/.}}", R"({ "a": 1, "b": 2 })" );
+    test( "{{#rows}}{{.}},{{/rows}}{{.}}", R"({ "rows": [ 1, 2, 3 ], "x": 1 })" );
+    test( "{{.}}{{#rows}}{{.}},{{/rows}}", R"({ "rows": [ 1, 2, 3 ], "x": 1 })" );
+    test( "{{#rows}}{{.}},{{/rows}}{{^x}}{{.}}{{/x}}", R"({ "rows": [ 1, 2, 3 ] })" );
+    test( "{{#rows}}{{.}},{{/rows}}{{>p}}", R"({ "rows": [ 1, 2, 3 ] })", { { "p", "({{.}})" } } );
+
+    // values and keys of every kind
+
+    test(
+        "{{a}}|{{b}}|{{c}}|{{d}}|{{e}}|{{& f}}|{{#g}}[{{.}}]{{/g}}|{{h.i}}|{{{k\\\"]}}}|{{#l}}{{m}}{{/l}}",
+        " \n{ \"a\" : -1.5e3 , \"b\":true,\"c\":null,\"d\":\"s\\\"]}[{\",\"e\":\"\\u00e9<>\",\"f\":\"<&>\","
+        "\"g\":[1,\"2\",[3],{\"x\":4},false,null,[]],\"h\":{\"i\":[{\"j\":\"]\"}]},\"k\\\\\\\"]\":0,\"l\":[{\"m\":1},{\"m\":2}]} \n" );
+
+    // documents that aren't objects
+
+    test( "{{#.}}{{.}},{{/.}}", "[ 1, 2, 3 ]" );
+    test( "{{.}}", " \"text\" " );
+    test( "{{.}}", "5" );
+
+    {
+        // the output is produced while the document is parsed,
+        // without keeping the elements
+
+        std::string doc = "{ \"title\": \"Rows\", \"rows\": [";
+
+        for( int i = 0; i < 20000; ++i )
+        {
+            if( i != 0 )
+            {
+                doc += ",";
+            }
+
+            doc += "{ \"id\": " + std::to_string( i ) + ", \"name\": \"row " + std::to_string( i ) + "\" }";
+        }
+
+        doc += "] }";
+
+        boost::mustache::compiled_template ct( "<h1>{{title}}</h1>\n{{#rows}}\n<tr id=\"{{id}}\">{{name}}</tr>\n{{/rows}}\n" );
+
+        std::string expected;
+        boost::mustache::render( ct, expected, boost::json::parse( doc ), boost::json::object() );
+
+        boost::mustache::render_stats st;
+
+        boost::json::object const no_partials;
+        boost::mustache::stream_renderer sr( ct, no_partials, &st );
+
+        std::string r;
+
+        boost::core::string_view in = doc;
+
+        while( in.size() > doc.size() / 2 )
+        {
+            sr.write( in.substr( 0, 4096 ), r );
+            in.remove_prefix( 4096 );
+        }
+
+        BOOST_TEST_GT( r.size(), expected.size() * 2 / 5 );
+
+        sr.write( in, r );
+        sr.finish( r );
+
+        BOOST_TEST( r == expected );
+        BOOST_TEST_LT( st.peak_bytes, 16384u );
+    }
+
+    {
+        // invalid documents
+
+        boost::mustache::compiled_template ct( "{{a}}" );
+
+        BOOST_TEST_THROWS( stream_render( ct, "{ \"a\" 1 }", {}, 1 ), std::exception );
+        BOOST_TEST_THROWS( stream_render( ct, "{ \"a\": 1", {}, 1 ), std::exception );
+        BOOST_TEST_THROWS( stream_render( ct, "{ \"a\": 1 } 2", {}, 1 ), std::exception );
+        BOOST_TEST_THROWS( stream_render( ct, "{ \"a\": [ 1 2 ] }", {}, 1 ), std::exception );
+        BOOST_TEST_THROWS( stream_render( ct, "{ 1: 2 }", {}, 1 ), std::exception );
+        BOOST_TEST_THROWS( stream_render( ct, "[ 1, 2", {}, 1 ), std::exception );
+        BOOST_TEST_THROWS( stream_render( ct, "", {}, 1 ), std::exception );
+    }
+
+    return boost::report_errors();
+}
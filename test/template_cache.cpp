@@ -0,0 +1,249 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/template_cache.hpp>
+#include <boost/mustache/render.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main()
+{
+    {
+        boost::mustache::template_cache cache;
+
+        auto p1 = cache.get( "Hello, {{name}}!" );
+        auto p2 = cache.get( "Hello, {{name}}!" );
+        auto p3 = cache.get( "Hello, {{name}}." );
+
+        BOOST_TEST_EQ( p1, p2 );
+        BOOST_TEST_NE( p1, p3 );
+
+        // the delimiters are part of the key
+
+        auto p4 = cache.get( "Hello, {{name}}!", "<%", "%>" );
+        auto p5 = cache.get( "Hello, {{name}}!", "<%", "%>" );
+
+        BOOST_TEST_NE( p1, p4 );
+        BOOST_TEST_EQ( p4, p5 );
+
+        boost::json::value data = { { "name", "<World>" } };
+
+        std::string r;
+
+        boost::mustache::render( *p1, r, data, boost::json::object() );
+        BOOST_TEST_EQ( r, "Hello, &lt;World&gt;!" );
+
+        r.clear();
+
+        boost::mustache::render( *p4, r, data, boost::json::object() );
+        BOOST_TEST_EQ( r, "Hello, {{name}}!" );
+
+        boost::mustache::template_cache_stats st = cache.stats();
+
+        BOOST_TEST_EQ( st.hits, 2u );
+        BOOST_TEST_EQ( st.misses, 3u );
+        BOOST_TEST_EQ( st.evictions, 0u );
+        BOOST_TEST_EQ( st.entries, 3u );
+        BOOST_TEST_GT( st.bytes, 0u );
+
+        cache.clear();
+
+        st = cache.stats();
+
+        BOOST_TEST_EQ( st.hits, 2u );
+        BOOST_TEST_EQ( st.misses, 3u );
+        BOOST_TEST_EQ( st.entries, 0u );
+        BOOST_TEST_EQ( st.bytes, 0u );
+
+        // still valid after having been removed
+
+        r.clear();
+
+        boost::mustache::render( *p1, r, data, boost::json::object() );
+        BOOST_TEST_EQ( r, "Hello, &lt;World&gt;!" );
+
+        BOOST_TEST_NE( cache.get( "Hello, {{name}}!" ), p1 );
+    }
+
+    {
+        // eviction, least recently used first
+
+        boost::mustache::template_cache cache( 4096, 1 );
+
+        std::vector<std::string> templates;
+
+        for( int i = 0; i < 100; ++i )
+        {
+            templates.push_back( "{{#items}}<li>{{name}}</li>{{/items}} " + std::to_string( i ) );
+        }
+
+        auto p0 = cache.get( templates[ 0 ] );
+
+        std::size_t n = 1;
+
+        for( ; cache.stats().evictions == 0; ++n )
+        {
+            // keeps templates[ 0 ] the most recently used
+            BOOST_TEST_EQ( cache.get( templates[ 0 ] ), p0 );
+
+            cache.get( templates[ n ] );
+        }
+
+        boost::mustache::template_cache_stats st = cache.stats();
+
+        BOOST_TEST_LE( st.bytes, 4096u );
+        BOOST_TEST_EQ( st.evictions, 1u );
+        BOOST_TEST_EQ( st.entries, n - 1 );
+
+        // templates[ 1 ] was evicted, templates[ 0 ] wasn't
+
+        BOOST_TEST_EQ( cache.get( templates[ 0 ] ), p0 );
+
+        std::size_t misses = cache.stats().misses;
+
+        cache.get( templates[ 1 ] );
+        BOOST_TEST_EQ( cache.stats().misses, misses + 1 );
+
+        // a template larger than the cache isn't kept
+
+        std::string large( 8192, 'x' );
+
+        auto p1 = cache.get( large );
+        auto p2 = cache.get( large );
+
+        BOOST_TEST_NE( p1, p2 );
+        BOOST_TEST_LE( cache.stats().bytes, 4096u );
+    }
+
+    {
+        // through render
+
+        boost::mustache::template_cache cache;
+
+        boost::json::value data = { { "items", { { { "name", "a" } }, { { "name", "b" } } } } };
+        boost::json::object partials = { { "item", "<li>{{name}}</li>" } };
+
+        for( int i = 0; i < 3; ++i )
+        {
+            std::string r;
+            boost::mustache::render( "<ul>{{#items}}{{>item}}{{/items}}</ul>", r, data, partials, cache );
+
+            BOOST_TEST_EQ( r, "<ul><li>a</li><li>b</li></ul>" );
+        }
+
+        boost::mustache::partial_registry registry( partials );
+
+        {
+            std::string r;
+            boost::mustache::render( "<ul>{{#items}}{{>item}}{{/items}}</ul>", r, data, registry, cache );
+
+            BOOST_TEST_EQ( r, "<ul><li>a</li><li>b</li></ul>" );
+        }
+
+        {
+            std::string r;
+            boost::mustache::render( "{{x}}", r, boost::json::value{ { "x", 1 } }, boost::json::object(), cache, boost::json::storage_ptr() );
+
+            BOOST_TEST_EQ( r, "1" );
+        }
+
+        boost::mustache::template_cache_stats st = cache.stats();
+
+        BOOST_TEST_EQ( st.hits, 3u );
+        BOOST_TEST_EQ( st.misses, 2u );
+        BOOST_TEST_EQ( st.entries, 2u );
+    }
+
+    {
+        // the same output as rendering without the cache
+
+        boost::mustache::template_cache cache;
+
+        boost::json::value data = { { "a", true }, { "b", 1 }, { "items", { { { "name", "a" } }, { { "name", "b" } } } } };
+        boost::json::object partials = { { "p", "x\n" }, { "item", "<li>\n  {{name}}\n</li>\n" } };
+
+        boost::mustache::partial_registry registry( partials );
+
+        char const* templates[] =
+        {
+            "{{>p}}{{>p}}\n",
+            "{{>p}}  {{!c}}\nY",
+            "{{>p}}\n{{>p}}\n",
+            "{{#a}}{{=<% %>=}}<%b%><%/a%>|<%b%>",
+            "<ul>\n  {{#items}}\n  {{>item}}\n  {{/items}}\n</ul>\n",
+            "  {{>item}}  \r\n{{#items}}{{>p}}{{/items}}",
+            "{{^a}}\n{{/a}}\n\t{{! comment }}\n{{b}}",
+        };
+
+        for( char const* tmpl: templates )
+        {
+            std::string r1, r2;
+
+            boost::mustache::render( tmpl, r1, data, partials );
+            boost::mustache::render( tmpl, r2, data, partials, cache );
+
+            BOOST_TEST_EQ( r1, r2 );
+
+            std::string r3, r4;
+
+            boost::mustache::render( tmpl, r3, data, registry );
+            boost::mustache::render( tmpl, r4, data, registry, cache );
+
+            BOOST_TEST_EQ( r3, r4 );
+            BOOST_TEST_EQ( r1, r3 );
+        }
+    }
+
+    {
+        // concurrent use
+
+        boost::mustache::template_cache cache( 1048576, 4 );
+
+        int const N = 8;
+        int const M = 1000;
+
+        std::vector<int> errors( N );
+        std::vector<std::thread> threads;
+
+        for( int i = 0; i < N; ++i )
+        {
+            threads.emplace_back( [&, i]{
+
+                for( int j = 0; j < M; ++j )
+                {
+                    int k = ( i + j ) % 50;
+
+                    std::string r;
+                    boost::mustache::render( "{{x}}-" + std::to_string( k ), r, boost::json::value{ { "x", k } }, boost::json::object(), cache );
+
+                    if( r != std::to_string( k ) + "-" + std::to_string( k ) )
+                    {
+                        ++errors[ i ];
+                    }
+                }
+            } );
+        }
+
+        for( auto& th: threads )
+        {
+            th.join();
+        }
+
+        for( int e: errors )
+        {
+            BOOST_TEST_EQ( e, 0 );
+        }
+
+        boost::mustache::template_cache_stats st = cache.stats();
+
+        BOOST_TEST_EQ( st.hits + st.misses, static_cast<std::size_t>( N * M ) );
+        BOOST_TEST_GE( st.misses, 50u );
+        BOOST_TEST_EQ( st.entries, 50u );
+        BOOST_TEST_EQ( st.evictions, 0u );
+    }
+
+    return boost::report_errors();
+}
@@ -0,0 +1,296 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/partial_registry.hpp>
+#include <boost/mustache/render.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+// a copy of an image, aligned as a mapped file would be
+
+struct image_buffer
+{
+    std::vector<std::uint32_t> v;
+    std::size_t n;
+
+    explicit image_buffer( std::string const& s ): v( s.size() / 4 + 1 ), n( s.size() )
+    {
+        std::memcpy( v.data(), s.data(), n );
+    }
+
+    boost::core::string_view get() const
+    {
+        return { reinterpret_cast<char const*>( v.data() ), n };
+    }
+
+    char* data()
+    {
+        return reinterpret_cast<char*>( v.data() );
+    }
+};
+
+// as the checksum of the image, to test the validation past it
+
+static void update_checksum( image_buffer& b )
+{
+    std::uint64_t h = 0xCBF29CE484222325ull;
+
+    for( std::size_t i = 48; i < b.n; i += 4 )
+    {
+        std::uint32_t w;
+        std::memcpy( &w, b.data() + i, 4 );
+
+        h ^= w;
+        h *= 0x100000001B3ull;
+    }
+
+    std::uint32_t c[ 2 ] = { static_cast<std::uint32_t>( h ), static_cast<std::uint32_t>( h >> 32 ) };
+    std::memcpy( b.data() + 40, c, 8 );
+}
+
+static std::string render( boost::core::string_view tmpl, boost::json::value const& data, boost::mustache::partial_registry const& partials )
+{
+    std::string r;
+    boost::mustache::render( tmpl, r, data, partials );
+    return r;
+}
+
+static std::string render( boost::mustache::compiled_template const& tmpl, boost::json::value const& data, boost::mustache::partial_registry const& partials )
+{
+    std::string r;
+    boost::mustache::render( tmpl, r, data, partials );
+    return r;
+}
+
+int main()
+{
+    boost::json::object partials =
+    {
+        { "row", "<tr>{{#cols}}{{>cell}}{{/cols}}</tr>\n" },
+        { "cell", "<td>{{.}}</td>" },
+        { "list", "<ul>\n{{#items}}\n  {{>item}}\n{{/items}}\n{{^items}}\n  (none)\n{{/items}}\n</ul>\n" },
+        { "item", "<li>\n  {{name}} {{{raw}}} {{a.b.c}}\n</li>\n" },
+        { "node", "{{name}}\n{{#children}}\n  {{>node}}\n{{/children}}\n" },
+        { "delims", "{{=<% %>=}}<% name %> {{name}}" },
+        { "missing", "[{{>nonexistent}}]" },
+        { "empty", "" },
+        { "number", 5 },
+    };
+
+    boost::mustache::partial_registry r1( partials );
+
+    std::string s1;
+    r1.write_image( s1 );
+
+    image_buffer b1( s1 );
+
+    boost::mustache::partial_registry r2( boost::mustache::borrow, b1.get() );
+
+    BOOST_TEST_EQ( r2.size(), r1.size() );
+
+    BOOST_TEST( r2.find( "row" ) != nullptr );
+    BOOST_TEST( r2.find( "empty" ) != nullptr );
+    BOOST_TEST( r2.find( "number" ) == nullptr );
+    BOOST_TEST( r2.find( "nonexistent" ) == nullptr );
+
+    // the image of a registry loaded from an image is the same
+
+    {
+        std::string s2 = "prefix";
+        r2.write_image( s2 );
+
+        BOOST_TEST( s2.substr( 6 ) == s1 );
+    }
+
+    boost::json::value data =
+    {
+        { "rows", { { { "cols", { 1, 2 } } }, { { "cols", { "<3>" } } } } },
+        { "items", { { { "name", "a" }, { "raw", "<b>" }, { "a", { { "b", { { "c", 7 } } } } } }, { { "name", "b" } } } },
+        { "name", "root" },
+        { "children", { { { "name", "x" }, { "children", { { { "name", "y" }, { "children", boost::json::array() } } } } }, { { "name", "z" }, { "children", boost::json::array() } } } },
+    };
+
+    char const* templates[] =
+    {
+        "{{#rows}}{{>row}}{{/rows}}",
+        "  {{>list}}",
+        "{{>node}}",
+        "[{{>number}}][{{>missing}}]",
+        "{{#rows}}\n  {{>row}}\n{{/rows}}\n",
+        "<{{>cell}}> {{>item}}",
+        "{{>delims}}|{{>empty}}|",
+    };
+
+    for( char const* tmpl: templates )
+    {
+        std::string expected;
+        boost::mustache::render( tmpl, expected, data, partials );
+
+        BOOST_TEST_EQ( render( tmpl, data, r2 ), expected );
+
+        boost::mustache::compiled_template ct( tmpl );
+        BOOST_TEST_EQ( render( ct, data, r2 ), expected );
+
+        r2.link( ct );
+        BOOST_TEST_EQ( render( ct, data, r2 ), expected );
+
+        // a template linked to the image, rendered with another registry
+
+        BOOST_TEST_EQ( render( ct, data, r1 ), expected );
+
+        // the partials of the image, rendered directly
+
+        for( auto const& kv: partials )
+        {
+            if( boost::mustache::compiled_template const* p = r2.find( kv.key() ) )
+            {
+                std::string e2;
+                boost::mustache::render( kv.value().as_string(), e2, data, partials );
+
+                BOOST_TEST_EQ( render( *p, data, r2 ), e2 );
+
+                // a copy of a partial loaded from an image still refers to it
+
+                boost::mustache::compiled_template ct2( *p );
+                BOOST_TEST_EQ( render( ct2, data, r2 ), e2 );
+            }
+        }
+    }
+
+    // pull mode
+
+    {
+        boost::mustache::compiled_template ct( templates[ 4 ] );
+
+        std::string expected;
+        boost::mustache::render( ct, expected, data, partials );
+
+        boost::mustache::renderer rd( boost::mustache::borrow, data, r2 );
+        rd.start( ct );
+
+        std::string r;
+
+        while( !rd.done() )
+        {
+            char buffer[ 5 ];
+            r += rd.read( buffer, sizeof( buffer ) );
+        }
+
+        BOOST_TEST_EQ( r, expected );
+    }
+
+    // an empty registry
+
+    {
+        boost::mustache::partial_registry r3( boost::json::object{} );
+
+        std::string s3;
+        r3.write_image( s3 );
+
+        image_buffer b3( s3 );
+        boost::mustache::partial_registry r4( boost::mustache::borrow, b3.get() );
+
+        BOOST_TEST_EQ( r4.size(), 0u );
+    }
+
+    // invalid images
+
+    {
+        // truncated
+
+        for( std::size_t n: { std::size_t( 0 ), std::size_t( 4 ), std::size_t( 48 ), s1.size() / 2, s1.size() - 1 } )
+        {
+            BOOST_TEST_THROWS( boost::mustache::partial_registry( boost::mustache::borrow, b1.get().substr( 0, n ) ), std::invalid_argument );
+        }
+
+        // misaligned
+
+        {
+            std::string s2 = "1234" + s1;
+            image_buffer b2( s2 );
+
+            BOOST_TEST_THROWS( boost::mustache::partial_registry( boost::mustache::borrow, b2.get().substr( 1 ) ), std::invalid_argument );
+        }
+
+        // not an image
+
+        {
+            image_buffer b2( s1 );
+            b2.data()[ 0 ] = 'X';
+
+            BOOST_TEST_THROWS( boost::mustache::partial_registry( boost::mustache::borrow, b2.get() ), std::invalid_argument );
+        }
+
+        // a different version
+
+        {
+            image_buffer b2( s1 );
+            ++b2.data()[ 8 ];
+
+            BOOST_TEST_THROWS( boost::mustache::partial_registry( boost::mustache::borrow, b2.get() ), std::invalid_argument );
+        }
+
+        // a different byte order
+
+        {
+            image_buffer b2( s1 );
+            std::swap( b2.data()[ 12 ], b2.data()[ 15 ] );
+
+            BOOST_TEST_THROWS( boost::mustache::partial_registry( boost::mustache::borrow, b2.get() ), std::invalid_argument );
+        }
+
+        // corrupted; every byte after the header
+
+        for( std::size_t i = 48; i < s1.size(); ++i )
+        {
+            image_buffer b2( s1 );
+            b2.data()[ i ] ^= 0x20;
+
+            BOOST_TEST_THROWS( boost::mustache::partial_registry( boost::mustache::borrow, b2.get() ), std::invalid_argument );
+        }
+
+        // malformed, with a valid checksum; the first instruction follows
+        // the records of the 8 partials, 32 bytes each
+
+        std::size_t const code = 48 + 8 * 32;
+
+        for( std::uint32_t op: { 8u, 100u } )
+        {
+            image_buffer b2( s1 );
+
+            std::memcpy( b2.data() + code, &op, 4 );
+            update_checksum( b2 );
+
+            BOOST_TEST_THROWS( boost::mustache::partial_registry( boost::mustache::borrow, b2.get() ), std::invalid_argument );
+        }
+
+        for( std::size_t offset: { 4u, 8u } )
+        {
+            image_buffer b2( s1 );
+
+            std::uint32_t v = 0xFFFFFF00u;
+
+            std::memcpy( b2.data() + code + offset, &v, 4 );
+            update_checksum( b2 );
+
+            BOOST_TEST_THROWS( boost::mustache::partial_registry( boost::mustache::borrow, b2.get() ), std::invalid_argument );
+        }
+
+        // the image is still valid after all that
+
+        {
+            image_buffer b2( s1 );
+            update_checksum( b2 );
+
+            boost::mustache::partial_registry r3( boost::mustache::borrow, b2.get() );
+            BOOST_TEST_EQ( r3.size(), r1.size() );
+        }
+    }
+
+    return boost::report_errors();
+}
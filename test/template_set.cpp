@@ -0,0 +1,169 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/mustache/template_set.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// version v of the templates; a render that mixes versions is detected
+// by comparing the version of the page with those of its partials
+
+static boost::json::object make_templates( int v )
+{
+    std::string s = std::to_string( v );
+
+    return
+    {
+        { "page", "[" + s + "]{{#items}}{{>item}}{{/items}}\n{{>footer}}" },
+        { "item", "<" + s + ":{{.}}>" },
+        { "footer", "(" + s + ")" },
+    };
+}
+
+static std::string expected( int v )
+{
+    std::string s = std::to_string( v );
+    return "[" + s + "]<" + s + ":1><" + s + ":2><" + s + ":3>\n(" + s + ")";
+}
+
+int main()
+{
+    {
+        boost::mustache::template_set ts;
+
+        std::string r;
+
+        BOOST_TEST( !ts.render( "page", r, boost::json::value() ) );
+        BOOST_TEST_EQ( r, "" );
+
+        ts.publish( make_templates( 1 ) );
+
+        boost::json::value data = { { "items", { 1, 2, 3 } } };
+
+        BOOST_TEST( ts.render( "page", r, data ) );
+        BOOST_TEST_EQ( r, expected( 1 ) );
+
+        // a snapshot remains usable after having been replaced
+
+        std::shared_ptr<boost::mustache::partial_registry const> p1 = ts.snapshot();
+        std::weak_ptr<boost::mustache::partial_registry const> w1 = p1;
+
+        ts.publish( make_templates( 2 ) );
+
+        r.clear();
+
+        boost::mustache::render( *p1->find( "page" ), r, data, *p1 );
+        BOOST_TEST_EQ( r, expected( 1 ) );
+
+        r.clear();
+
+        BOOST_TEST( ts.render( "page", r, data ) );
+        BOOST_TEST_EQ( r, expected( 2 ) );
+
+        // and is destroyed once the last reference to it is gone
+
+        BOOST_TEST( !w1.expired() );
+
+        p1.reset();
+
+        BOOST_TEST( w1.expired() );
+    }
+
+    {
+        // readers rendering while a writer publishes new versions
+
+        boost::mustache::template_set ts( make_templates( 0 ) );
+
+        boost::json::value data = { { "items", { 1, 2, 3 } } };
+
+        int const readers = 8;
+        int const versions = 500;
+
+        std::atomic<bool> stop( false );
+
+        std::vector<int> errors( readers );
+        std::vector<int> renders( readers );
+
+        std::vector<std::thread> threads;
+
+        for( int i = 0; i < readers; ++i )
+        {
+            threads.emplace_back( [&, i]{
+
+                int last = 0;
+
+                while( !stop.load() )
+                {
+                    std::string r;
+
+                    if( !ts.render( "page", r, data ) )
+                    {
+                        ++errors[ i ];
+                        continue;
+                    }
+
+                    int v = std::stoi( r.substr( 1 ) );
+
+                    // consistent, and never older than a version seen before
+
+                    if( r != expected( v ) || v < last )
+                    {
+                        ++errors[ i ];
+                    }
+
+                    last = v;
+                    ++renders[ i ];
+                }
+            } );
+        }
+
+        std::vector<std::weak_ptr<boost::mustache::partial_registry const>> published;
+
+        for( int v = 1; v <= versions; ++v )
+        {
+            auto p = std::make_shared<boost::mustache::partial_registry const>( make_templates( v ) );
+            published.push_back( p );
+
+            ts.publish( std::move( p ) );
+
+            if( v % 50 == 0 )
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        stop.store( true );
+
+        for( auto& th: threads )
+        {
+            th.join();
+        }
+
+        for( int i = 0; i < readers; ++i )
+        {
+            BOOST_TEST_EQ( errors[ i ], 0 );
+            BOOST_TEST_GT( renders[ i ], 0 );
+        }
+
+        // all versions but the current one have been reclaimed
+
+        for( int v = 1; v < versions; ++v )
+        {
+            BOOST_TEST( published[ v - 1 ].expired() );
+        }
+
+        BOOST_TEST( !published.back().expired() );
+
+        std::string r;
+
+        BOOST_TEST( ts.render( "page", r, data ) );
+        BOOST_TEST_EQ( r, expected( versions ) );
+    }
+
+    return boost::report_errors();
+}
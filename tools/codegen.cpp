@@ -0,0 +1,839 @@
+// Copyright 2022 Peter Dimov
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+// boost_mustache_codegen: translates mustache templates to C++
+//
+// Usage:
+//
+//   boost_mustache_codegen [options] [name=]template...
+//   boost_mustache_codegen [options] --spec spec.json
+//
+// Options:
+//
+//   -o file                the C++ source to write (default: standard output)
+//   --header file          also write a header declaring the render functions
+//   --namespace ns         the namespace of the render functions (default: templates)
+//   --partial [name=]file  a partial; the name defaults to the file name
+//                          without the directory and the extension
+//
+// Every template becomes a function
+//
+//   void name( boost::mustache::output_ref out, boost::mustache::data_ref data );
+//
+// With --spec, the templates and partials of the tests in a mustache spec
+// file are translated instead, and the functions
+//
+//   std::size_t test_count();
+//   void render_test( std::size_t i, boost::mustache::output_ref out, boost::mustache::data_ref data );
+//
+// render the template of the i-th test.
+
+#include <boost/mustache/compiled_template.hpp>
+#include <boost/json.hpp>
+#include <boost/core/detail/string_view.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <cstdio>
+#include <cctype>
+
+namespace boost
+{
+namespace mustache
+{
+
+// translates compiled templates to C++ functions that call into generated.hpp
+//
+// Literal runs become string constants, with the indentation of standalone
+// partials applied at generation time; partials are inlined, except those
+// reached recursively, which become functions; sections become loops, over
+// lambdas passed to generated::render_section.
+
+class code_generator
+{
+private:
+
+    struct partial
+    {
+        std::string name;
+        compiled_template tmpl;
+
+        // the name of the function rendering the partial, when recursive
+        std::string function;
+    };
+
+    // where the code being generated renders: the innermost context, and the
+    // indentation; either dind is "nullptr" and the indentation is sind, known
+    // at generation time, or sind is empty and the indentation is dind
+
+    struct scope
+    {
+        std::string ctx;
+        std::string dind;
+        std::string sind;
+    };
+
+private:
+
+    std::map<std::string, partial> partials_;
+
+    // the partials being inlined
+    std::vector<std::string> inline_stack_;
+
+    // the partials to be rendered by functions, not yet generated
+    std::vector<partial*> pending_;
+
+    // the names of the variables used by the generated code
+    std::set<std::string> used_;
+
+    std::size_t vars_ = 0;
+
+    // the name of the function being generated
+    std::string name_;
+
+    // the literal text to be written by the next write
+    std::string text_;
+
+    std::ostringstream* os_ = nullptr;
+    int level_ = 0;
+
+private:
+
+    static std::string quote( core::string_view sv )
+    {
+        std::string r = "\"";
+
+        for( std::size_t i = 0; i < sv.size(); ++i )
+        {
+            unsigned char ch = static_cast<unsigned char>( sv[ i ] );
+
+            switch( ch )
+            {
+            case '\n':
+
+                r += "\\n";
+
+                if( i + 1 < sv.size() )
+                {
+                    // continue on the next line
+                    r += "\"\n\"";
+                }
+
+                break;
+
+            case '\r': r += "\\r"; break;
+            case '\t': r += "\\t"; break;
+            case '"': r += "\\\""; break;
+            case '\\': r += "\\\\"; break;
+            case '?': r += "\\?"; break;
+
+            default:
+
+                if( ch < 0x20 || ch >= 0x7F )
+                {
+                    char buffer[ 8 ];
+                    std::snprintf( buffer, sizeof( buffer ), "\\%03o", ch );
+
+                    r += buffer;
+                }
+                else
+                {
+                    r += static_cast<char>( ch );
+                }
+            }
+        }
+
+        return r + "\"";
+    }
+
+    // a string_view expression for sv
+
+    static std::string literal( core::string_view sv )
+    {
+        std::string r = quote( sv );
+
+        if( sv.find( '\0' ) != core::string_view::npos )
+        {
+            r = "boost::core::string_view( " + r + ", " + std::to_string( sv.size() ) + " )";
+        }
+
+        return r;
+    }
+
+    std::string var( char const* prefix )
+    {
+        return prefix + std::to_string( ++vars_ );
+    }
+
+    std::string use( std::string const& v )
+    {
+        used_.insert( v );
+        return v;
+    }
+
+    void line( std::string const& s )
+    {
+        std::string indent( level_ * 4, ' ' );
+
+        // the continuation lines of string constants are indented as well
+
+        std::string t = indent;
+
+        for( char ch: s )
+        {
+            t += ch;
+
+            if( ch == '\n' )
+            {
+                t += indent + "    ";
+            }
+        }
+
+        *os_ << t << '\n';
+    }
+
+    void flush()
+    {
+        if( !text_.empty() )
+        {
+            line( use( "out" ) + ".write( " + literal( text_ ) + " );" );
+            text_.clear();
+        }
+    }
+
+    static core::string_view text( compiled_template const& tmpl, std::size_t first, std::size_t size )
+    {
+        return core::string_view( tmpl.text_ ).substr( first, size );
+    }
+
+    // an expression for the value of the name of instruction in
+
+    std::string lookup( compiled_template const& tmpl, compiled_template::instruction const& in, scope const& sc )
+    {
+        if( in.size == 0 )
+        {
+            return use( sc.ctx ) + "->value";
+        }
+
+        compiled_template::segment const& s0 = tmpl.segments_[ in.first ];
+
+        std::string r = "boost::mustache::generated::lookup( " + use( sc.ctx ) + ", " + literal( text( tmpl, s0.first, s0.size ) ) + " )";
+
+        for( std::size_t k = 1; k < in.size; ++k )
+        {
+            compiled_template::segment const& s = tmpl.segments_[ in.first + k ];
+            r += ".lookup( " + literal( text( tmpl, s.first, s.size ) ) + " )";
+        }
+
+        return r;
+    }
+
+    // as renderer::render_compiled_literal, with the indentation sind
+
+    static std::string indent_literal( core::string_view text, bool line_start, std::string const& sind )
+    {
+        if( sind.empty() )
+        {
+            return std::string( text );
+        }
+
+        std::string r;
+
+        if( line_start )
+        {
+            r += sind;
+        }
+
+        for( ;; )
+        {
+            std::size_t i = text.find( '\n' );
+
+            if( i == core::string_view::npos || i + 1 == text.size() )
+            {
+                r += std::string( text );
+                break;
+            }
+
+            r += std::string( text.substr( 0, i + 1 ) );
+            r += sind;
+
+            text.remove_prefix( i + 1 );
+        }
+
+        return r;
+    }
+
+    void generate_range( compiled_template const& tmpl, std::size_t first, std::size_t last, scope const& sc )
+    {
+        for( std::size_t i = first; i < last; ++i )
+        {
+            compiled_template::instruction const& in = tmpl.code_[ i ];
+
+            switch( in.op )
+            {
+            case compiled_template::op_literal:
+
+                if( sc.dind == "nullptr" )
+                {
+                    text_ += indent_literal( text( tmpl, in.first, in.size ), in.arg != 0, sc.sind );
+                }
+                else
+                {
+                    flush();
+                    line( "boost::mustache::generated::write_literal( " + use( "out" ) + ", " + literal( text( tmpl, in.first, in.size ) ) + ", " + ( in.arg? "true": "false" ) + ", " + use( sc.dind ) + " );" );
+                }
+
+                break;
+
+            case compiled_template::op_indent:
+
+                if( sc.dind == "nullptr" )
+                {
+                    text_ += sc.sind;
+                }
+                else
+                {
+                    flush();
+                    line( "boost::mustache::generated::write_indent( " + use( "out" ) + ", " + use( sc.dind ) + " );" );
+                }
+
+                break;
+
+            case compiled_template::op_escaped:
+            case compiled_template::op_unescaped:
+
+                flush();
+                line( lookup( tmpl, in, sc ) + ".output( " + use( "out" ) + ", " + ( in.op == compiled_template::op_escaped? "true": "false" ) + " );" );
+
+                break;
+
+            case compiled_template::op_section:
+            case compiled_template::op_inverted_section:
+
+                flush();
+                generate_section( tmpl, i, sc );
+
+                i += in.arg;
+                break;
+
+            case compiled_template::op_partial:
+            case compiled_template::op_standalone_partial:
+
+                generate_partial( tmpl, in, sc );
+                break;
+            }
+        }
+    }
+
+    void generate_section( compiled_template const& tmpl, std::size_t i, scope const& sc )
+    {
+        compiled_template::instruction const& in = tmpl.code_[ i ];
+
+        std::string p = lookup( tmpl, in, sc );
+
+        if( in.op == compiled_template::op_inverted_section )
+        {
+            line( "if( !" + p + ".is_true() )" );
+            line( "{" );
+
+            ++level_;
+            generate_range( tmpl, i + 1, i + 1 + in.arg, sc );
+            flush();
+            --level_;
+
+            line( "}" );
+        }
+        else
+        {
+            scope sc2 = sc;
+            sc2.ctx = var( "ctx" );
+
+            std::ostringstream* os = os_;
+            std::ostringstream body;
+
+            os_ = &body;
+
+            ++level_;
+            generate_range( tmpl, i + 1, i + 1 + in.arg, sc2 );
+            flush();
+            --level_;
+
+            os_ = os;
+
+            std::string param = "boost::mustache::generated::context const* " + ( used_.count( sc2.ctx )? sc2.ctx: "/*" + sc2.ctx + "*/" );
+
+            line( "boost::mustache::generated::render_section( " + p + ", " + use( sc.ctx ) + ", [&]( " + param + " )" );
+            line( "{" );
+            *os_ << body.str();
+            line( "} );" );
+        }
+    }
+
+    void generate_partial( compiled_template const& tmpl, compiled_template::instruction const& in, scope const& sc )
+    {
+        core::string_view name = text( tmpl, in.first, in.size );
+
+        auto it = partials_.find( std::string( name ) );
+
+        if( it == partials_.end() )
+        {
+            // a missing partial renders nothing
+            return;
+        }
+
+        partial& pt = it->second;
+
+        bool standalone = in.op == compiled_template::op_standalone_partial;
+        core::string_view wsp = text( tmpl, in.arg, in.arg_size );
+
+        flush();
+
+        bool recursive = false;
+
+        for( auto const& n: inline_stack_ )
+        {
+            recursive = recursive || n == pt.name;
+        }
+
+        if( recursive )
+        {
+            if( pt.function.empty() )
+            {
+                pt.function = name_ + "_partial_" + std::to_string( ++vars_ );
+                pending_.push_back( &pt );
+            }
+
+            std::string ind = "nullptr";
+
+            if( standalone && ( sc.dind != "nullptr" || !( sc.sind + std::string( wsp ) ).empty() ) )
+            {
+                ind = var( "ind" );
+
+                if( sc.dind == "nullptr" )
+                {
+                    line( "boost::mustache::generated::indent const " + ind + " = { " + literal( sc.sind + std::string( wsp ) ) + ", nullptr };" );
+                }
+                else
+                {
+                    line( "boost::mustache::generated::indent const " + ind + " = { " + literal( wsp ) + ", " + use( sc.dind ) + " };" );
+                }
+
+                ind = "&" + ind;
+            }
+
+            line( pt.function + "( " + use( "out" ) + ", " + use( sc.ctx ) + ", " + ind + " );" );
+            return;
+        }
+
+        scope sc2 = { sc.ctx, "nullptr", std::string() };
+
+        line( "// {{>" + std::string( name ) + "}}" );
+        line( "{" );
+
+        ++level_;
+
+        if( standalone )
+        {
+            // the partial is indented by the whitespace before the tag
+
+            if( sc.dind == "nullptr" )
+            {
+                sc2.sind = sc.sind + std::string( wsp );
+            }
+            else
+            {
+                std::string ind = var( "ind" );
+
+                line( "boost::mustache::generated::indent const " + ind + " = { " + literal( wsp ) + ", " + use( sc.dind ) + " };" );
+                sc2.dind = "&" + ind;
+            }
+        }
+
+        inline_stack_.push_back( pt.name );
+
+        generate_range( pt.tmpl, 0, pt.tmpl.code_.size(), sc2 );
+        flush();
+
+        inline_stack_.pop_back();
+
+        --level_;
+
+        line( "}" );
+    }
+
+    // generates the body of a function with the parameters out, and
+    // context ctx and indentation ind, or data; returns its parameters
+
+    std::string generate_body( compiled_template const& tmpl, bool data, std::ostringstream& os )
+    {
+        used_.clear();
+
+        std::ostringstream body;
+
+        os_ = &body;
+        level_ = 1;
+
+        scope sc = { "ctx", data? "nullptr": "ind", std::string() };
+
+        generate_range( tmpl, 0, tmpl.code_.size(), sc );
+        flush();
+
+        std::string out = used_.count( "out" )? "out": "/*out*/";
+
+        std::string r = "boost::mustache::output_ref " + out;
+
+        os_ = &os;
+        level_ = 0;
+
+        line( "{" );
+
+        if( data )
+        {
+            if( used_.count( "ctx" ) )
+            {
+                r += ", boost::mustache::data_ref data";
+
+                ++level_;
+                line( "boost::mustache::generated::render_scope const scope;" );
+                line( "boost::mustache::generated::context const c = { data, nullptr };" );
+                line( "boost::mustache::generated::context const* ctx = &c;" );
+                --level_;
+
+                *os_ << "\n";
+            }
+            else
+            {
+                r += ", boost::mustache::data_ref /*data*/";
+            }
+        }
+        else
+        {
+            r += ", boost::mustache::generated::context const* " + std::string( used_.count( "ctx" )? "ctx": "/*ctx*/" );
+            r += ", boost::mustache::generated::indent const* " + std::string( used_.count( "ind" )? "ind": "/*ind*/" );
+        }
+
+        *os_ << body.str();
+
+        level_ = 0;
+        line( "}" );
+
+        return r;
+    }
+
+public:
+
+    void add_partial( std::string const& name, core::string_view text )
+    {
+        partials_.erase( name );
+        partials_.insert( { name, { name, compiled_template( text ), std::string() } } );
+    }
+
+    void clear_partials()
+    {
+        partials_.clear();
+    }
+
+    // generates the function name, and the functions of its recursive partials
+
+    std::string generate( std::string const& name, compiled_template const& tmpl, bool is_static = false )
+    {
+        std::ostringstream os;
+
+        std::string prefix = is_static? "static ": "";
+
+        name_ = name;
+
+        std::ostringstream body;
+        std::string params = generate_body( tmpl, true, body );
+
+        std::ostringstream functions;
+        std::ostringstream declarations;
+
+        while( !pending_.empty() )
+        {
+            partial* pt = pending_.back();
+            pending_.pop_back();
+
+            inline_stack_.push_back( pt->name );
+
+            std::ostringstream fbody;
+            std::string fparams = generate_body( pt->tmpl, false, fbody );
+
+            inline_stack_.pop_back();
+
+            std::string fname = "static void " + pt->function;
+
+            declarations << fname << "( boost::mustache::output_ref, boost::mustache::generated::context const*, boost::mustache::generated::indent const* );\n";
+            functions << "// {{>" << pt->name << "}}\n\n" << fname << "( " << fparams << " )\n" << fbody.str() << "\n";
+        }
+
+        for( auto& kv: partials_ )
+        {
+            kv.second.function.clear();
+        }
+
+        if( !declarations.str().empty() )
+        {
+            os << declarations.str() << "\n";
+        }
+
+        os << prefix << "void " << name << "( " << params << " )\n" << body.str() << "\n" << functions.str();
+
+        return os.str();
+    }
+};
+
+} // namespace mustache
+} // namespace boost
+
+//
+
+static std::string read_file( std::string const& fn )
+{
+    std::ifstream is( fn, std::ios::binary );
+
+    if( !is )
+    {
+        throw std::runtime_error( "cannot open '" + fn + "'" );
+    }
+
+    std::ostringstream os;
+    os << is.rdbuf();
+
+    return os.str();
+}
+
+static void write_file( std::string const& fn, std::string const& s )
+{
+    if( fn.empty() )
+    {
+        std::cout << s;
+        return;
+    }
+
+    std::ofstream os( fn, std::ios::binary );
+    os << s;
+
+    if( !os )
+    {
+        throw std::runtime_error( "cannot write '" + fn + "'" );
+    }
+}
+
+// s, with the characters not allowed in identifiers replaced
+
+static std::string identifier( std::string s )
+{
+    for( char& ch: s )
+    {
+        if( !( ( ch >= 'a' && ch <= 'z' ) || ( ch >= 'A' && ch <= 'Z' ) || ( ch >= '0' && ch <= '9' ) ) )
+        {
+            ch = '_';
+        }
+    }
+
+    if( s.empty() || ( s[ 0 ] >= '0' && s[ 0 ] <= '9' ) )
+    {
+        s = "_" + s;
+    }
+
+    return s;
+}
+
+// the name of file fn without the directory and the extension
+
+static std::string stem( std::string const& fn )
+{
+    std::string r = fn;
+
+    std::string::size_type i = r.find_last_of( "/\\" );
+
+    if( i != std::string::npos )
+    {
+        r.erase( 0, i + 1 );
+    }
+
+    return r.substr( 0, r.find( '.' ) );
+}
+
+// splits "name=file", or "file" with the name derived from the file;
+// template names are identifiers, partial names needn't be
+
+static std::pair<std::string, std::string> name_and_file( std::string const& arg, bool partial )
+{
+    std::string::size_type i = arg.find( '=' );
+
+    if( i != std::string::npos )
+    {
+        return { arg.substr( 0, i ), arg.substr( i + 1 ) };
+    }
+
+    return { partial? stem( arg ): identifier( stem( arg ) ), arg };
+}
+
+static char const* usage =
+
+    "Usage: boost_mustache_codegen [options] [name=]template...\n"
+    "       boost_mustache_codegen [options] --spec spec.json\n"
+    "\n"
+    "Options:\n"
+    "  -o file                the C++ source to write (default: standard output)\n"
+    "  --header file          also write a header declaring the render functions\n"
+    "  --namespace ns         the namespace of the render functions (default: templates)\n"
+    "  --partial [name=]file  a partial\n";
+
+int main( int ac, char const* av[] )
+{
+    std::string output, header, spec, ns = "templates";
+
+    std::vector<std::pair<std::string, std::string>> templates, partials;
+
+    for( int i = 1; i < ac; ++i )
+    {
+        std::string arg = av[ i ];
+
+        if( ( arg == "-o" || arg == "--header" || arg == "--namespace" || arg == "--partial" || arg == "--spec" ) && i + 1 < ac )
+        {
+            std::string value = av[ ++i ];
+
+            if( arg == "-o" ) output = value;
+            else if( arg == "--header" ) header = value;
+            else if( arg == "--namespace" ) ns = value;
+            else if( arg == "--spec" ) spec = value;
+            else partials.push_back( name_and_file( value, true ) );
+        }
+        else if( !arg.empty() && arg[ 0 ] != '-' )
+        {
+            templates.push_back( name_and_file( arg, false ) );
+        }
+        else
+        {
+            std::cerr << usage;
+            return 2;
+        }
+    }
+
+    if( spec.empty() == templates.empty() )
+    {
+        std::cerr << usage;
+        return 2;
+    }
+
+    try
+    {
+        boost::mustache::code_generator gen;
+
+        std::ostringstream os;
+
+        os << "// Generated by boost_mustache_codegen; do not edit\n\n";
+
+        os << "#include <boost/mustache/generated.hpp>\n";
+        os << "#include <boost/mustache/data_ref.hpp>\n";
+        os << "#include <boost/mustache/output_ref.hpp>\n";
+        os << "#include <cstddef>\n\n";
+
+        os << "namespace " << ns << "\n{\n\n";
+
+        std::ostringstream decls;
+
+        if( !spec.empty() )
+        {
+            boost::json::value jv = boost::json::parse( read_file( spec ) );
+            boost::json::array const& tests = jv.at( "tests" ).as_array();
+
+            for( std::size_t i = 0; i < tests.size(); ++i )
+            {
+                boost::json::object const& test = tests[ i ].as_object();
+
+                gen.clear_partials();
+
+                if( boost::json::value const* p = test.if_contains( "partials" ) )
+                {
+                    for( auto const& kv: p->as_object() )
+                    {
+                        if( kv.value().is_string() )
+                        {
+                            gen.add_partial( kv.key(), kv.value().get_string() );
+                        }
+                    }
+                }
+
+                boost::mustache::compiled_template tmpl( test.at( "template" ).as_string() );
+
+                os << "// " << test.at( "name" ).as_string().subview() << "\n\n";
+                os << gen.generate( "test_" + std::to_string( i ), tmpl, true );
+            }
+
+            os << "std::size_t test_count()\n{\n    return " << tests.size() << ";\n}\n\n";
+
+            os << "void render_test( std::size_t i, boost::mustache::output_ref out, boost::mustache::data_ref data )\n{\n";
+            os << "    switch( i )\n    {\n";
+
+            for( std::size_t i = 0; i < tests.size(); ++i )
+            {
+                os << "    case " << i << ": test_" << i << "( out, data ); break;\n";
+            }
+
+            os << "    }\n}\n\n";
+
+            decls << "std::size_t test_count();\n";
+            decls << "void render_test( std::size_t i, boost::mustache::output_ref out, boost::mustache::data_ref data );\n";
+        }
+        else
+        {
+            for( auto const& p: partials )
+            {
+                gen.add_partial( p.first, read_file( p.second ) );
+            }
+
+            for( auto const& t: templates )
+            {
+                boost::mustache::compiled_template tmpl( read_file( t.second ) );
+
+                os << "// " << t.second << "\n\n";
+                os << gen.generate( t.first, tmpl );
+
+                decls << "void " << t.first << "( boost::mustache::output_ref out, boost::mustache::data_ref data );\n";
+            }
+        }
+
+        os << "} // namespace " << ns << "\n";
+
+        write_file( output, os.str() );
+
+        if( !header.empty() )
+        {
+            std::string guard = "BOOST_MUSTACHE_GENERATED_" + identifier( stem( header ) ) + "_INCLUDED";
+
+            for( char& ch: guard )
+            {
+                ch = static_cast<char>( std::toupper( static_cast<unsigned char>( ch ) ) );
+            }
+
+            std::ostringstream hs;
+
+            hs << "// Generated by boost_mustache_codegen; do not edit\n\n";
+            hs << "#ifndef " << guard << "\n#define " << guard << "\n\n";
+            hs << "#include <boost/mustache/data_ref.hpp>\n";
+            hs << "#include <boost/mustache/output_ref.hpp>\n";
+            hs << "#include <cstddef>\n\n";
+            hs << "namespace " << ns << "\n{\n\n" << decls.str() << "\n} // namespace " << ns << "\n\n";
+            hs << "#endif // #ifndef " << guard << "\n";
+
+            write_file( header, hs.str() );
+        }
+
+        return 0;
+    }
+    catch( std::exception const& x )
+    {
+        std::cerr << "boost_mustache_codegen: " << x.what() << std::endl;
+        return 1;
+    }
+}